@@ -0,0 +1,146 @@
+#include "alerts.h"
+#include "planindex.h"
+#include "utils.h"
+#include "memtrack.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @file alerts.c
+ * @brief Implementação dos alertas em tempo real de refeições fora do plano alimentar.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'alerts.h'. Os planos são guardados num
+ * índice de intervalos (ver 'planindex.h'), ao qual os planos inseridos vão sendo acrescentados.
+ */
+
+#define ALERT_BUFFER_SIZE (1 << 16)
+
+struct AlertMonitor {
+	PlanIndex *plans;
+
+	int fd;
+	int isSocket;
+	char *buffer;
+	size_t pending;
+
+	long checked;
+	long alerts;
+	long withoutPlan;
+};
+
+static int openSink(AlertMonitor *monitor, const char *sink) {
+	if (!strcmp(sink, "stdout")) {
+		monitor->fd = STDOUT_FILENO;
+		return 0;
+	}
+	if (!strncmp(sink, "file:", 5)) {
+		monitor->fd = open(sink + 5, O_WRONLY | O_APPEND | O_CREAT, 0644);
+		return monitor->fd == -1 ? -1 : 0;
+	}
+	if (!strncmp(sink, "unix:", 5)) {
+		struct sockaddr_un address = {.sun_family = AF_UNIX};
+		if (strlen(sink + 5) >= sizeof(address.sun_path)) {
+			return -1;
+		}
+		strcpy(address.sun_path, sink + 5);
+		monitor->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		monitor->isSocket = 1;
+		if (monitor->fd == -1 || connect(monitor->fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+			return -1;
+		}
+		return 0;
+	}
+	return -1;
+}
+
+AlertMonitor *createAlertMonitor(const char *sink) {
+	AlertMonitor *monitor = memCalloc(MEM_INGEST, 1, sizeof(AlertMonitor));
+	if (monitor == NULL) {
+		return NULL;
+	}
+	monitor->fd = -1;
+	monitor->buffer = memAlloc(MEM_INGEST, ALERT_BUFFER_SIZE);
+
+	monitor->plans = createPlanIndex();
+
+	if (monitor->buffer == NULL || monitor->plans == NULL || openSink(monitor, sink) != 0) {
+		printf("Nao foi possivel abrir o destino dos alertas: %s\n", sink);
+		closeAlertMonitor(monitor);
+		return NULL;
+	}
+	return monitor;
+}
+
+int flushAlerts(AlertMonitor *monitor) {
+	size_t written = 0;
+
+	if (monitor == NULL || monitor->pending == 0) {
+		return 0;
+	}
+	// Na saida padrao, o texto ja escrito com printf tem de sair antes dos alertas
+	if (monitor->fd == STDOUT_FILENO) {
+		fflush(stdout);
+	}
+	while (written < monitor->pending) {
+		// Num socket cujo leitor terminou, 'send' devolve um erro em vez de terminar o programa com SIGPIPE
+		ssize_t bytes = monitor->isSocket ? send(monitor->fd, monitor->buffer + written, monitor->pending - written, MSG_NOSIGNAL) : write(monitor->fd, monitor->buffer + written, monitor->pending - written);
+		if (bytes < 0) {
+			monitor->pending = 0;
+			return -1;
+		}
+		written += bytes;
+	}
+	monitor->pending = 0;
+	return 0;
+}
+
+void closeAlertMonitor(AlertMonitor *monitor) {
+	if (monitor == NULL) {
+		return;
+	}
+	flushAlerts(monitor);
+	if (monitor->fd != -1 && monitor->fd != STDOUT_FILENO) {
+		close(monitor->fd);
+	}
+	freePlanIndex(monitor->plans);
+	memFree(monitor->buffer);
+	memFree(monitor);
+}
+
+int alertAddPlan(AlertMonitor *monitor, const MealPlan *mealPlan) {
+	return addPlanVersion(monitor->plans, mealPlan);
+}
+
+int alertCheckDiet(AlertMonitor *monitor, const Diet *diet) {
+	const PlanVersion *version = activePlan(monitor->plans, diet->ID, diet->meal, dateToDays(diet->date));
+
+	monitor->checked++;
+	if (version == NULL) {
+		monitor->withoutPlan++;
+		return 0;
+	}
+	if (diet->calories >= version->minCal && diet->calories <= version->maxCal) {
+		return 0;
+	}
+
+	// Um alerta tem no maximo cerca de 200 bytes; o buffer e esvaziado antes de ficar sem espaco
+	if (monitor->pending + 256 > ALERT_BUFFER_SIZE && flushAlerts(monitor) != 0) {
+		return -1;
+	}
+	monitor->pending += snprintf(monitor->buffer + monitor->pending, ALERT_BUFFER_SIZE - monitor->pending, "ALERTA; %04d; %02d-%02d-%04d; %s; %d cal; %d Cal, %d Cal; %s\n", diet->ID, diet->date.day, diet->date.month, diet->date.year, diet->meal, diet->calories, version->minCal, version->maxCal, diet->calories < version->minCal ? "abaixo" : "acima");
+	monitor->alerts++;
+	return 1;
+}
+
+void printAlertStats(const AlertMonitor *monitor) {
+	if (monitor == NULL) {
+		return;
+	}
+	printf("Alertas: %ld dietas verificadas, %ld fora do plano, %ld sem plano ativo\n", monitor->checked, monitor->alerts, monitor->withoutPlan);
+}
@@ -0,0 +1,88 @@
+#ifndef ALERTS_H
+#define ALERTS_H
+
+#include "types.h"
+
+/**
+ * @file alerts.h
+ * @brief Cabeçalho dos alertas em tempo real de refeições fora do plano alimentar.
+ *
+ * Este ficheiro de cabeçalho declara um monitor que verifica cada dieta inserida pelo caminho de escrita
+ * contra o plano alimentar ativo do paciente nessa data e refeição, e envia um alerta quando as calorias
+ * ficam abaixo do mínimo ou acima do máximo do plano:
+ * - Os planos são guardados num índice de intervalos por (paciente, refeição) (ver 'planindex.h'); o plano
+ *   ativo numa data é a última versão com data igual ou anterior, como em 'topPatients'.
+ * - Como as dietas chegam normalmente por ordem cronológica, a versão mais recente é testada primeiro e a
+ *   pesquisa binária só é usada para dietas anteriores a essa versão. Cada verificação custa assim uma
+ *   pesquisa na tabela e uma comparação.
+ * - Os alertas são acumulados num buffer e enviados para o destino de uma só vez quando o buffer enche ou
+ *   quando o lote do caminho de escrita é escrito, pelo que a verificação não faz uma escrita por dieta.
+ *
+ * O destino dos alertas é indicado por uma cadeia de caracteres:
+ * - "stdout": saída padrão.
+ * - "file:<caminho>": ficheiro, aberto para acrescentar linhas.
+ * - "unix:<caminho>": socket local (AF_UNIX, do tipo SOCK_STREAM) onde outro processo está à escuta.
+ *
+ * Cada alerta é uma linha no formato "ALERTA; 0001; 01-01-2023; jantar; 800 cal; 500 Cal, 600 Cal; acima".
+ *
+ * @note Este ficheiro depende das definições das estruturas de dados em 'types.h'.
+ */
+
+/**
+ * @brief Cria um monitor de alertas e abre o respetivo destino.
+ *
+ * @param sink Destino dos alertas ("stdout", "file:<caminho>" ou "unix:<caminho>").
+ *
+ * @return Retorna um ponteiro para o novo monitor, ou NULL se o destino for inválido, não puder ser aberto ou
+ *         não houver memória.
+ */
+AlertMonitor *createAlertMonitor(const char *sink);
+
+/**
+ * @brief Envia os alertas pendentes, fecha o destino e liberta a memória do monitor.
+ *
+ * @param monitor Ponteiro para o monitor (pode ser NULL).
+ */
+void closeAlertMonitor(AlertMonitor *monitor);
+
+/**
+ * @brief Acrescenta um plano alimentar ao índice de planos do monitor.
+ *
+ * Um plano com a mesma data de outro já indexado para o mesmo paciente e refeição substitui-o, tal como o
+ * último registo do ficheiro prevalece nas consultas.
+ *
+ * @param monitor Ponteiro para o monitor.
+ * @param mealPlan Plano a acrescentar.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não houver memória.
+ */
+int alertAddPlan(AlertMonitor *monitor, const MealPlan *mealPlan);
+
+/**
+ * @brief Verifica uma dieta contra o plano ativo e, se estiver fora do intervalo, regista um alerta.
+ *
+ * @param monitor Ponteiro para o monitor.
+ * @param diet Dieta a verificar.
+ *
+ * @return Retorna 1 se foi registado um alerta, 0 se a dieta cumpre o plano ou não tem plano ativo, ou -1 se
+ *         não for possível escrever no destino.
+ */
+int alertCheckDiet(AlertMonitor *monitor, const Diet *diet);
+
+/**
+ * @brief Envia para o destino os alertas acumulados no buffer.
+ *
+ * @param monitor Ponteiro para o monitor (pode ser NULL).
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não for possível escrever no destino.
+ */
+int flushAlerts(AlertMonitor *monitor);
+
+/**
+ * @brief Imprime as estatísticas do monitor: dietas verificadas, alertas e dietas sem plano ativo.
+ *
+ * @param monitor Ponteiro para o monitor (pode ser NULL).
+ */
+void printAlertStats(const AlertMonitor *monitor);
+
+#endif // ALERTS_H
@@ -0,0 +1,233 @@
+#include "cache.h"
+#include "utils.h"
+#include "memtrack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file cache.c
+ * @brief Implementação da cache de resultados de consultas.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'cache.h'. Os resultados são guardados
+ * numa tabela de dispersão com encadeamento, para encontrar uma chave em O(1), e ao mesmo tempo numa lista
+ * duplamente ligada ordenada do mais recente para o menos recente, para descartar o resultado menos usado
+ * em O(1) quando o limite de memória é ultrapassado.
+ */
+
+#define CACHE_BUCKETS 1024
+
+// Um resultado guardado: pertence a uma lista do balde da tabela e a lista LRU
+typedef struct CacheEntry {
+	QueryKey key;
+	void *value;
+	size_t size;
+	struct CacheEntry *nextInBucket;
+	struct CacheEntry *newer;
+	struct CacheEntry *older;
+} CacheEntry;
+
+struct ResultCache {
+	CacheEntry *buckets[CACHE_BUCKETS];
+	CacheEntry *newest;
+	CacheEntry *oldest;
+	size_t budget;
+	size_t used;
+	int entries;
+	long hits;
+	long misses;
+	long evictions;
+	long invalidations;
+};
+
+static unsigned hashKey(const QueryKey *key) {
+	unsigned hash = 2166136261u;
+	int fields[] = {key->kind, key->ID, key->limit, dateToDays(key->period.begin), dateToDays(key->period.end)};
+
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+		hash = (hash ^ (unsigned)fields[i]) * 16777619u;
+	}
+	for (const char *c = key->meal; *c != '\0'; c++) {
+		hash = (hash ^ (unsigned char)*c) * 16777619u;
+	}
+	return hash % CACHE_BUCKETS;
+}
+
+static int sameDate(Date first, Date second) {
+	return first.day == second.day && first.month == second.month && first.year == second.year;
+}
+
+static int sameKey(const QueryKey *first, const QueryKey *second) {
+	return first->kind == second->kind && first->ID == second->ID && first->limit == second->limit &&
+		sameDate(first->period.begin, second->period.begin) && sameDate(first->period.end, second->period.end) &&
+		!strcmp(first->meal, second->meal);
+}
+
+// Memoria contabilizada para um resultado: o proprio valor mais a entrada que o descreve
+static size_t entryCost(size_t size) {
+	return sizeof(CacheEntry) + size;
+}
+
+static void unlinkRecent(ResultCache *cache, CacheEntry *entry) {
+	if (entry->newer != NULL) {
+		entry->newer->older = entry->older;
+	} else {
+		cache->newest = entry->older;
+	}
+	if (entry->older != NULL) {
+		entry->older->newer = entry->newer;
+	} else {
+		cache->oldest = entry->newer;
+	}
+	entry->newer = entry->older = NULL;
+}
+
+static void pushNewest(ResultCache *cache, CacheEntry *entry) {
+	entry->newer = NULL;
+	entry->older = cache->newest;
+	if (cache->newest != NULL) {
+		cache->newest->newer = entry;
+	}
+	cache->newest = entry;
+	if (cache->oldest == NULL) {
+		cache->oldest = entry;
+	}
+}
+
+static void removeEntry(ResultCache *cache, CacheEntry *entry) {
+	CacheEntry **link = &cache->buckets[hashKey(&entry->key)];
+
+	while (*link != entry) {
+		link = &(*link)->nextInBucket;
+	}
+	*link = entry->nextInBucket;
+	unlinkRecent(cache, entry);
+
+	cache->used -= entryCost(entry->size);
+	cache->entries--;
+	memFree(entry->value);
+	memFree(entry);
+}
+
+ResultCache *createCache(size_t budget) {
+	ResultCache *cache = memCalloc(MEM_CACHE, 1, sizeof(ResultCache));
+	if (cache != NULL) {
+		cache->budget = budget;
+	}
+	return cache;
+}
+
+void freeCache(ResultCache *cache) {
+	if (cache == NULL) {
+		return;
+	}
+	while (cache->newest != NULL) {
+		removeEntry(cache, cache->newest);
+	}
+	memFree(cache);
+}
+
+const void *cacheLookup(ResultCache *cache, const QueryKey *key, size_t *size) {
+	if (cache == NULL || cache->budget == 0) {
+		return NULL;
+	}
+
+	for (CacheEntry *entry = cache->buckets[hashKey(key)]; entry != NULL; entry = entry->nextInBucket) {
+		if (sameKey(&entry->key, key)) {
+			unlinkRecent(cache, entry);
+			pushNewest(cache, entry);
+			cache->hits++;
+			*size = entry->size;
+			return entry->value;
+		}
+	}
+	cache->misses++;
+	return NULL;
+}
+
+int cacheStore(ResultCache *cache, const QueryKey *key, const void *value, size_t size) {
+	if (cache == NULL || entryCost(size) > cache->budget) {
+		return -1;
+	}
+
+	CacheEntry *entry = memAlloc(MEM_CACHE, sizeof(CacheEntry));
+	void *copy = memAlloc(MEM_CACHE, size > 0 ? size : 1);
+	// Acima do orcamento de memoria da cache ('--memory-budget'), os resultados mais antigos dao lugar ao novo
+	while ((entry == NULL || copy == NULL) && cache->oldest != NULL) {
+		removeEntry(cache, cache->oldest);
+		cache->evictions++;
+		if (entry == NULL) {
+			entry = memAlloc(MEM_CACHE, sizeof(CacheEntry));
+		}
+		if (copy == NULL) {
+			copy = memAlloc(MEM_CACHE, size > 0 ? size : 1);
+		}
+	}
+	if (entry == NULL || copy == NULL) {
+		memFree(entry);
+		memFree(copy);
+		return -1;
+	}
+	memcpy(copy, value, size);
+
+	// Uma chave repetida substitui o resultado anterior
+	unsigned bucket = hashKey(key);
+	for (CacheEntry *old = cache->buckets[bucket]; old != NULL; old = old->nextInBucket) {
+		if (sameKey(&old->key, key)) {
+			removeEntry(cache, old);
+			break;
+		}
+	}
+
+	while (cache->oldest != NULL && cache->used + entryCost(size) > cache->budget) {
+		removeEntry(cache, cache->oldest);
+		cache->evictions++;
+	}
+
+	*entry = (CacheEntry){.key = *key, .value = copy, .size = size, .nextInBucket = cache->buckets[bucket]};
+	cache->buckets[bucket] = entry;
+	pushNewest(cache, entry);
+	cache->used += entryCost(size);
+	cache->entries++;
+	return 0;
+}
+
+// Ficheiro lido por cada tipo de consulta, para invalidar apenas os resultados que dependem dele
+static FileType queryFile(QueryKind kind) {
+	return kind == QUERY_MEAL_PLAN ? MEAL_PLAN : DIET;
+}
+
+int cacheInvalidate(ResultCache *cache, FileType fileType, int ID, Date date) {
+	int removed = 0;
+
+	if (cache == NULL) {
+		return 0;
+	}
+
+	CacheEntry *entry = cache->newest;
+	while (entry != NULL) {
+		CacheEntry *older = entry->older;
+		if (queryFile(entry->key.kind) == fileType && (entry->key.ID == ID || entry->key.ID == -1) &&
+				dateInPeriod(date, entry->key.period) == 1) {
+			removeEntry(cache, entry);
+			removed++;
+		}
+		entry = older;
+	}
+	cache->invalidations += removed;
+	return removed;
+}
+
+void printCacheStats(const ResultCache *cache) {
+	if (cache == NULL || cache->budget == 0) {
+		printf("Cache de resultados: desativada\n");
+		return;
+	}
+
+	long lookups = cache->hits + cache->misses;
+	printf("Cache de resultados:\n");
+	printf("  Acertos: %ld, Falhas: %ld, Taxa de acerto: %.1f%%\n", cache->hits, cache->misses, lookups > 0 ? 100.0 * cache->hits / lookups : 0.0);
+	printf("  Resultados guardados: %d, Memoria: %zu de %zu bytes\n", cache->entries, cache->used, cache->budget);
+	printf("  Descartados (LRU): %ld, Invalidados: %ld\n", cache->evictions, cache->invalidations);
+}
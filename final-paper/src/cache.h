@@ -0,0 +1,92 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "types.h"
+
+#include <stddef.h>
+
+/**
+ * @file cache.h
+ * @brief Cabeçalho da cache de resultados de consultas.
+ *
+ * Este ficheiro de cabeçalho declara uma cache de resultados com política LRU (o resultado usado há mais
+ * tempo é o primeiro a ser descartado) e um limite de memória configurável. Cada resultado é identificado
+ * pelos parâmetros da consulta ('QueryKey'), pelo que repetir a mesma consulta com o mesmo paciente,
+ * refeição, período e limite evita percorrer novamente os dados.
+ *
+ * Quando são acrescentados registos ao conjunto de dados, 'cacheInvalidate' remove apenas os resultados
+ * que esses registos podem alterar: as consultas sobre o mesmo ficheiro, o mesmo paciente (ou sobre todos
+ * os pacientes) e cujo período contém a data do registo.
+ *
+ * @note Este ficheiro depende das definições das estruturas de dados em 'types.h'.
+ */
+
+/**
+ * @brief Cria uma cache de resultados vazia.
+ *
+ * @param budget Memória máxima, em bytes, ocupada pelos resultados guardados. Com 0 a cache fica desativada.
+ *
+ * @return Retorna um ponteiro para a nova cache, ou NULL se não houver memória.
+ */
+ResultCache *createCache(size_t budget);
+
+/**
+ * @brief Liberta uma cache e todos os resultados guardados.
+ *
+ * @param cache Ponteiro para a cache (pode ser NULL).
+ */
+void freeCache(ResultCache *cache);
+
+/**
+ * @brief Procura o resultado de uma consulta na cache.
+ *
+ * Em caso de sucesso, o resultado passa a ser o mais recentemente usado. A função atualiza os
+ * contadores de acertos e falhas apresentados por 'printCacheStats'.
+ *
+ * @param cache Ponteiro para a cache (pode ser NULL).
+ * @param key Parâmetros da consulta.
+ * @param size Recebe o tamanho, em bytes, do resultado encontrado.
+ *
+ * @return Retorna um ponteiro para o resultado guardado, ou NULL se não existir. O ponteiro só é válido
+ *         até à próxima alteração da cache.
+ */
+const void *cacheLookup(ResultCache *cache, const QueryKey *key, size_t *size);
+
+/**
+ * @brief Guarda o resultado de uma consulta na cache.
+ *
+ * Se a memória ocupada ultrapassar o limite, são descartados os resultados usados há mais tempo.
+ * Um resultado maior do que o próprio limite não é guardado.
+ *
+ * @param cache Ponteiro para a cache (pode ser NULL).
+ * @param key Parâmetros da consulta.
+ * @param value Resultado a guardar (é copiado).
+ * @param size Tamanho, em bytes, do resultado.
+ *
+ * @return Retorna 0 se o resultado foi guardado, ou -1 caso contrário.
+ */
+int cacheStore(ResultCache *cache, const QueryKey *key, const void *value, size_t size);
+
+/**
+ * @brief Remove da cache os resultados afetados por um novo registo.
+ *
+ * São removidos os resultados das consultas que leem o ficheiro 'fileType', que dizem respeito ao
+ * paciente 'ID' ou a todos os pacientes, e cujo período inclui 'date'.
+ *
+ * @param cache Ponteiro para a cache (pode ser NULL).
+ * @param fileType Ficheiro a que pertence o novo registo.
+ * @param ID Identificador do paciente do novo registo.
+ * @param date Data do novo registo.
+ *
+ * @return Retorna o número de resultados removidos.
+ */
+int cacheInvalidate(ResultCache *cache, FileType fileType, int ID, Date date);
+
+/**
+ * @brief Imprime as estatísticas da cache: acertos, falhas, taxa de acerto e memória ocupada.
+ *
+ * @param cache Ponteiro para a cache (pode ser NULL).
+ */
+void printCacheStats(const ResultCache *cache);
+
+#endif // CACHE_H
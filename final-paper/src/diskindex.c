@@ -0,0 +1,383 @@
+#include "diskindex.h"
+#include "utils.h"
+#include "schema.h"
+#include "memtrack.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+/**
+ * @file diskindex.c
+ * @brief Implementação do índice persistente de pacientes em disco.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'diskindex.h'. O índice é construído
+ * a partir de pares (chave, posição) de todas as linhas, ordenados por chave: cada grupo de pares com a mesma
+ * chave dá origem a uma entrada da tabela e a uma sequência contígua de posições.
+ */
+
+#define INDEX_FILE "patientIndex.bin"
+#define INDEX_MAGIC "NUTRIIDX"
+#define INDEX_VERSION 1
+
+// Os dois ficheiros indexados, pela ordem usada no cabecalho
+static const FileType indexedFiles[] = {DIET, MEAL_PLAN};
+static const char *indexedNames[] = {"diet.txt", "mealPlan.txt"};
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t numSlots;
+	uint64_t dataSizes[2];
+	int64_t dataTimes[2];
+	uint64_t numPostings;
+	uint32_t reserved;
+	uint32_t checksum;
+} IndexHeader;
+
+// Entrada da tabela; 'fileType' igual a -1 marca uma posicao vazia
+typedef struct {
+	int32_t fileType;
+	int32_t ID;
+	uint32_t count;
+	uint32_t checksum;
+	uint64_t first;
+	char meal[56];
+} IndexSlot;
+
+struct DiskIndex {
+	char paths[2][512];
+	void *map;
+	size_t size;
+	const IndexHeader *header;
+	const IndexSlot *slots;
+	const uint64_t *postings;
+};
+
+// Par (chave, posicao) de uma linha, usado apenas durante a construcao
+typedef struct {
+	int fileType;
+	int ID;
+	char meal[50];
+	uint64_t offset;
+} IndexEntry;
+
+static int compareIndexEntries(const void *a, const void *b) {
+	const IndexEntry *first = (const IndexEntry *)a;
+	const IndexEntry *second = (const IndexEntry *)b;
+
+	if (first->fileType != second->fileType) {
+		return (first->fileType > second->fileType) - (first->fileType < second->fileType);
+	}
+	if (first->ID != second->ID) {
+		return (first->ID > second->ID) - (first->ID < second->ID);
+	}
+	int meal = strcmp(first->meal, second->meal);
+	if (meal != 0) {
+		return meal;
+	}
+	return (first->offset > second->offset) - (first->offset < second->offset);
+}
+
+static int sameIndexKey(const IndexEntry *first, const IndexEntry *second) {
+	return first->fileType == second->fileType && first->ID == second->ID && !strcmp(first->meal, second->meal);
+}
+
+static unsigned hashIndexKey(int fileType, int ID, const char *meal) {
+	unsigned hash = 2166136261u;
+
+	hash = (hash ^ (unsigned)fileType) * 16777619u;
+	hash = (hash ^ (unsigned)ID) * 16777619u;
+	for (const char *c = meal; *c != '\0'; c++) {
+		hash = (hash ^ (unsigned char)*c) * 16777619u;
+	}
+	return hash;
+}
+
+static uint32_t slotChecksum(const IndexSlot *slot, const uint64_t *postings) {
+	IndexSlot copy = *slot;
+	copy.checksum = 0;
+
+	uLong crc = crc32(0L, (const Bytef *)&copy, sizeof(IndexSlot));
+	return crc32(crc, (const Bytef *)(postings + slot->first), sizeof(uint64_t) * slot->count);
+}
+
+static uint32_t headerChecksum(const IndexHeader *header) {
+	return crc32(0L, (const Bytef *)header, offsetof(IndexHeader, checksum));
+}
+
+// Acrescenta as chaves (paciente) e (paciente, refeicao) de cada linha de um ficheiro de dados
+static int collectEntries(char *path, FileType fileType, IndexEntry **entries, int *count, int *capacity, struct stat *info) {
+	FILE *file = fopen(path, "r");
+	char line[500];
+	uint64_t offset = 0;
+
+	if (file == NULL || fstat(fileno(file), info) != 0) {
+		if (file != NULL) {
+			fclose(file);
+		}
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), file)) {
+		uint64_t start = offset;
+		int ID;
+		char meal[50];
+		offset += strlen(line);
+
+		if (fileType == DIET) {
+			Diet diet;
+			initializeDiets(&diet, 1);
+			parseLine(line, &diet, 0, DIET);
+			ID = diet.ID;
+			strcpy(meal, diet.meal);
+		} else {
+			MealPlan mealPlan;
+			initializeMealPlans(&mealPlan, 1);
+			parseLine(line, &mealPlan, 0, MEAL_PLAN);
+			ID = mealPlan.ID;
+			strcpy(meal, mealPlan.meal);
+		}
+		if (ID == -1) {
+			continue;
+		}
+
+		if (*count + 2 > *capacity) {
+			int grown = *capacity > 0 ? *capacity * 2 : 1024;
+			IndexEntry *resized = memRealloc(MEM_INDEX, *entries, sizeof(IndexEntry) * grown);
+			if (resized == NULL) {
+				fclose(file);
+				return -1;
+			}
+			*entries = resized;
+			*capacity = grown;
+		}
+		(*entries)[*count] = (IndexEntry){.fileType = fileType, .ID = ID, .meal = "", .offset = start};
+		(*entries)[*count + 1] = (IndexEntry){.fileType = fileType, .ID = ID, .offset = start};
+		strcpy((*entries)[*count + 1].meal, meal);
+		*count += 2;
+	}
+	fclose(file);
+	return 0;
+}
+
+int buildDiskIndex(char *directory) {
+	IndexEntry *entries = NULL;
+	int count = 0, capacity = 0, keys = 0;
+	IndexHeader header = {.magic = INDEX_MAGIC, .version = INDEX_VERSION};
+
+	for (int i = 0; i < 2; i++) {
+		char path[512];
+		struct stat info;
+		snprintf(path, sizeof(path), "%s/%s", directory, indexedNames[i]);
+		if (collectEntries(path, indexedFiles[i], &entries, &count, &capacity, &info) != 0) {
+			printf("Nao foi possivel ler %s para construir o indice.\n", path);
+			memFree(entries);
+			return -1;
+		}
+		header.dataSizes[i] = info.st_size;
+		header.dataTimes[i] = info.st_mtime;
+	}
+	qsort(entries, count, sizeof(IndexEntry), compareIndexEntries);
+
+	for (int i = 0; i < count; i++) {
+		keys += i == 0 || !sameIndexKey(&entries[i], &entries[i - 1]);
+	}
+	header.numSlots = 1;
+	while (header.numSlots < 2u * keys) {
+		header.numSlots *= 2;
+	}
+
+	IndexSlot *slots = memAlloc(MEM_INDEX, sizeof(IndexSlot) * header.numSlots);
+	uint64_t *postings = memAlloc(MEM_INDEX, sizeof(uint64_t) * (count > 0 ? count : 1));
+	if (slots == NULL || postings == NULL) {
+		printf("Memoria insuficiente.\n");
+		memFree(entries);
+		memFree(slots);
+		memFree(postings);
+		return -1;
+	}
+	for (uint32_t i = 0; i < header.numSlots; i++) {
+		slots[i] = (IndexSlot){.fileType = -1};
+	}
+
+	// Cada grupo de pares com a mesma chave ocupa posicoes contiguas da lista e uma entrada da tabela
+	for (int i = 0, group = 0; i <= count; i++) {
+		if (i < count && sameIndexKey(&entries[i], &entries[group])) {
+			continue;
+		}
+		if (i > group) {
+			IndexSlot slot = {.fileType = entries[group].fileType, .ID = entries[group].ID, .count = i - group, .first = group};
+			strcpy(slot.meal, entries[group].meal);
+			for (int j = group; j < i; j++) {
+				postings[j] = entries[j].offset;
+			}
+			slot.checksum = slotChecksum(&slot, postings);
+
+			unsigned position = hashIndexKey(slot.fileType, slot.ID, slot.meal) & (header.numSlots - 1);
+			while (slots[position].fileType != -1) {
+				position = (position + 1) & (header.numSlots - 1);
+			}
+			slots[position] = slot;
+		}
+		group = i;
+	}
+	memFree(entries);
+	header.numPostings = count;
+	header.checksum = headerChecksum(&header);
+
+	char path[512], temporary[520];
+	snprintf(path, sizeof(path), "%s/%s", directory, INDEX_FILE);
+	snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+	FILE *file = fopen(temporary, "wb");
+	int status = file != NULL &&
+		fwrite(&header, sizeof(IndexHeader), 1, file) == 1 &&
+		fwrite(slots, sizeof(IndexSlot), header.numSlots, file) == header.numSlots &&
+		fwrite(postings, sizeof(uint64_t), count, file) == (size_t)count ? 0 : -1;
+	if (file != NULL) {
+		if (fflush(file) != 0 || fsync(fileno(file)) != 0) {
+			status = -1;
+		}
+		if (fclose(file) != 0) {
+			status = -1;
+		}
+	}
+	if (status == 0 && rename(temporary, path) != 0) {
+		status = -1;
+	}
+	if (status != 0) {
+		printf("Nao foi possivel escrever o indice %s.\n", path);
+		remove(temporary);
+	}
+	memFree(slots);
+	memFree(postings);
+	return status == 0 ? keys : -1;
+}
+
+DiskIndex *openDiskIndex(char *directory) {
+	char path[512];
+	struct stat info;
+
+	snprintf(path, sizeof(path), "%s/%s", directory, INDEX_FILE);
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		return NULL;
+	}
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(IndexHeader)) {
+		close(fd);
+		return NULL;
+	}
+	size_t size = info.st_size;
+	void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return NULL;
+	}
+
+	DiskIndex *index = memCalloc(MEM_INDEX, 1, sizeof(DiskIndex));
+	const IndexHeader *header = map;
+	if (index == NULL || memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+			header->version != INDEX_VERSION || header->checksum != headerChecksum(header) ||
+			size != sizeof(IndexHeader) + sizeof(IndexSlot) * (uint64_t)header->numSlots + sizeof(uint64_t) * header->numPostings) {
+		printf("Indice em disco invalido: %s\n", path);
+		munmap(map, size);
+		memFree(index);
+		return NULL;
+	}
+
+	// O indice so serve enquanto os ficheiros de dados estiverem exatamente como quando foi construido
+	for (int i = 0; i < 2; i++) {
+		snprintf(index->paths[i], sizeof(index->paths[i]), "%s/%s", directory, indexedNames[i]);
+		if (stat(index->paths[i], &info) != 0 || (uint64_t)info.st_size != header->dataSizes[i] || info.st_mtime != header->dataTimes[i]) {
+			printf("Indice em disco desatualizado; reconstrua-o com --build-index.\n");
+			munmap(map, size);
+			memFree(index);
+			return NULL;
+		}
+	}
+
+	index->map = map;
+	index->size = size;
+	index->header = header;
+	index->slots = (const IndexSlot *)(header + 1);
+	index->postings = (const uint64_t *)(index->slots + header->numSlots);
+	return index;
+}
+
+void closeDiskIndex(DiskIndex *index) {
+	if (index == NULL) {
+		return;
+	}
+	munmap(index->map, index->size);
+	memFree(index);
+}
+
+static const IndexSlot *findSlot(const DiskIndex *index, FileType fileType, int ID, const char *meal) {
+	uint32_t mask = index->header->numSlots - 1;
+	unsigned position = hashIndexKey(fileType, ID, meal) & mask;
+
+	while (index->slots[position].fileType != -1) {
+		const IndexSlot *slot = &index->slots[position];
+		if (slot->fileType == (int32_t)fileType && slot->ID == ID && !strncmp(slot->meal, meal, sizeof(slot->meal))) {
+			return slot;
+		}
+		position = (position + 1) & mask;
+	}
+	return NULL;
+}
+
+int countIndexedRows(const DiskIndex *index, FileType fileType, int ID, const char *meal) {
+	const IndexSlot *slot = findSlot(index, fileType, ID, meal);
+	return slot != NULL ? (int)slot->count : 0;
+}
+
+int readIndexedRows(const DiskIndex *index, FileType fileType, int ID, const char *meal, void **rows) {
+	int file = fileType == DIET ? 0 : 1;
+	const IndexSlot *slot = findSlot(index, fileType, ID, meal);
+	int count = slot != NULL ? slot->count : 0;
+	size_t size = fileType == DIET ? sizeof(Diet) : sizeof(MealPlan);
+
+	if (slot != NULL && (slot->first + slot->count > index->header->numPostings || slotChecksum(slot, index->postings) != slot->checksum)) {
+		printf("Indice em disco corrompido.\n");
+		return -1;
+	}
+	*rows = memAlloc(MEM_QUERY, size * (count > 0 ? count : 1));
+	int fd = open(index->paths[file], O_RDONLY);
+	if (*rows == NULL || fd == -1) {
+		memFree(*rows);
+		*rows = NULL;
+		if (fd != -1) {
+			close(fd);
+		}
+		return -1;
+	}
+	if (fileType == DIET) {
+		initializeDiets(*rows, count);
+	} else {
+		initializeMealPlans(*rows, count);
+	}
+
+	// Cada linha e lida diretamente da sua posicao; as linhas de dados tem sempre menos de 500 caracteres
+	for (int i = 0; i < count; i++) {
+		char line[500];
+		ssize_t bytes = pread(fd, line, sizeof(line) - 1, index->postings[slot->first + i]);
+		if (bytes < 0) {
+			close(fd);
+			memFree(*rows);
+			*rows = NULL;
+			return -1;
+		}
+		line[bytes] = '\0';
+		line[strcspn(line, "\n")] = '\0';
+		parseLine(line, *rows, i, fileType);
+	}
+	close(fd);
+	return count;
+}
@@ -0,0 +1,89 @@
+#ifndef DISKINDEX_H
+#define DISKINDEX_H
+
+#include "types.h"
+
+/**
+ * @file diskindex.h
+ * @brief Cabeçalho do índice persistente de pacientes, guardado em disco ao lado dos ficheiros de dados.
+ *
+ * Este ficheiro de cabeçalho declara um índice em disco que associa cada paciente, e cada par (paciente,
+ * refeição), às posições (em bytes) das suas linhas em 'diet.txt' e 'mealPlan.txt'. O índice é uma tabela de
+ * dispersão com endereçamento aberto escrita no ficheiro 'patientIndex.bin' e aberta com 'mmap', pelo que um
+ * processo acabado de arrancar consegue responder a uma consulta sobre um único paciente lendo apenas o
+ * cabeçalho, as poucas posições da tabela percorridas e as linhas desse paciente, sem ler os ficheiros inteiros.
+ *
+ * O ficheiro tem três partes:
+ * - Cabeçalho: identificador e versão do formato, tamanho e data de modificação dos ficheiros de dados no
+ *   momento da construção e uma soma de verificação (CRC-32) do próprio cabeçalho.
+ * - Tabela: entradas de tamanho fixo com a chave (tipo de ficheiro, ID, refeição), o número de linhas, a
+ *   posição da primeira dessas linhas na lista de posições e uma soma de verificação da entrada e das suas posições.
+ * - Posições: as posições de cada linha nos ficheiros de dados, agrupadas por chave e por ordem do ficheiro.
+ *
+ * As somas de verificação de cada entrada são verificadas apenas quando essa entrada é usada, para que uma
+ * consulta não tenha de ler o índice inteiro. Se um ficheiro de dados for alterado depois da construção do
+ * índice (por exemplo, pelo caminho de escrita), o índice deixa de ser usado até ser construído de novo.
+ *
+ * @note O índice é escrito na ordem de bytes da máquina que o constrói. Ficheiros de dados comprimidos não
+ *       podem ser indexados, porque as posições das linhas só existem no texto descomprimido.
+ */
+
+/**
+ * @brief Constrói o índice em disco de uma diretoria de dados, substituindo o anterior.
+ *
+ * O índice é escrito primeiro num ficheiro temporário, que depois substitui 'patientIndex.bin' de uma só vez,
+ * pelo que um processo que abra o índice nunca vê um ficheiro escrito a meio.
+ *
+ * @param directory Diretoria onde se encontram 'diet.txt' e 'mealPlan.txt'.
+ *
+ * @return Retorna o número de chaves do índice, ou -1 em caso de erro.
+ */
+int buildDiskIndex(char *directory);
+
+/**
+ * @brief Abre com 'mmap' o índice em disco de uma diretoria de dados.
+ *
+ * @param directory Diretoria onde se encontram os ficheiros de dados e o índice.
+ *
+ * @return Retorna um ponteiro para o índice, ou NULL se o índice não existir, tiver outra versão, estiver
+ *         corrompido ou já não corresponder aos ficheiros de dados.
+ */
+DiskIndex *openDiskIndex(char *directory);
+
+/**
+ * @brief Fecha o índice em disco.
+ *
+ * @param index Ponteiro para o índice (pode ser NULL).
+ */
+void closeDiskIndex(DiskIndex *index);
+
+/**
+ * @brief Lê as linhas de um paciente a partir do índice em disco.
+ *
+ * As linhas são lidas diretamente das posições guardadas no índice e interpretadas com 'parseLine', pelo que
+ * os registos devolvidos são iguais aos que seriam lidos por 'readFile'.
+ *
+ * @param index Ponteiro para o índice.
+ * @param fileType Ficheiro a consultar (DIET ou MEAL_PLAN).
+ * @param ID Identificador do paciente.
+ * @param meal Refeição, ou "" para todas as refeições do paciente.
+ * @param rows Recebe um array novo de 'Diet' ou 'MealPlan' (conforme 'fileType'), que deve ser libertado com 'free'.
+ *
+ * @return Retorna o número de registos lidos, ou -1 se a entrada estiver corrompida, não houver memória ou não
+ *         for possível ler o ficheiro de dados.
+ */
+int readIndexedRows(const DiskIndex *index, FileType fileType, int ID, const char *meal, void **rows);
+
+/**
+ * @brief Devolve o número de linhas de um paciente guardadas no índice em disco, sem as ler.
+ *
+ * @param index Ponteiro para o índice.
+ * @param fileType Ficheiro a consultar (DIET ou MEAL_PLAN).
+ * @param ID Identificador do paciente.
+ * @param meal Refeição, ou "" para todas as refeições do paciente.
+ *
+ * @return Retorna o número de linhas do paciente e da refeição (0 se não existirem).
+ */
+int countIndexedRows(const DiskIndex *index, FileType fileType, int ID, const char *meal);
+
+#endif // DISKINDEX_H
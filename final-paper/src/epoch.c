@@ -0,0 +1,114 @@
+#include "epoch.h"
+#include "memtrack.h"
+
+#include <stdlib.h>
+
+/**
+ * @file epoch.c
+ * @brief Implementação da libertação de memória por épocas.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'epoch.h'. Cada thread leitora recebe uma
+ * posição fixa no array 'readerEpochs' na primeira vez que entra; a posição contém a época em que o leitor entrou,
+ * ou 0 quando está fora de uma secção de leitura.
+ *
+ * Em 'epochPublish', os blocos retirados desde a publicação anterior recebem a época atual 'e' e a época global
+ * passa a 'e + 1'. Um leitor que registe a época 'e + 1' ou posterior leu a época global depois dessa mudança, e
+ * portanto depois de a nova versão estar publicada, pelo que já não pode chegar aos blocos da época 'e'. As
+ * operações sobre a época global e sobre as posições dos leitores são sequencialmente consistentes, o que garante
+ * também que um leitor que ainda não tinha registado a sua época quando a escrita a consultou vê a nova versão.
+ */
+
+// Bloco retirado e epoca da publicacao que o tornou inacessivel
+typedef struct {
+	void *pointer;
+	unsigned long epoch;
+} RetiredBlock;
+
+static unsigned long globalEpoch = 1;
+static unsigned long readerEpochs[EPOCH_MAX_READERS];
+static int numReaders = 0;
+static __thread int readerSlot = -1;
+
+// Apenas usados pela thread de escrita
+static void **pending = NULL;
+static int numPending = 0, pendingCapacity = 0;
+static RetiredBlock *retired = NULL;
+static int numRetired = 0, retiredCapacity = 0;
+
+int epochEnter(void) {
+	if (readerSlot == -1) {
+		int slot = __atomic_fetch_add(&numReaders, 1, __ATOMIC_RELAXED);
+		if (slot >= EPOCH_MAX_READERS) {
+			return -1;
+		}
+		readerSlot = slot;
+	}
+	unsigned long epoch = __atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&readerEpochs[readerSlot], epoch, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+void epochExit(void) {
+	if (readerSlot != -1) {
+		__atomic_store_n(&readerEpochs[readerSlot], 0, __ATOMIC_RELEASE);
+	}
+}
+
+void epochRetire(void *pointer) {
+	if (pointer == NULL) {
+		return;
+	}
+	if (numPending == pendingCapacity) {
+		int capacity = pendingCapacity > 0 ? pendingCapacity * 2 : 16;
+		void **grown = memRealloc(MEM_INGEST, pending, sizeof(void *) * capacity);
+		if (grown == NULL) {
+			return;
+		}
+		pending = grown;
+		pendingCapacity = capacity;
+	}
+	pending[numPending++] = pointer;
+}
+
+void epochPublish(void) {
+	unsigned long epoch = __atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST);
+
+	if (numRetired + numPending > retiredCapacity) {
+		int capacity = retiredCapacity > 0 ? retiredCapacity : 16;
+		while (capacity < numRetired + numPending) {
+			capacity *= 2;
+		}
+		RetiredBlock *grown = memRealloc(MEM_INGEST, retired, sizeof(RetiredBlock) * capacity);
+		if (grown == NULL) {
+			// Os blocos continuam pendentes e sao registados na proxima publicacao
+			return;
+		}
+		retired = grown;
+		retiredCapacity = capacity;
+	}
+	for (int i = 0; i < numPending; i++) {
+		retired[numRetired++] = (RetiredBlock){.pointer = pending[i], .epoch = epoch};
+	}
+	numPending = 0;
+	__atomic_store_n(&globalEpoch, epoch + 1, __ATOMIC_SEQ_CST);
+
+	// A epoca mais antiga entre os leitores ativos; sem leitores, todos os blocos retirados podem ser libertados
+	unsigned long oldest = epoch + 1;
+	int readers = __atomic_load_n(&numReaders, __ATOMIC_RELAXED);
+	for (int i = 0; i < readers && i < EPOCH_MAX_READERS; i++) {
+		unsigned long readerEpoch = __atomic_load_n(&readerEpochs[i], __ATOMIC_SEQ_CST);
+		if (readerEpoch != 0 && readerEpoch < oldest) {
+			oldest = readerEpoch;
+		}
+	}
+
+	int kept = 0;
+	for (int i = 0; i < numRetired; i++) {
+		if (retired[i].epoch < oldest) {
+			memFree(retired[i].pointer);
+		} else {
+			retired[kept++] = retired[i];
+		}
+	}
+	numRetired = kept;
+}
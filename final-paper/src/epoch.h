@@ -0,0 +1,59 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+/**
+ * @file epoch.h
+ * @brief Cabeçalho da libertação de memória por épocas, para leitores concorrentes com uma única escrita.
+ *
+ * Este ficheiro de cabeçalho declara um esquema de libertação de memória por épocas (epoch-based reclamation).
+ * Os leitores percorrem os dados publicados sem qualquer bloqueio; a escrita nunca altera o que já foi
+ * publicado, substitui-o por uma versão nova e entrega a versão antiga a 'epochRetire':
+ * - Cada leitor, antes de ler, regista a época global em que entrou ('epochEnter') e retira esse registo quando
+ *   termina ('epochExit'). Estas duas operações são apenas escritas atómicas na posição do leitor.
+ * - A memória retirada só é libertada quando todos os leitores ativos entraram numa época posterior à
+ *   publicação que a tornou inacessível. Um leitor lento atrasa apenas a libertação, nunca a escrita.
+ *
+ * A escrita deve ser feita por uma única thread de cada vez: 'epochRetire' e 'epochPublish' não podem ser
+ * chamadas em simultâneo. As threads criadas por um leitor e terminadas antes de 'epochExit' ficam protegidas
+ * pela época desse leitor.
+ */
+
+/**
+ * @brief Número máximo de threads leitoras diferentes ao longo da execução do programa.
+ */
+#define EPOCH_MAX_READERS 64
+
+/**
+ * @brief Entra numa secção de leitura: os dados publicados lidos a partir daqui não são libertados até 'epochExit'.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se já existirem EPOCH_MAX_READERS threads leitoras.
+ */
+int epochEnter(void);
+
+/**
+ * @brief Sai da secção de leitura iniciada por 'epochEnter'.
+ */
+void epochExit(void);
+
+/**
+ * @brief Entrega à libertação por épocas um bloco de memória que vai deixar de estar publicado.
+ *
+ * O bloco pode ainda estar acessível na versão publicada atual; só é considerado inacessível na próxima
+ * chamada a 'epochPublish', e é libertado com 'free' quando nenhum leitor o puder ainda estar a ler.
+ *
+ * @param pointer Bloco a libertar (pode ser NULL).
+ *
+ * @note Se não houver memória para registar o bloco, este nunca é libertado: perder o bloco é seguro, libertá-lo
+ *       enquanto um leitor o usa não seria.
+ */
+void epochRetire(void *pointer);
+
+/**
+ * @brief Indica que uma nova versão dos dados foi publicada e liberta a memória que já nenhum leitor usa.
+ *
+ * Deve ser chamada depois de a nova versão estar visível aos leitores. Os blocos entregues a 'epochRetire'
+ * desde a chamada anterior deixam de ser acessíveis a leitores que entrem a partir daqui.
+ */
+void epochPublish(void);
+
+#endif // EPOCH_H
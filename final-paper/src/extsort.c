@@ -0,0 +1,283 @@
+#include "extsort.h"
+#include "utils.h"
+#include "stream.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file extsort.c
+ * @brief Implementação da ordenação externa de ficheiros de dietas.
+ *
+ * Este ficheiro contém a implementação da função declarada em 'extsort.h'. Os registos são lidos com
+ * 'parseLine', no mesmo formato de 'readFile', e guardados nas sequências temporárias em binário para
+ * que a fusão não tenha de voltar a interpretar texto.
+ */
+
+#define IO_BUFFER_SIZE (1 << 20)
+
+// Registo a ordenar: a dieta, a data em dias (chave ja calculada) e a posicao original (desempate estavel)
+typedef struct {
+	Diet diet;
+	int day;
+	long sequence;
+} SortRecord;
+
+// Bloco de registos entregue a uma thread, que o ordena e escreve numa sequencia temporaria
+typedef struct {
+	SortRecord *records;
+	int count;
+	char path[600];
+	int status;
+} RunTask;
+
+// Leitor de uma sequencia durante a fusao
+typedef struct {
+	FILE *file;
+	SortRecord current;
+	int done;
+} RunReader;
+
+static int compareSortRecords(const void *a, const void *b) {
+	const SortRecord *first = (const SortRecord *)a;
+	const SortRecord *second = (const SortRecord *)b;
+
+	if (first->diet.ID != second->diet.ID) {
+		return (first->diet.ID > second->diet.ID) - (first->diet.ID < second->diet.ID);
+	}
+	if (first->day != second->day) {
+		return (first->day > second->day) - (first->day < second->day);
+	}
+	return (first->sequence > second->sequence) - (first->sequence < second->sequence);
+}
+
+static void *writeRun(void *arg) {
+	RunTask *task = (RunTask *)arg;
+
+	qsort(task->records, task->count, sizeof(SortRecord), compareSortRecords);
+
+	task->status = -1;
+	FILE *file = fopen(task->path, "wb");
+	if (file == NULL) {
+		return NULL;
+	}
+	setvbuf(file, NULL, _IOFBF, IO_BUFFER_SIZE);
+	if (fwrite(task->records, sizeof(SortRecord), task->count, file) == (size_t)task->count) {
+		task->status = 0;
+	}
+	if (fclose(file) != 0) {
+		task->status = -1;
+	}
+	return NULL;
+}
+
+// Le ate 'capacity' registos do ficheiro de entrada; devolve quantos foram lidos
+static int readBlock(InputStream *input, SortRecord *records, int capacity, long *sequence) {
+	char line[500];
+	int count = 0;
+
+	while (count < capacity && readInputLine(input, line, sizeof(line))) {
+		if (line[strspn(line, " \t\r\n")] == '\0') {
+			continue;
+		}
+		Diet *diet = &records[count].diet;
+		*diet = (Diet){.ID = -1, .date = {0}, .meal = "", .food = "", .calories = 0};
+		parseLine(line, diet, 0, DIET);
+		records[count].day = dateToDays(diet->date);
+		records[count].sequence = (*sequence)++;
+		count++;
+	}
+	return count;
+}
+
+// Fase 1: produz as sequencias ordenadas, 'threads' blocos de cada vez
+static int generateRuns(InputStream *input, char *output, size_t memoryBudget, int threads, long *total) {
+	int blockSize = memoryBudget / threads / sizeof(SortRecord);
+	int runs = 0, status = 0;
+	RunTask *tasks = calloc(threads, sizeof(RunTask));
+	pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+	int *started = malloc(sizeof(int) * threads);
+
+	if (blockSize < 1) {
+		blockSize = 1;
+	}
+	if (tasks == NULL || ids == NULL || started == NULL) {
+		free(tasks);
+		free(ids);
+		free(started);
+		return -1;
+	}
+	for (int i = 0; i < threads; i++) {
+		tasks[i].records = malloc(sizeof(SortRecord) * blockSize);
+		if (tasks[i].records == NULL) {
+			status = -1;
+		}
+	}
+
+	*total = 0;
+	while (status == 0) {
+		int filled = 0;
+		for (int i = 0; i < threads; i++) {
+			tasks[i].count = readBlock(input, tasks[i].records, blockSize, total);
+			if (tasks[i].count == 0) {
+				break;
+			}
+			snprintf(tasks[i].path, sizeof(tasks[i].path), "%s.run%d", output, runs++);
+			// Um bloco sem thread e escrito pela thread atual
+			started[i] = pthread_create(&ids[i], NULL, writeRun, &tasks[i]) == 0;
+			if (!started[i]) {
+				writeRun(&tasks[i]);
+			}
+			filled++;
+		}
+		for (int i = 0; i < filled; i++) {
+			if (started[i]) {
+				pthread_join(ids[i], NULL);
+			}
+			if (tasks[i].status != 0) {
+				status = -1;
+			}
+		}
+		if (filled < threads) {
+			break;
+		}
+	}
+
+	for (int i = 0; i < threads; i++) {
+		free(tasks[i].records);
+	}
+	free(tasks);
+	free(ids);
+	free(started);
+	return status == 0 ? runs : -1;
+}
+
+static void advanceReader(RunReader *reader) {
+	reader->done = fread(&reader->current, sizeof(SortRecord), 1, reader->file) != 1;
+}
+
+// Compara dois leitores; um leitor terminado perde sempre
+static int readerBefore(RunReader *readers, int first, int second) {
+	if (readers[first].done || readers[second].done) {
+		return !readers[first].done;
+	}
+	return compareSortRecords(&readers[first].current, &readers[second].current) < 0;
+}
+
+// Volta a disputar os jogos desde a folha 'reader' ate a raiz; tree[0] fica com o vencedor
+static void replayLoserTree(int *tree, RunReader *readers, int k, int reader) {
+	int winner = reader;
+
+	for (int node = (reader + k) / 2; node > 0; node /= 2) {
+		if (tree[node] == -1) {
+			tree[node] = winner;
+			return;
+		}
+		if (readerBefore(readers, tree[node], winner)) {
+			int loser = winner;
+			winner = tree[node];
+			tree[node] = loser;
+		}
+	}
+	tree[0] = winner;
+}
+
+static void writeRecord(FILE *output, const Diet *diet, int binary) {
+	if (binary) {
+		fwrite(diet, sizeof(Diet), 1, output);
+	} else {
+		fprintf(output, "%04d; %02d-%02d-%04d; %s;%s; %d cal\n", diet->ID, diet->date.day, diet->date.month, diet->date.year, diet->meal, diet->food, diet->calories);
+	}
+}
+
+// Fase 2: funde as k sequencias com uma arvore de perdedores
+static int mergeRuns(char *output, int runs, size_t memoryBudget, int binary) {
+	RunReader *readers = calloc(runs > 0 ? runs : 1, sizeof(RunReader));
+	int *tree = malloc(sizeof(int) * (runs > 0 ? runs : 1));
+	size_t readBuffer = memoryBudget / (runs + 1);
+	int status = 0;
+
+	FILE *file = fopen(output, binary ? "wb" : "w");
+	if (readers == NULL || tree == NULL || file == NULL) {
+		free(readers);
+		free(tree);
+		if (file != NULL) {
+			fclose(file);
+		}
+		return -1;
+	}
+	setvbuf(file, NULL, _IOFBF, IO_BUFFER_SIZE);
+	if (readBuffer < 4096) {
+		readBuffer = 4096;
+	}
+
+	for (int i = 0; i < runs; i++) {
+		char path[600];
+		snprintf(path, sizeof(path), "%s.run%d", output, i);
+		readers[i].file = fopen(path, "rb");
+		if (readers[i].file == NULL) {
+			readers[i].done = 1;
+			status = -1;
+			continue;
+		}
+		setvbuf(readers[i].file, NULL, _IOFBF, readBuffer);
+		advanceReader(&readers[i]);
+	}
+
+	for (int i = 0; i < runs; i++) {
+		tree[i] = -1;
+	}
+	for (int i = 0; i < runs; i++) {
+		replayLoserTree(tree, readers, runs, i);
+	}
+
+	while (runs > 0 && !readers[tree[0]].done) {
+		int winner = tree[0];
+		writeRecord(file, &readers[winner].current.diet, binary);
+		advanceReader(&readers[winner]);
+		replayLoserTree(tree, readers, runs, winner);
+	}
+
+	for (int i = 0; i < runs; i++) {
+		char path[600];
+		if (readers[i].file != NULL) {
+			fclose(readers[i].file);
+		}
+		snprintf(path, sizeof(path), "%s.run%d", output, i);
+		remove(path);
+	}
+	if (fclose(file) != 0) {
+		status = -1;
+	}
+	free(readers);
+	free(tree);
+	return status;
+}
+
+long externalSortDiets(char *input, char *output, size_t memoryBudget, int threads, int binary) {
+	long total;
+
+	InputStream *file = openInputStream(input);
+	if (file == NULL) {
+		printf("Nao foi possivel abrir o ficheiro.\n");
+		return -1;
+	}
+
+	int runs = generateRuns(file, output, memoryBudget, threads > 0 ? threads : 1, &total);
+	// Um ficheiro comprimido corrompido so e detetado no fim; as sequencias ja escritas sao descartadas
+	if (closeInputStream(file) != 0 && runs >= 0) {
+		for (int i = 0; i < runs; i++) {
+			char path[600];
+			snprintf(path, sizeof(path), "%s.run%d", output, i);
+			remove(path);
+		}
+		runs = -1;
+	}
+	if (runs < 0 || mergeRuns(output, runs, memoryBudget, binary) != 0) {
+		printf("Erro ao ordenar o ficheiro.\n");
+		return -1;
+	}
+	return total;
+}
@@ -0,0 +1,39 @@
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include "types.h"
+
+#include <stddef.h>
+
+/**
+ * @file extsort.h
+ * @brief Cabeçalho da ordenação externa de ficheiros de dietas.
+ *
+ * Este ficheiro de cabeçalho declara a ordenação externa (external merge sort) de ficheiros no formato de
+ * 'diet.txt' por (paciente, data), para ficheiros que não cabem em memória. A ordenação decorre em duas fases:
+ * - Geração de sequências: o ficheiro é lido sequencialmente em blocos que respeitam o limite de memória;
+ *   cada bloco é ordenado por uma thread e escrito num ficheiro temporário (uma sequência ordenada).
+ * - Fusão: as sequências são lidas em simultâneo e fundidas numa única passagem com uma árvore de perdedores
+ *   (loser tree), que escolhe o próximo registo com log2(k) comparações para k sequências.
+ *
+ * Todas as leituras e escritas são sequenciais e usam buffers grandes.
+ *
+ * @note Registos com a mesma chave mantêm a ordem do ficheiro original (a ordenação é estável).
+ */
+
+/**
+ * @brief Ordena um ficheiro de dietas por (paciente, data) com memória limitada.
+ *
+ * @param input Caminho do ficheiro de entrada, no formato de 'diet.txt'. Pode estar comprimido ('.gz' ou '.zst').
+ * @param output Caminho do ficheiro ordenado a produzir. Os ficheiros temporários são criados ao lado deste,
+ *               com o sufixo '.runN', e apagados no fim.
+ * @param memoryBudget Memória máxima, em bytes, usada para os blocos de registos em memória.
+ * @param threads Número de threads usadas na geração de sequências.
+ * @param binary Se for diferente de 0, a saída é escrita como um array de estruturas 'Diet' em binário em vez
+ *               de texto no formato de 'diet.txt'.
+ *
+ * @return Retorna o número de registos ordenados, ou -1 em caso de erro.
+ */
+long externalSortDiets(char *input, char *output, size_t memoryBudget, int threads, int binary);
+
+#endif // EXTSORT_H
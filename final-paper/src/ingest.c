@@ -0,0 +1,353 @@
+#include "ingest.h"
+#include "utils.h"
+#include "loader.h"
+#include "cache.h"
+#include "schema.h"
+#include "alerts.h"
+#include "sample.h"
+#include "rowstore.h"
+#include "memtrack.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @file ingest.c
+ * @brief Implementação do caminho de escrita com escrita por lotes.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'ingest.h'. As linhas de cada ficheiro
+ * são acumuladas num buffer em memória e escritas de uma só vez quando o lote fica cheio ou quando
+ * 'commitIngest' é chamada. Os ficheiros são abertos com O_APPEND, pelo que cada escrita é acrescentada ao
+ * fim do ficheiro e nunca altera as linhas existentes.
+ *
+ * Cada registo entra primeiro no lote e só depois é publicado em memória: se faltar memória antes da publicação,
+ * a linha é retirada do lote e nada muda. Se a escrita de um lote falhar, as linhas continuam no lote (com a
+ * parte já escrita registada em 'written') e são escritas no lote seguinte, sem repetir essa parte.
+ */
+
+// Ficheiro de dados aberto para acrescentar linhas, com o lote pendente
+typedef struct {
+	int fd;
+	char *buffer;
+	size_t used;
+	size_t written;
+	size_t capacity;
+	int pending;
+} LogFile;
+
+struct IngestLog {
+	LogFile files[3];
+	int batchSize;
+	long records;
+	long batches;
+	long syncs;
+};
+
+static int appendBytes(LogFile *file, const char *bytes, size_t size) {
+	if (file->used + size > file->capacity) {
+		size_t capacity = file->capacity > 0 ? file->capacity : 4096;
+		while (capacity < file->used + size) {
+			capacity *= 2;
+		}
+		char *buffer = memRealloc(MEM_INGEST, file->buffer, capacity);
+		if (buffer == NULL) {
+			return -1;
+		}
+		file->buffer = buffer;
+		file->capacity = capacity;
+	}
+	memcpy(file->buffer + file->used, bytes, size);
+	file->used += size;
+	return 0;
+}
+
+static int openLogFile(LogFile *file, char *directory, char *name) {
+	char path[512];
+	char last = '\n';
+
+	// Os ficheiros comprimidos sao so de leitura: criar um 'diet.txt' novo esconderia o 'diet.txt.gz'
+	snprintf(path, sizeof(path), "%s/%s", directory, name);
+	if (access(path, F_OK) != 0) {
+		static const char *suffixes[] = {".gz", ".zst"};
+		for (int i = 0; i < 2; i++) {
+			char compressed[520];
+			snprintf(compressed, sizeof(compressed), "%s%s", path, suffixes[i]);
+			if (access(compressed, F_OK) == 0) {
+				return -1;
+			}
+		}
+	}
+	file->fd = open(path, O_RDWR | O_APPEND | O_CREAT, 0644);
+	if (file->fd == -1) {
+		return -1;
+	}
+
+	// Se a ultima linha existente nao terminar em '\n', o primeiro lote comeca por termina-la
+	off_t size = lseek(file->fd, 0, SEEK_END);
+	if (size > 0 && pread(file->fd, &last, 1, size - 1) == 1 && last != '\n') {
+		return appendBytes(file, "\n", 1);
+	}
+	return 0;
+}
+
+IngestLog *openIngestLog(char *directory, int batchSize) {
+	IngestLog *log = memCalloc(MEM_INGEST, 1, sizeof(IngestLog));
+	if (log == NULL) {
+		return NULL;
+	}
+	log->batchSize = batchSize > 0 ? batchSize : 1;
+	for (int i = 0; i < 3; i++) {
+		log->files[i].fd = -1;
+	}
+
+	if (openLogFile(&log->files[DIET], directory, "diet.txt") != 0 ||
+			openLogFile(&log->files[MEAL_PLAN], directory, "mealPlan.txt") != 0) {
+		printf("Nao foi possivel abrir os ficheiros para escrita.\n");
+		closeIngestLog(log);
+		return NULL;
+	}
+	return log;
+}
+
+static int writeBatch(IngestLog *log, LogFile *file) {
+	if (file->pending == 0 && file->used == 0) {
+		return 0;
+	}
+	// Depois de uma escrita parcial, o lote seguinte continua a partir do ultimo byte escrito
+	while (file->written < file->used) {
+		ssize_t bytes = write(file->fd, file->buffer + file->written, file->used - file->written);
+		if (bytes < 0) {
+			return -1;
+		}
+		file->written += bytes;
+	}
+	if (fsync(file->fd) != 0) {
+		return -1;
+	}
+
+	log->syncs++;
+	file->used = 0;
+	file->written = 0;
+	file->pending = 0;
+	return 0;
+}
+
+int closeIngestLog(IngestLog *log) {
+	int status = 0;
+
+	if (log == NULL) {
+		return 0;
+	}
+	for (int i = 0; i < 3; i++) {
+		if (log->files[i].fd != -1) {
+			if (writeBatch(log, &log->files[i]) != 0) {
+				status = -1;
+			}
+			close(log->files[i].fd);
+		}
+		memFree(log->files[i].buffer);
+	}
+	memFree(log);
+	return status;
+}
+
+int commitIngest(Dataset *dataset) {
+	IngestLog *log = dataset->log;
+	int status = 0, pending = 0;
+
+	if (log == NULL) {
+		return -1;
+	}
+	for (int i = 0; i < 3; i++) {
+		pending += log->files[i].pending;
+		if (writeBatch(log, &log->files[i]) != 0) {
+			printf("Erro ao escrever no ficheiro de dados.\n");
+			status = -1;
+		}
+	}
+	if (pending > 0) {
+		log->batches++;
+	}
+	// Os alertas do lote saem com o lote, em vez de uma escrita por dieta fora do plano
+	if (flushAlerts(dataset->alerts) != 0) {
+		printf("Erro ao enviar os alertas.\n");
+		status = -1;
+	}
+
+	// As dietas fora do indice sao percorridas uma a uma; quando passam a ser muitas, o indice e refeito
+	int tail = dataset->numDiets - dataset->indexedDiets;
+	if (tail > 4096 && tail > dataset->indexedDiets / 4) {
+		rebuildDateIndex(dataset);
+	}
+	// Cada lote escrito e tambem publicado as consultas concorrentes, se as houver
+	if (dataset->snapshot != NULL && publishSnapshot(dataset) != 0) {
+		status = -1;
+	}
+	return status;
+}
+
+static int validText(const char *text) {
+	return text[0] != '\0' && strpbrk(text, ";\n\r") == NULL;
+}
+
+// Garante espaco para mais um registo, duplicando a capacidade do array quando necessario
+static void *reserveRow(Dataset *dataset, void *rows, int count, int *capacity, size_t size) {
+	if (count < *capacity) {
+		return rows;
+	}
+	int newCapacity = *capacity > 0 ? *capacity * 2 : 64;
+	if (dataset->snapshot == NULL) {
+		char *grown = memRealloc(MEM_RECORDS, rows, size * newCapacity);
+		if (grown != NULL) {
+			*capacity = newCapacity;
+		}
+		return grown;
+	}
+
+	// Com consultas concorrentes o array antigo continua publicado ate ao fim do lote, por isso e copiado
+	char *grown = memAlloc(MEM_RECORDS, size * newCapacity);
+	if (grown == NULL) {
+		return NULL;
+	}
+	memcpy(grown, rows, size * count);
+	releaseMemory(dataset, rows);
+	*capacity = newCapacity;
+	return grown;
+}
+
+// Conta o registo ja publicado cuja linha esta no lote e escreve o lote se ficar cheio
+static void commitRecord(Dataset *dataset, FileType fileType) {
+	LogFile *file = &dataset->log->files[fileType];
+
+	file->pending++;
+	dataset->log->records++;
+	if (file->pending >= dataset->log->batchSize) {
+		// Se a escrita falhar, 'commitIngest' indica o erro e as linhas ficam para o lote seguinte
+		commitIngest(dataset);
+	}
+}
+
+int ingestDiet(Dataset *dataset, const Diet *diet) {
+	char line[256];
+
+	if (dataset->log == NULL || !validText(diet->meal) || !validText(diet->food) ||
+			requireColumns(dataset, DIET, COL_ALL) != 0) {
+		return -1;
+	}
+
+	Diet *diets = reserveRow(dataset, dataset->diets, dataset->numDiets, &dataset->dietCapacity, sizeof(Diet));
+	if (diets == NULL) {
+		return -1;
+	}
+	dataset->diets = diets;
+
+	size_t length = formatRecord(line, sizeof(line), diet, DIET);
+	LogFile *file = &dataset->log->files[DIET];
+	if (length >= sizeof(line) || appendBytes(file, line, length) != 0) {
+		return -1;
+	}
+	if (storeReserve(dataset, DIET) != 0) {
+		file->used -= length;
+		return -1;
+	}
+
+	// A partir daqui nada falha: o registo e publicado em memoria
+	parseLine(line, dataset->diets, dataset->numDiets, DIET);
+	storeAppend(dataset->stores[DIET], dataset->diets[dataset->numDiets].ID, dataset->diets[dataset->numDiets].date, dataset->numDiets);
+	cacheInvalidate(dataset->cache, DIET, dataset->diets[dataset->numDiets].ID, dataset->diets[dataset->numDiets].date);
+	if (dataset->alerts != NULL && alertCheckDiet(dataset->alerts, &dataset->diets[dataset->numDiets]) < 0) {
+		printf("Erro ao enviar os alertas.\n");
+	}
+	if (sampleAdd(dataset->sample, &dataset->diets[dataset->numDiets]) != 0) {
+		printf("Memoria insuficiente: as respostas aproximadas passam a ser exatas.\n");
+	}
+	dataset->numDiets++;
+
+	commitRecord(dataset, DIET);
+	return 0;
+}
+
+int ingestMealPlan(Dataset *dataset, const MealPlan *mealPlan) {
+	char line[256];
+
+	if (dataset->log == NULL || !validText(mealPlan->meal) || requireColumns(dataset, MEAL_PLAN, COL_ALL) != 0) {
+		return -1;
+	}
+
+	MealPlan *mealPlans = reserveRow(dataset, dataset->mealPlans, dataset->numMealPlans, &dataset->mealPlanCapacity, sizeof(MealPlan));
+	if (mealPlans == NULL) {
+		return -1;
+	}
+	dataset->mealPlans = mealPlans;
+
+	size_t length = formatRecord(line, sizeof(line), mealPlan, MEAL_PLAN);
+	LogFile *file = &dataset->log->files[MEAL_PLAN];
+	if (length >= sizeof(line) || appendBytes(file, line, length) != 0) {
+		return -1;
+	}
+	// O registo ainda nao esta visivel: e interpretado depois do fim do array, para o monitor de alertas
+	parseLine(line, dataset->mealPlans, dataset->numMealPlans, MEAL_PLAN);
+	if (storeReserve(dataset, MEAL_PLAN) != 0 ||
+			(dataset->alerts != NULL && alertAddPlan(dataset->alerts, &dataset->mealPlans[dataset->numMealPlans]) != 0)) {
+		file->used -= length;
+		return -1;
+	}
+
+	// A partir daqui nada falha: o registo e publicado em memoria
+	storeAppend(dataset->stores[MEAL_PLAN], dataset->mealPlans[dataset->numMealPlans].ID, dataset->mealPlans[dataset->numMealPlans].date, dataset->numMealPlans);
+	cacheInvalidate(dataset->cache, MEAL_PLAN, dataset->mealPlans[dataset->numMealPlans].ID, dataset->mealPlans[dataset->numMealPlans].date);
+	dataset->numMealPlans++;
+
+	commitRecord(dataset, MEAL_PLAN);
+	return 0;
+}
+
+int ingestFile(Dataset *dataset, char *path, FileType fileType) {
+	FILE *file = fopen(path, "r");
+	char line[500];
+	int count = 0;
+
+	if (file == NULL) {
+		printf("Nao foi possivel abrir o ficheiro.\n");
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), file)) {
+		int status;
+		if (line[strspn(line, " \t\r\n")] == '\0') {
+			continue;
+		}
+		if (fileType == DIET) {
+			Diet diet;
+			initializeDiets(&diet, 1);
+			parseLine(line, &diet, 0, DIET);
+			// 'parseLine' guarda os alimentos com o espaco que se segue ao ';', que o formato volta a acrescentar
+			char *food = diet.food + strspn(diet.food, " ");
+			memmove(diet.food, food, strlen(food) + 1);
+			status = ingestDiet(dataset, &diet);
+		} else {
+			MealPlan mealPlan;
+			initializeMealPlans(&mealPlan, 1);
+			parseLine(line, &mealPlan, 0, MEAL_PLAN);
+			status = ingestMealPlan(dataset, &mealPlan);
+		}
+		if (status != 0) {
+			printf("Registo invalido: %s", line);
+			continue;
+		}
+		count++;
+	}
+	fclose(file);
+
+	return commitIngest(dataset) == 0 ? count : -1;
+}
+
+void printIngestStats(const IngestLog *log) {
+	if (log == NULL) {
+		return;
+	}
+	printf("Escrita: %ld registos inseridos, %ld lotes, %ld chamadas a fsync\n", log->records, log->batches, log->syncs);
+}
@@ -0,0 +1,106 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include "types.h"
+
+/**
+ * @file ingest.h
+ * @brief Cabeçalho do caminho de escrita de novos registos de dieta e de plano alimentar.
+ *
+ * Este ficheiro de cabeçalho declara as funções que acrescentam registos aos ficheiros 'diet.txt' e
+ * 'mealPlan.txt'. Os ficheiros são tratados como registos só de acréscimo (append-only), no mesmo formato
+ * de texto lido por 'readFile'. Cada registo fica visível às consultas assim que é inserido, porque é
+ * acrescentado de imediato aos arrays do 'Dataset'; a escrita em disco é feita por lotes (group commit),
+ * com uma única escrita e um único 'fsync' por ficheiro em cada lote.
+ *
+ * @note Este ficheiro depende das definições das estruturas de dados em 'types.h'.
+ */
+
+/**
+ * @brief Abre o caminho de escrita sobre os ficheiros de dados de uma diretoria.
+ *
+ * @param directory Diretoria onde se encontram 'diet.txt' e 'mealPlan.txt' (são criados se não existirem).
+ * @param batchSize Número de registos acumulados antes de um lote ser escrito automaticamente.
+ *
+ * @return Retorna um ponteiro para o novo caminho de escrita, ou NULL se não for possível abrir os ficheiros.
+ *
+ * @note Os ficheiros comprimidos são só de leitura: se só existir 'diet.txt.gz' ou 'diet.txt.zst' (o mesmo
+ *       para 'mealPlan.txt'), a escrita não é aberta.
+ */
+IngestLog *openIngestLog(char *directory, int batchSize);
+
+/**
+ * @brief Escreve os registos pendentes e fecha o caminho de escrita.
+ *
+ * @param log Ponteiro para o caminho de escrita (pode ser NULL).
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se a escrita do último lote falhar.
+ */
+int closeIngestLog(IngestLog *log);
+
+/**
+ * @brief Insere um novo registo de dieta.
+ *
+ * O registo é formatado no formato de 'diet.txt', interpretado com 'parseLine' e acrescentado ao array de
+ * dietas, pelo que fica imediatamente visível e é igual ao que seria lido do ficheiro. Os resultados da
+ * cache afetados por este paciente e data são invalidados. Se houver um monitor de alertas em 'dataset->alerts',
+ * o registo é verificado contra o plano alimentar ativo. A linha entra no lote antes de o registo ser publicado
+ * em memória e fica pendente até ao próximo lote; se o lote ficar cheio é escrito de imediato e, se essa escrita
+ * falhar, 'commitIngest' indica o erro e as linhas continuam pendentes.
+ *
+ * @param dataset Conjunto de dados com um caminho de escrita aberto em 'dataset->log'.
+ * @param diet Registo a inserir. Os campos 'meal' e 'food' não podem conter ';' nem mudanças de linha.
+ *
+ * @return Retorna 0 se o registo foi inserido, ou -1 se o registo for inválido ou não houver memória (nesse caso
+ *         o registo não fica nem em memória nem no lote).
+ */
+int ingestDiet(Dataset *dataset, const Diet *diet);
+
+/**
+ * @brief Insere um novo registo de plano alimentar.
+ *
+ * Funciona como 'ingestDiet', mas sobre 'mealPlan.txt' e o array de planos alimentares. O plano é também
+ * acrescentado ao índice de planos do monitor de alertas, se existir.
+ *
+ * @param dataset Conjunto de dados com um caminho de escrita aberto em 'dataset->log'.
+ * @param mealPlan Registo a inserir. O campo 'meal' não pode conter ';' nem mudanças de linha.
+ *
+ * @return Retorna 0 se o registo foi inserido, ou -1 se o registo for inválido ou não houver memória (nesse caso
+ *         o registo não fica nem em memória nem no lote).
+ */
+int ingestMealPlan(Dataset *dataset, const MealPlan *mealPlan);
+
+/**
+ * @brief Escreve em disco todos os registos pendentes (group commit).
+ *
+ * Para cada ficheiro com registos pendentes é feita uma única escrita com todo o lote, seguida de um único
+ * 'fsync'. Os alertas acumulados pelo monitor em 'dataset->alerts' são enviados nesse momento. Depois da
+ * escrita, se houver muitas dietas fora do índice por data, o índice é reconstruído. Se houver consultas
+ * concorrentes ('dataset->snapshot' não é NULL), o lote é publicado com 'publishSnapshot'.
+ *
+ * @param dataset Conjunto de dados com um caminho de escrita aberto em 'dataset->log'.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se a escrita falhar. As linhas que não foram escritas continuam
+ *         pendentes e são escritas no lote seguinte, a partir do ponto em que a escrita parou.
+ */
+int commitIngest(Dataset *dataset);
+
+/**
+ * @brief Insere todos os registos de um ficheiro no formato de 'diet.txt' ou 'mealPlan.txt'.
+ *
+ * @param dataset Conjunto de dados com um caminho de escrita aberto em 'dataset->log'.
+ * @param path Caminho do ficheiro com os registos a inserir.
+ * @param fileType Tipo dos registos (DIET ou MEAL_PLAN).
+ *
+ * @return Retorna o número de registos inseridos, ou -1 em caso de erro.
+ */
+int ingestFile(Dataset *dataset, char *path, FileType fileType);
+
+/**
+ * @brief Imprime as estatísticas do caminho de escrita: registos, lotes e chamadas a 'fsync'.
+ *
+ * @param log Ponteiro para o caminho de escrita (pode ser NULL).
+ */
+void printIngestStats(const IngestLog *log);
+
+#endif // INGEST_H
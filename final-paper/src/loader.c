@@ -0,0 +1,771 @@
+#include "loader.h"
+#include "utils.h"
+#include "schema.h"
+#include "cache.h"
+#include "ingest.h"
+#include "stream.h"
+#include "diskindex.h"
+#include "alerts.h"
+#include "epoch.h"
+#include "planner.h"
+#include "sample.h"
+#include "rowstore.h"
+#include "memtrack.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+/**
+ * @file loader.c
+ * @brief Implementação do carregamento concorrente do conjunto de dados.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'loader.h'. Os três ficheiros de dados
+ * são lidos em threads separadas, cada uma responsável por reservar, inicializar e preencher o seu array e
+ * por construir os índices que dependem apenas desse ficheiro. Como cada thread escreve em campos distintos
+ * da estrutura 'Dataset', não é necessária qualquer sincronização além de esperar pelo fim das threads.
+ *
+ * No modo preguiçoso as threads apenas registam a posição de cada linha. As colunas são interpretadas
+ * por 'requireColumns' quando uma consulta precisa delas, diretamente a partir dessas posições.
+ *
+ * @note No modo normal a leitura continua a ser feita com 'readFile', pelo que o formato dos ficheiros não se altera.
+ */
+
+// Trabalho de uma thread de carregamento: um ficheiro e o seu tipo
+typedef struct {
+	char path[512];
+	FileType fileType;
+	Dataset *dataset;
+	int lazy;
+	int recordsOnly;
+	int status;
+} LoadTask;
+
+// Par (dia, posicao) usado para ordenar as dietas por data
+typedef struct {
+	int day;
+	int row;
+} DayRow;
+
+static int compareDayRows(const void *a, const void *b) {
+	const DayRow *first = (const DayRow *)a;
+	const DayRow *second = (const DayRow *)b;
+
+	if (first->day != second->day) {
+		return (first->day > second->day) - (first->day < second->day);
+	}
+	return (first->row > second->row) - (first->row < second->row);
+}
+
+static unsigned hashID(int ID) {
+	return (unsigned)ID * 2654435761u;
+}
+
+static int buildPatientIndex(Dataset *dataset) {
+	int capacity = 1;
+	while (capacity < 2 * dataset->numPatients) {
+		capacity *= 2;
+	}
+
+	dataset->patientSlots = memAlloc(MEM_INDEX, sizeof(int) * capacity);
+	if (dataset->patientSlots == NULL) {
+		return -1;
+	}
+	dataset->patientSlotsMask = capacity - 1;
+	for (int i = 0; i < capacity; i++) {
+		dataset->patientSlots[i] = -1;
+	}
+
+	for (int row = 0; row < dataset->numPatients; row++) {
+		unsigned slot = hashID(dataset->patients[row].ID) & dataset->patientSlotsMask;
+		while (dataset->patientSlots[slot] != -1 && dataset->patients[dataset->patientSlots[slot]].ID != dataset->patients[row].ID) {
+			slot = (slot + 1) & dataset->patientSlotsMask;
+		}
+		// Em caso de IDs repetidos fica a primeira ocorrencia, tal como numa pesquisa linear
+		if (dataset->patientSlots[slot] == -1) {
+			dataset->patientSlots[slot] = row;
+		}
+	}
+	return 0;
+}
+
+// Par (nome, posicao) usado para ordenar os pacientes por nome
+typedef struct {
+	const char *name;
+	int row;
+} NameRow;
+
+static int compareNameRows(const void *a, const void *b) {
+	const NameRow *first = (const NameRow *)a;
+	const NameRow *second = (const NameRow *)b;
+	int order = strcasecmp(first->name, second->name);
+
+	if (order != 0) {
+		return order;
+	}
+	return (first->row > second->row) - (first->row < second->row);
+}
+
+// FNV-1a sobre o nome em minusculas, para que a procura exata nao distinga maiusculas de minusculas
+static unsigned hashName(const char *name) {
+	unsigned hash = 2166136261u;
+	for (const char *c = name; *c != '\0'; c++) {
+		hash = (hash ^ (unsigned char)tolower((unsigned char)*c)) * 16777619u;
+	}
+	return hash;
+}
+
+static int buildNameIndex(Dataset *dataset) {
+	int count = dataset->numPatients > 0 ? dataset->numPatients : 1;
+	int capacity = 1;
+	while (capacity < 2 * dataset->numPatients) {
+		capacity *= 2;
+	}
+
+	NameRow *pairs = memAlloc(MEM_INDEX, sizeof(NameRow) * count);
+	memFree(dataset->patientsByName);
+	memFree(dataset->nameSlots);
+	dataset->patientsByName = memAlloc(MEM_INDEX, sizeof(int) * count);
+	dataset->nameSlots = memAlloc(MEM_INDEX, sizeof(int) * capacity);
+	if (pairs == NULL || dataset->patientsByName == NULL || dataset->nameSlots == NULL) {
+		memFree(pairs);
+		return -1;
+	}
+
+	for (int row = 0; row < dataset->numPatients; row++) {
+		pairs[row] = (NameRow){.name = dataset->patients[row].name, .row = row};
+	}
+	qsort(pairs, dataset->numPatients, sizeof(NameRow), compareNameRows);
+	for (int i = 0; i < dataset->numPatients; i++) {
+		dataset->patientsByName[i] = pairs[i].row;
+	}
+	memFree(pairs);
+
+	dataset->nameSlotsMask = capacity - 1;
+	for (int i = 0; i < capacity; i++) {
+		dataset->nameSlots[i] = -1;
+	}
+	for (int row = 0; row < dataset->numPatients; row++) {
+		const char *name = dataset->patients[row].name;
+		unsigned slot = hashName(name) & dataset->nameSlotsMask;
+		while (dataset->nameSlots[slot] != -1 && strcasecmp(dataset->patients[dataset->nameSlots[slot]].name, name) != 0) {
+			slot = (slot + 1) & dataset->nameSlotsMask;
+		}
+		// Com nomes repetidos fica o primeiro paciente; os restantes continuam acessiveis pelo prefixo
+		if (dataset->nameSlots[slot] == -1) {
+			dataset->nameSlots[slot] = row;
+		}
+	}
+	return 0;
+}
+
+// Sem memoria (ou acima do orcamento dos indices) fica sem indice e as consultas por data percorrem as dietas
+static void buildDateIndex(Dataset *dataset) {
+	int count = dataset->numDiets > 0 ? dataset->numDiets : 1;
+	DayRow *pairs = memAlloc(MEM_INDEX, sizeof(DayRow) * count);
+
+	// O indice antigo pode estar a ser lido por uma consulta concorrente ate a proxima versao ser publicada
+	releaseMemory(dataset, dataset->dietsByDate);
+	releaseMemory(dataset, dataset->dietDays);
+	dataset->indexedDiets = 0;
+	dataset->dietsByDate = memAlloc(MEM_INDEX, sizeof(int) * count);
+	dataset->dietDays = memAlloc(MEM_INDEX, sizeof(int) * count);
+	if (pairs == NULL || dataset->dietsByDate == NULL || dataset->dietDays == NULL) {
+		memFree(pairs);
+		memFree(dataset->dietsByDate);
+		memFree(dataset->dietDays);
+		dataset->dietsByDate = NULL;
+		dataset->dietDays = NULL;
+		return;
+	}
+
+	for (int row = 0; row < dataset->numDiets; row++) {
+		pairs[row] = (DayRow){.day = dateToDays(dataset->diets[row].date), .row = row};
+	}
+	qsort(pairs, dataset->numDiets, sizeof(DayRow), compareDayRows);
+	for (int i = 0; i < dataset->numDiets; i++) {
+		dataset->dietsByDate[i] = pairs[i].row;
+		dataset->dietDays[i] = pairs[i].day;
+	}
+	dataset->indexedDiets = dataset->numDiets;
+
+	memFree(pairs);
+}
+
+// Regista a posicao de inicio de cada linha, sem interpretar o conteudo
+static int indexLines(LazyFile *lazyFile) {
+	FILE *file = fopen(lazyFile->path, "r");
+	int capacity = 1024, last = '\n', c;
+	long position = 0;
+
+	lazyFile->lines = 0;
+	lazyFile->offsets = memAlloc(MEM_TEXT, sizeof(long) * capacity);
+	if (lazyFile->offsets == NULL) {
+		if (file != NULL) {
+			fclose(file);
+		}
+		return -1;
+	}
+	if (file == NULL) {
+		printf("Nao foi possivel abrir o ficheiro.\n");
+		return 0;
+	}
+
+	while ((c = getc(file)) != EOF) {
+		if (last == '\n') {
+			if (lazyFile->lines == capacity) {
+				long *offsets = memRealloc(MEM_TEXT, lazyFile->offsets, sizeof(long) * capacity * 2);
+				if (offsets == NULL) {
+					fclose(file);
+					return -1;
+				}
+				lazyFile->offsets = offsets;
+				capacity *= 2;
+			}
+			lazyFile->offsets[lazyFile->lines++] = position;
+		}
+		last = c;
+		position++;
+	}
+	fclose(file);
+	return 0;
+}
+
+static void *loadTask(void *arg) {
+	LoadTask *task = (LoadTask *)arg;
+	Dataset *dataset = task->dataset;
+	LazyFile *lazyFile = &dataset->lazyFiles[task->fileType];
+
+	strcpy(lazyFile->path, task->path);
+	// Um ficheiro comprimido nao permite saltar para uma linha, por isso e sempre lido por completo
+	if (task->lazy && !isCompressedPath(task->path)) {
+		// Com o indice em disco, as consultas sobre um paciente nao precisam das posicoes de todas as linhas
+		if (dataset->diskIndex != NULL && task->fileType != PATIENTS) {
+			task->status = 0;
+			return NULL;
+		}
+		task->status = indexLines(lazyFile);
+		return NULL;
+	}
+
+	int lines = countLines(task->path);
+	int size = lines > 0 ? lines : 1;
+
+	lazyFile->lines = lines;
+	lazyFile->parsed = COL_ALL;
+	task->status = -1;
+	switch (task->fileType) {
+		case PATIENTS:
+			dataset->patients = memAlloc(MEM_RECORDS, sizeof(Patients) * size);
+			if (dataset->patients == NULL) {
+				return NULL;
+			}
+			initializePatients(dataset->patients, size);
+			dataset->numPatients = readFile(task->path, dataset->patients, lines, PATIENTS);
+			task->status = !task->recordsOnly && (buildPatientIndex(dataset) != 0 || buildNameIndex(dataset) != 0) ? -1 : 0;
+			break;
+
+		case DIET:
+			dataset->diets = memAlloc(MEM_RECORDS, sizeof(Diet) * size);
+			if (dataset->diets == NULL) {
+				return NULL;
+			}
+			initializeDiets(dataset->diets, size);
+			dataset->dietCapacity = size;
+			dataset->numDiets = readFile(task->path, dataset->diets, lines, DIET);
+			if (!task->recordsOnly) {
+				buildDateIndex(dataset);
+				buildTableStats(dataset, DIET);
+				buildRowStore(dataset, DIET);
+				buildDietSample(dataset);
+			}
+			task->status = 0;
+			break;
+
+		case MEAL_PLAN:
+			dataset->mealPlans = memAlloc(MEM_RECORDS, sizeof(MealPlan) * size);
+			if (dataset->mealPlans == NULL) {
+				return NULL;
+			}
+			initializeMealPlans(dataset->mealPlans, size);
+			dataset->mealPlanCapacity = size;
+			dataset->numMealPlans = readFile(task->path, dataset->mealPlans, lines, MEAL_PLAN);
+			if (!task->recordsOnly) {
+				buildTableStats(dataset, MEAL_PLAN);
+				buildRowStore(dataset, MEAL_PLAN);
+			}
+			task->status = 0;
+			break;
+	}
+	return NULL;
+}
+
+// Escolhe o ficheiro de dados a ler: o ficheiro de texto ou, se nao existir, a versao comprimida
+static void resolveDataPath(char *path, size_t size, char *directory, const char *name) {
+	static const char *suffixes[] = {"", ".gz", ".zst"};
+
+	for (int i = 0; i < 3; i++) {
+		snprintf(path, size, "%s/%s%s", directory, name, suffixes[i]);
+		if (access(path, F_OK) == 0) {
+			return;
+		}
+	}
+	snprintf(path, size, "%s/%s", directory, name);
+}
+
+// Le os tres ficheiros de uma diretoria em paralelo; com 'recordsOnly' os indices derivados nao sao construidos
+static int loadDirectory(Dataset *dataset, char *directory, int lazy, int recordsOnly) {
+	static const char *files[] = {"patients.txt", "diet.txt", "mealPlan.txt"};
+	LoadTask tasks[3];
+	pthread_t threads[3];
+	int started = 0, status = 0;
+
+	memset(dataset, 0, sizeof(Dataset));
+	if (lazy) {
+		dataset->diskIndex = openDiskIndex(directory);
+	}
+
+	for (int i = 0; i < 3; i++) {
+		resolveDataPath(tasks[i].path, sizeof(tasks[i].path), directory, files[i]);
+		tasks[i].fileType = (FileType)i;
+		tasks[i].dataset = dataset;
+		tasks[i].lazy = lazy;
+		tasks[i].recordsOnly = recordsOnly;
+		tasks[i].status = -1;
+		if (pthread_create(&threads[i], NULL, loadTask, &tasks[i]) != 0) {
+			status = -1;
+			break;
+		}
+		started++;
+	}
+
+	for (int i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+		if (tasks[i].status != 0) {
+			status = -1;
+		}
+	}
+
+	if (status != 0) {
+		freeDataset(dataset);
+	}
+	return status;
+}
+
+int loadDataset(Dataset *dataset, char *directory, int lazy) {
+	return loadDirectory(dataset, directory, lazy, 0);
+}
+
+void freeDataset(Dataset *dataset) {
+	memFree(dataset->patients);
+	memFree(dataset->diets);
+	memFree(dataset->mealPlans);
+	memFree(dataset->patientSlots);
+	memFree(dataset->patientsByName);
+	memFree(dataset->nameSlots);
+	memFree(dataset->dietsByDate);
+	memFree(dataset->dietDays);
+	for (int i = 0; i < 3; i++) {
+		memFree(dataset->lazyFiles[i].offsets);
+		freeTableStats(dataset->stats[i]);
+		freeRowStore(dataset->stores[i]);
+	}
+	memFree(dataset->sites);
+	closeDiskIndex(dataset->diskIndex);
+	freeCache(dataset->cache);
+	freeDietSample(dataset->sample);
+	closeIngestLog(dataset->log);
+	closeAlertMonitor(dataset->alerts);
+	// Sem leitores ativos, uma ultima publicacao liberta toda a memoria ainda retirada pela escrita
+	if (dataset->snapshot != NULL) {
+		memFree(dataset->snapshot);
+		epochPublish();
+	}
+	memset(dataset, 0, sizeof(Dataset));
+}
+
+// Trabalho de uma thread de carregamento de um local
+typedef struct {
+	char *directory;
+	Dataset dataset;
+	int status;
+} SiteTask;
+
+// Acrescenta o prefixo do local ao ID; um ID fora de 0..SITE_ID_PREFIX-1 colidiria com os IDs de outro local
+static int prefixID(int *ID, int prefix, const char *directory) {
+	if (*ID == -1) {
+		return 0;
+	}
+	if (*ID < 0 || *ID >= SITE_ID_PREFIX) {
+		printf("ID %d do local %s fora do intervalo permitido (0 a %d).\n", *ID, directory, SITE_ID_PREFIX - 1);
+		return -1;
+	}
+	*ID += prefix;
+	return 0;
+}
+
+static void *loadSiteTask(void *arg) {
+	SiteTask *task = (SiteTask *)arg;
+	// Os indices sao construidos uma unica vez, depois de os locais serem juntados
+	task->status = loadDirectory(&task->dataset, task->directory, 0, 1);
+	return NULL;
+}
+
+int loadSites(Dataset *dataset, char **directories, int count) {
+	SiteTask *tasks = memCalloc(MEM_RECORDS, count, sizeof(SiteTask));
+	pthread_t *threads = memAlloc(MEM_RECORDS, sizeof(pthread_t) * count);
+	int status = 0, started = 0;
+
+	memset(dataset, 0, sizeof(Dataset));
+	if (tasks == NULL || threads == NULL) {
+		memFree(tasks);
+		memFree(threads);
+		return -1;
+	}
+
+	// Cada local e carregado na sua thread (e cada um le os seus tres ficheiros em paralelo)
+	for (int i = 0; i < count; i++) {
+		tasks[i].directory = directories[i];
+		if (pthread_create(&threads[i], NULL, loadSiteTask, &tasks[i]) != 0) {
+			status = -1;
+			break;
+		}
+		started++;
+	}
+	for (int i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+		if (tasks[i].status != 0) {
+			status = -1;
+		}
+	}
+
+	int numPatients = 0, numDiets = 0, numMealPlans = 0;
+	for (int i = 0; i < started; i++) {
+		numPatients += tasks[i].dataset.numPatients;
+		numDiets += tasks[i].dataset.numDiets;
+		numMealPlans += tasks[i].dataset.numMealPlans;
+	}
+
+	dataset->sites = memCalloc(MEM_RECORDS, count, sizeof(SiteRange));
+	dataset->patients = memAlloc(MEM_RECORDS, sizeof(Patients) * (numPatients > 0 ? numPatients : 1));
+	dataset->diets = memAlloc(MEM_RECORDS, sizeof(Diet) * (numDiets > 0 ? numDiets : 1));
+	dataset->mealPlans = memAlloc(MEM_RECORDS, sizeof(MealPlan) * (numMealPlans > 0 ? numMealPlans : 1));
+	if (dataset->sites == NULL || dataset->patients == NULL || dataset->diets == NULL || dataset->mealPlans == NULL) {
+		status = -1;
+	}
+
+	// Os registos de cada local ficam contiguos e os IDs recebem o prefixo do local
+	for (int i = 0; status == 0 && i < count; i++) {
+		Dataset *site = &tasks[i].dataset;
+		SiteRange *range = &dataset->sites[i];
+		int prefix = (i + 1) * SITE_ID_PREFIX;
+
+		*range = (SiteRange){.prefix = prefix, .firstPatient = dataset->numPatients, .numPatients = site->numPatients,
+			.firstDiet = dataset->numDiets, .numDiets = site->numDiets, .firstMealPlan = dataset->numMealPlans, .numMealPlans = site->numMealPlans};
+		snprintf(range->directory, sizeof(range->directory), "%s", directories[i]);
+
+		for (int row = 0; status == 0 && row < site->numPatients; row++) {
+			dataset->patients[dataset->numPatients] = site->patients[row];
+			status = prefixID(&dataset->patients[dataset->numPatients].ID, prefix, directories[i]);
+			dataset->numPatients++;
+		}
+		for (int row = 0; status == 0 && row < site->numDiets; row++) {
+			dataset->diets[dataset->numDiets] = site->diets[row];
+			status = prefixID(&dataset->diets[dataset->numDiets].ID, prefix, directories[i]);
+			dataset->numDiets++;
+		}
+		for (int row = 0; status == 0 && row < site->numMealPlans; row++) {
+			dataset->mealPlans[dataset->numMealPlans] = site->mealPlans[row];
+			status = prefixID(&dataset->mealPlans[dataset->numMealPlans].ID, prefix, directories[i]);
+			dataset->numMealPlans++;
+		}
+	}
+	for (int i = 0; i < started; i++) {
+		freeDataset(&tasks[i].dataset);
+	}
+	memFree(tasks);
+	memFree(threads);
+
+	dataset->numSites = count;
+	dataset->dietCapacity = numDiets > 0 ? numDiets : 1;
+	dataset->mealPlanCapacity = numMealPlans > 0 ? numMealPlans : 1;
+	for (int i = 0; i < 3; i++) {
+		dataset->lazyFiles[i].parsed = COL_ALL;
+	}
+	if (status != 0 || buildPatientIndex(dataset) != 0 || buildNameIndex(dataset) != 0) {
+		freeDataset(dataset);
+		return -1;
+	}
+	buildDateIndex(dataset);
+	buildTableStats(dataset, DIET);
+	buildTableStats(dataset, MEAL_PLAN);
+	buildRowStore(dataset, DIET);
+	buildRowStore(dataset, MEAL_PLAN);
+	buildDietSample(dataset);
+	return 0;
+}
+
+int findPatientRow(const Dataset *dataset, int ID) {
+	if (dataset->patientSlots == NULL) {
+		return -1;
+	}
+
+	unsigned slot = hashID(ID) & dataset->patientSlotsMask;
+	while (dataset->patientSlots[slot] != -1) {
+		if (dataset->patients[dataset->patientSlots[slot]].ID == ID) {
+			return dataset->patientSlots[slot];
+		}
+		slot = (slot + 1) & dataset->patientSlotsMask;
+	}
+	return -1;
+}
+
+int findPatientByName(const Dataset *dataset, const char *name) {
+	if (dataset->nameSlots == NULL) {
+		return -1;
+	}
+
+	unsigned slot = hashName(name) & dataset->nameSlotsMask;
+	while (dataset->nameSlots[slot] != -1) {
+		if (strcasecmp(dataset->patients[dataset->nameSlots[slot]].name, name) == 0) {
+			return dataset->nameSlots[slot];
+		}
+		slot = (slot + 1) & dataset->nameSlotsMask;
+	}
+	return -1;
+}
+
+int patientsWithPrefix(const Dataset *dataset, const char *prefix, int *first) {
+	size_t length = strlen(prefix);
+	int low = 0, high = dataset->numPatients;
+
+	*first = 0;
+	if (dataset->patientsByName == NULL) {
+		return 0;
+	}
+
+	// Os nomes com o prefixo sao contiguos: o primeiro e o primeiro nome >= prefixo e o ultimo o que ainda o contem
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+		if (strncasecmp(dataset->patients[dataset->patientsByName[middle]].name, prefix, length) < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	*first = low;
+	high = dataset->numPatients;
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+		if (strncasecmp(dataset->patients[dataset->patientsByName[middle]].name, prefix, length) <= 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low - *first;
+}
+
+// Primeira posicao de 'days' com valor >= day
+static int lowerBound(const int *days, int count, int day) {
+	int low = 0, high = count;
+
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (days[mid] < day) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+int dietsInPeriod(const Dataset *dataset, Period period, Diet *out) {
+	int first = lowerBound(dataset->dietDays, dataset->indexedDiets, dateToDays(period.begin));
+	int last = lowerBound(dataset->dietDays, dataset->indexedDiets, dateToDays(period.end) + 1);
+	int count = 0;
+
+	for (int i = first; i < last; i++) {
+		out[count++] = dataset->diets[dataset->dietsByDate[i]];
+	}
+	// Dietas acrescentadas depois da construcao do indice
+	for (int row = dataset->indexedDiets; row < dataset->numDiets; row++) {
+		if (dateInPeriod(dataset->diets[row].date, period) == 1) {
+			out[count++] = dataset->diets[row];
+		}
+	}
+	return count;
+}
+
+void rebuildDateIndex(Dataset *dataset) {
+	buildDateIndex(dataset);
+}
+
+// Reserva e inicializa o array de um ficheiro na primeira vez que alguma coluna e pedida
+static int allocateRows(Dataset *dataset, FileType fileType, int lines) {
+	int size = lines > 0 ? lines : 1;
+
+	switch (fileType) {
+		case PATIENTS:
+			if (dataset->patients == NULL && (dataset->patients = memAlloc(MEM_RECORDS, sizeof(Patients) * size)) != NULL) {
+				initializePatients(dataset->patients, size);
+				dataset->numPatients = lines;
+			}
+			return dataset->patients == NULL ? -1 : 0;
+		case DIET:
+			if (dataset->diets == NULL && (dataset->diets = memAlloc(MEM_RECORDS, sizeof(Diet) * size)) != NULL) {
+				initializeDiets(dataset->diets, size);
+				dataset->numDiets = lines;
+				dataset->dietCapacity = size;
+			}
+			return dataset->diets == NULL ? -1 : 0;
+		case MEAL_PLAN:
+			if (dataset->mealPlans == NULL && (dataset->mealPlans = memAlloc(MEM_RECORDS, sizeof(MealPlan) * size)) != NULL) {
+				initializeMealPlans(dataset->mealPlans, size);
+				dataset->numMealPlans = lines;
+				dataset->mealPlanCapacity = size;
+			}
+			return dataset->mealPlans == NULL ? -1 : 0;
+	}
+	return -1;
+}
+
+int requireColumns(Dataset *dataset, FileType fileType, unsigned columns) {
+	LazyFile *lazyFile = &dataset->lazyFiles[fileType];
+	unsigned missing = columns & ~lazyFile->parsed;
+
+	if (missing == 0) {
+		return 0;
+	}
+	// As posicoes das linhas podem ter sido adiadas no arranque por existir o indice em disco
+	if (lazyFile->offsets == NULL && indexLines(lazyFile) != 0) {
+		return -1;
+	}
+	if (allocateRows(dataset, fileType, lazyFile->lines) != 0) {
+		return -1;
+	}
+
+	FILE *file = fopen(lazyFile->path, "r");
+	if (file == NULL) {
+		lazyFile->parsed |= missing;
+		return 0;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	rewind(file);
+
+	char *buffer = memAlloc(MEM_TEXT, size + 1);
+	if (buffer == NULL) {
+		fclose(file);
+		return -1;
+	}
+	size = fread(buffer, 1, size, file);
+	buffer[size] = '\0';
+	fclose(file);
+
+	// Cada linha termina no '\n' antes do inicio da seguinte, o que permite isola-las sem voltar a procura-lo
+	void *rows = fileType == PATIENTS ? (void *)dataset->patients : fileType == DIET ? (void *)dataset->diets : (void *)dataset->mealPlans;
+	for (int row = 0; row < lazyFile->lines; row++) {
+		if (row + 1 < lazyFile->lines) {
+			buffer[lazyFile->offsets[row + 1] - 1] = '\0';
+		}
+		parseRecord(buffer + lazyFile->offsets[row], rows, row, fileType, missing);
+	}
+	memFree(buffer);
+	lazyFile->parsed |= missing;
+
+	// Os indices derivados sao construidos quando as colunas de que dependem ficam disponiveis
+	if (fileType == PATIENTS && (missing & COL_ID) && buildPatientIndex(dataset) != 0) {
+		return -1;
+	}
+	if (fileType == PATIENTS && (missing & COL_NAME) && buildNameIndex(dataset) != 0) {
+		return -1;
+	}
+	if (fileType == DIET && (missing & COL_DATE)) {
+		buildDateIndex(dataset);
+	}
+	if (missing & (COL_ID | COL_DATE | COL_MEAL)) {
+		buildTableStats(dataset, fileType);
+	}
+	if (missing & (COL_ID | COL_DATE)) {
+		buildRowStore(dataset, fileType);
+	}
+	if (fileType == DIET && (missing & (COL_ID | COL_DATE | COL_MEAL | COL_CALORIES))) {
+		buildDietSample(dataset);
+	}
+	return 0;
+}
+
+void releaseMemory(Dataset *dataset, void *pointer) {
+	if (dataset->snapshot != NULL) {
+		epochRetire(pointer);
+	} else {
+		memFree(pointer);
+	}
+}
+
+int publishSnapshot(Dataset *dataset) {
+	Snapshot *snapshot = memAlloc(MEM_INGEST, sizeof(Snapshot));
+	if (snapshot == NULL) {
+		return -1;
+	}
+	*snapshot = (Snapshot){
+		.diets = dataset->diets,
+		.numDiets = dataset->numDiets,
+		.mealPlans = dataset->mealPlans,
+		.numMealPlans = dataset->numMealPlans,
+		.dietsByDate = dataset->dietsByDate,
+		.dietDays = dataset->dietDays,
+		.indexedDiets = dataset->indexedDiets
+	};
+
+	// Os registos e indices da versao ficam escritos antes de o ponteiro ser visivel aos leitores
+	Snapshot *previous = __atomic_exchange_n(&dataset->snapshot, snapshot, __ATOMIC_SEQ_CST);
+	epochRetire(previous);
+	epochPublish();
+	return 0;
+}
+
+int beginRead(Dataset *dataset, Dataset *view) {
+	if (epochEnter() != 0) {
+		return -1;
+	}
+	const Snapshot *snapshot = __atomic_load_n(&dataset->snapshot, __ATOMIC_SEQ_CST);
+
+	// Apenas os campos que a escrita nao altera sao copiados do 'Dataset'; os restantes vem da versao publicada
+	memset(view, 0, sizeof(Dataset));
+	view->patients = dataset->patients;
+	view->numPatients = dataset->numPatients;
+	view->patientSlots = dataset->patientSlots;
+	view->patientSlotsMask = dataset->patientSlotsMask;
+	view->patientsByName = dataset->patientsByName;
+	view->nameSlots = dataset->nameSlots;
+	view->nameSlotsMask = dataset->nameSlotsMask;
+	memcpy(view->lazyFiles, dataset->lazyFiles, sizeof(view->lazyFiles));
+	memcpy(view->stats, dataset->stats, sizeof(view->stats));
+	memcpy(view->stores, dataset->stores, sizeof(view->stores));
+	view->diskIndex = dataset->diskIndex;
+	view->sample = dataset->sample;
+	view->sites = dataset->sites;
+	view->numSites = dataset->numSites;
+
+	view->diets = snapshot->diets;
+	view->numDiets = snapshot->numDiets;
+	view->dietCapacity = snapshot->numDiets;
+	view->mealPlans = snapshot->mealPlans;
+	view->numMealPlans = snapshot->numMealPlans;
+	view->mealPlanCapacity = snapshot->numMealPlans;
+	view->dietsByDate = snapshot->dietsByDate;
+	view->dietDays = snapshot->dietDays;
+	view->indexedDiets = snapshot->indexedDiets;
+	return 0;
+}
+
+void endRead(void) {
+	epochExit();
+}
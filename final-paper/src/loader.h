@@ -0,0 +1,210 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "types.h"
+
+/**
+ * @file loader.h
+ * @brief Cabeçalho das funções de carregamento do conjunto de dados.
+ *
+ * Este ficheiro de cabeçalho declara as funções que carregam os três ficheiros de dados do programa
+ * ('patients.txt', 'diet.txt' e 'mealPlan.txt') para uma estrutura 'Dataset'. Cada ficheiro é lido
+ * numa thread própria, de forma a que as leituras decorram em simultâneo, e os índices derivados de
+ * cada ficheiro são construídos pela mesma thread logo que a leitura termina, sobrepondo-se à leitura
+ * dos restantes ficheiros. Existe ainda um modo preguiçoso em que as colunas só são interpretadas
+ * quando uma consulta precisa delas.
+ *
+ * @note Este ficheiro depende das definições das estruturas de dados em 'types.h'.
+ */
+
+/**
+ * @brief Carrega os ficheiros de dados de uma diretoria para uma estrutura 'Dataset'.
+ *
+ * Esta função lança uma thread por ficheiro. Cada thread conta as linhas do seu ficheiro, reserva
+ * o array com o tamanho exato, inicializa-o, lê-o com 'readFile' e constrói os índices que dependem
+ * apenas desse ficheiro: as tabelas de dispersão de IDs e de nomes de pacientes, o índice dos pacientes
+ * por nome, o índice das dietas por data, o armazenamento das dietas e dos planos por paciente ('rowstore.h') e,
+ * no modo aproximado, a amostra das dietas (ver 'sample.h').
+ * O tempo total de carregamento fica próximo do tempo do ficheiro mais lento.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset' a preencher.
+ * @param directory Diretoria onde se encontram os ficheiros (ex: "data").
+ * @param lazy Se for diferente de 0, as threads apenas registam a posição de cada linha e nenhuma coluna é
+ *             interpretada; as consultas pedem depois as colunas de que precisam com 'requireColumns'.
+ *             Se existir um índice em disco válido ('diskindex.h'), este é aberto em 'dataset->diskIndex' e as
+ *             posições das linhas de dietas e planos só são registadas quando uma consulta precisa delas.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não houver memória ou não for possível criar as threads.
+ *
+ * Se um ficheiro de texto (ex: 'diet.txt') não existir, é lida a versão comprimida ('diet.txt.gz' ou
+ * 'diet.txt.zst'). Os ficheiros comprimidos são sempre lidos por completo, mesmo no modo preguiçoso.
+ *
+ * @note Um ficheiro que não possa ser aberto resulta num array vazio, tal como acontece com 'readFile'.
+ */
+int loadDataset(Dataset *dataset, char *directory, int lazy);
+
+/**
+ * @brief Carrega várias diretorias de dados (uma por local) como um único conjunto de dados.
+ *
+ * Cada diretoria é carregada em paralelo, como em 'loadDataset' mas sem construir os índices derivados. Os
+ * registos de todos os locais são depois juntos nos arrays de 'dataset', ficando os de cada local contíguos e
+ * descritos em 'dataset->sites', e os índices são construídos uma única vez sobre os arrays juntos.
+ * Para evitar colisões, os IDs de pacientes do local i (a contar de 0) recebem o prefixo
+ * (i + 1) * SITE_ID_PREFIX; por exemplo, o paciente 3 do segundo local passa a ser o paciente 200003.
+ * Por isso os IDs de cada local têm de estar entre 0 e SITE_ID_PREFIX - 1.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset' a preencher.
+ * @param directories Diretorias a carregar, uma por local.
+ * @param count Número de elementos de 'directories'.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não houver memória, não for possível criar as threads ou
+ *         algum local tiver um ID fora do intervalo permitido.
+ *
+ * @note O modo preguiçoso não se aplica a vários locais: todas as colunas são lidas no arranque.
+ */
+int loadSites(Dataset *dataset, char **directories, int count);
+
+/**
+ * @brief Garante que as colunas indicadas de um ficheiro estão interpretadas e disponíveis no 'Dataset'.
+ *
+ * No modo preguiçoso, esta função interpreta apenas as colunas pedidas que ainda não foram lidas,
+ * percorrendo as linhas a partir das posições registadas no arranque. As colunas interpretadas ficam
+ * guardadas, pelo que uma segunda consulta sobre as mesmas colunas não volta a ler o ficheiro.
+ * Os índices derivados (tabela de IDs de pacientes, índices de nomes, índice das dietas por data, armazenamento por paciente, amostra das dietas) são construídos quando
+ * as colunas de que dependem ficam disponíveis. No modo normal todas as colunas já estão disponíveis
+ * e a função não faz nada.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset' carregada.
+ * @param fileType Ficheiro a que pertencem as colunas.
+ * @param columns Máscara de bits com as colunas pretendidas (valores de 'Column').
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não houver memória.
+ *
+ * @warning Deve ser chamada antes de qualquer acesso aos arrays do 'Dataset' ou às funções de pesquisa nos índices.
+ */
+int requireColumns(Dataset *dataset, FileType fileType, unsigned columns);
+
+/**
+ * @brief Liberta toda a memória associada a uma estrutura 'Dataset'.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset' a libertar.
+ */
+void freeDataset(Dataset *dataset);
+
+/**
+ * @brief Procura a posição de um paciente no array de pacientes através do seu ID.
+ *
+ * Esta função usa a tabela de dispersão construída durante o carregamento, pelo que a procura
+ * tem custo O(1) esperado em vez de percorrer todo o array de pacientes.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset' carregada.
+ * @param ID Identificador do paciente.
+ *
+ * @return Retorna a posição do paciente no array 'patients', ou -1 se não existir.
+ */
+int findPatientRow(const Dataset *dataset, int ID);
+
+/**
+ * @brief Procura a posição de um paciente no array de pacientes através do nome completo.
+ *
+ * Esta função usa a tabela de dispersão de nomes construída durante o carregamento, pelo que a procura
+ * tem custo O(1) esperado. Maiúsculas e minúsculas não são distinguidas.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset' carregada.
+ * @param name Nome completo do paciente.
+ *
+ * @return Retorna a posição do paciente no array 'patients', ou -1 se não existir. Se vários pacientes tiverem
+ *         o mesmo nome, é devolvido o primeiro do ficheiro.
+ */
+int findPatientByName(const Dataset *dataset, const char *name);
+
+/**
+ * @brief Encontra os pacientes cujo nome começa por um prefixo.
+ *
+ * Os pacientes estão ordenados pelo nome em 'dataset->patientsByName', pelo que os nomes com o mesmo prefixo
+ * ocupam posições contíguas desse array. Esta função localiza-as com duas pesquisas binárias, em O(log n).
+ * Maiúsculas e minúsculas não são distinguidas.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset' carregada.
+ * @param prefix Prefixo do nome.
+ * @param first Recebe a primeira posição de 'dataset->patientsByName' com o prefixo.
+ *
+ * @return Retorna o número de pacientes com o prefixo; as suas posições no array 'patients' são
+ *         'dataset->patientsByName[*first]' até 'dataset->patientsByName[*first + count - 1]'.
+ */
+int patientsWithPrefix(const Dataset *dataset, const char *prefix, int *first);
+
+/**
+ * @brief Copia para um array as dietas cuja data está dentro de um período.
+ *
+ * Esta função localiza o período no índice das dietas por data com duas pesquisas binárias e
+ * copia apenas as linhas encontradas, evitando percorrer as dietas fora do período. As dietas
+ * acrescentadas depois da construção do índice são verificadas uma a uma.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset' carregada.
+ * @param period Estrutura 'Period' com o intervalo de datas pretendido.
+ * @param out Array de destino, com espaço para pelo menos 'dataset->numDiets' elementos.
+ *
+ * @return Retorna o número de dietas copiadas.
+ */
+int dietsInPeriod(const Dataset *dataset, Period period, Diet *out);
+
+/**
+ * @brief Reconstrói o índice das dietas por data para abranger todas as dietas do array.
+ *
+ * As dietas acrescentadas pelo caminho de escrita ficam fora do índice e são percorridas sequencialmente
+ * por 'dietsInPeriod'. Esta função volta a incluí-las no índice quando essa parte sequencial fica grande.
+ * Se não houver memória, ou se o orçamento dos índices for ultrapassado, o índice é descartado e todas as dietas
+ * passam a ser percorridas sequencialmente.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset' carregada.
+ */
+void rebuildDateIndex(Dataset *dataset);
+
+/**
+ * @brief Liberta um bloco de memória do 'Dataset' que a escrita substituiu por outro.
+ *
+ * Quando há consultas concorrentes ('dataset->snapshot' não é NULL), o bloco pode ainda estar a ser lido e é
+ * entregue à libertação por épocas; caso contrário é libertado de imediato.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset'.
+ * @param pointer Bloco substituído (pode ser NULL).
+ */
+void releaseMemory(Dataset *dataset, void *pointer);
+
+/**
+ * @brief Publica uma nova versão dos dados alterados pela escrita, visível às consultas concorrentes.
+ *
+ * A primeira chamada ativa o modo concorrente: a partir daí os arrays substituídos pela escrita são libertados
+ * por épocas. Deve ser chamada apenas pela thread de escrita, depois de os registos da nova versão estarem
+ * completos. Os registos acrescentados depois da publicação só ficam visíveis na publicação seguinte.
+ *
+ * @param dataset Ponteiro para a estrutura 'Dataset'.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não houver memória (a versão anterior continua publicada).
+ */
+int publishSnapshot(Dataset *dataset);
+
+/**
+ * @brief Começa uma consulta concorrente com a escrita, sobre a última versão publicada dos dados.
+ *
+ * A vista preenchida tem os mesmos campos de um 'Dataset', mas sem cache, caminho de escrita nem alertas, e
+ * com os arrays alterados pela escrita substituídos pelos da versão publicada; pode ser passada às consultas
+ * como se fosse o conjunto de dados completo. Nada na vista é libertado até 'endRead'.
+ *
+ * @param dataset Conjunto de dados com pelo menos uma versão publicada ('publishSnapshot').
+ * @param view Estrutura que recebe a vista.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se já existirem demasiadas threads leitoras (ver 'epoch.h').
+ *
+ * @warning Todas as colunas têm de estar interpretadas antes da primeira publicação: a vista não pode ler colunas
+ *          em falta ('requireColumns'), porque o resultado ficaria apenas na vista.
+ */
+int beginRead(Dataset *dataset, Dataset *view);
+
+/**
+ * @brief Termina a consulta iniciada por 'beginRead'. A vista deixa de poder ser usada.
+ */
+void endRead(void);
+
+#endif // LOADER_H
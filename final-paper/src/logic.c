@@ -1,7 +1,13 @@
 #include "logic.h"
 #include "utils.h"
+#include "sketch.h"
+#include "pipeline.h"
+#include "planindex.h"
+#include "memtrack.h"
 
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 /**
@@ -17,6 +23,9 @@
  * e 'utils.h', sendo essenciais para as operações principais do programa, como a gestão
  * de dietas e planos alimentares.
  *
+ * As consultas sobre dietas e planos (exceto as médias móveis e os quantis) são construídas como árvores de
+ * operadores de 'pipeline.h', que processam lotes de linhas em vez de um registo de cada vez.
+ *
  * @note Este ficheiro faz uso extensivo das estruturas e funções definidas em 'utils.h'
  *       para operações de data e manipulação de dados.
  *
@@ -25,178 +34,572 @@
  *          é responsabilidade das funções chamadoras.
  */
 
+// Contagem dos pacientes acima do limite em 'exceededCalories'
+typedef struct {
+	long calories;
+	int exceeded;
+} ExceededCount;
+
+static void countExceeded(const Batch *batch, int i, void *context) {
+	ExceededCount *count = (ExceededCount *)context;
+	count->exceeded += batch->values[FIELD_SUM][i] > count->calories;
+}
+
 int exceededCalories(Diet *diet, int max_size, int calories, Period period) {
-    	int counter = 0, i, j;
-	IDCalories idCalories[100] = {[0 ... 99] = {.ID = -1, .calories = 0}}; // Inicializo todos a -1 para verificar quais posicoes estao vazias
-
-    	for (i=0; i<max_size; i++) { // Itera por todos os itens do diet[]
-        	if (dateInPeriod(diet[i].date, period) == 1) {
-        		for (j=0; (j<100) && (idCalories[j].ID != -1); j++) { // Itera por idCalories e vejo se a pessoa que consumiu aquelas calorias ja esta registada no array IDCalories
-				if (idCalories[j].ID == diet[i].ID) {
-					idCalories[j].calories += diet[i].calories;
-					break;
-				}
-			}
-			if (j==100) {
-				printf("Limite de pacientes atingidos.\n");
-				return -1;
-			}
-			// Paciente nao existia na lista, portando vou adicionar
-			if (idCalories[j].ID == -1) {
-				idCalories[j].ID = diet[i].ID;
-				idCalories[j].calories = diet[i].calories;
-			}
+	QueryKey key = {.ID = -1, .meal = "", .period = period};
+	Aggregate total = {AGGREGATE_SUM, FIELD_CALORIES, FIELD_SUM};
+	ExceededCount count = {.calories = calories, .exceeded = 0};
+
+	// Total de calorias de cada paciente no periodo
+	Operator *totals = aggregateOperator(filterOperator(scanOperator(diet, max_size, DIET), &key), 0, &total, 1);
+	if (runPipeline(totals, countExceeded, &count) == -1) {
+		printf("Memoria insuficiente.\n");
+		return -1;
+	}
+	return count.exceeded;
+}
+
+// IDs devolvidos por 'outOfRangeIDs'
+typedef struct {
+	int *IDs;
+	int count;
+	int capacity;
+	int status;
+} IDList;
+
+static void collectPatientID(const Batch *batch, int i, void *context) {
+	IDList *list = (IDList *)context;
+
+	if (list->count == list->capacity) {
+		int capacity = list->capacity > 0 ? list->capacity * 2 : 64;
+		int *IDs = memRealloc(MEM_QUERY, list->IDs, sizeof(int) * capacity);
+		if (IDs == NULL) {
+			list->status = -1;
+			return;
 		}
-    	}
-
-	// Com o array ja populado com ID e Calories, posso fazer a verificacao
-	for (i=0; (i<100) && (idCalories[i].ID != -1); i++) {
-		if (idCalories[i].calories > calories) {
-			counter++;
-		}
-	}
-	return counter;
-}
-
-int outOfRange(Diet *diet, MealPlan *mealPlan, Period period, int max_size) {
-    	int count = 0;
-	int outOfRangeIDs[100];
-	for (int k = 0; k < 100; k++) outOfRangeIDs[k] = -1;
-	int flag=0;
-
-	// Itera por todos as datas do array e verifica se estao dentro do periodo
-    	for (int i = 0; i < max_size; i++) {
-		flag=0;
-        	if (dateInPeriod(diet[i].date, period) == 1) {
-            		for (int j = 0; j < max_size; j++) {
-				// Itera os valores obtidos para comparar se os IDs em ambos arrays sao iguais
-                		if (diet[i].ID == mealPlan[j].ID) { 
-					// Verifica se os valores estao no intervalo definido em MealPlan
-                   			if (diet[i].calories < mealPlan[j].minCal || diet[i].calories > mealPlan[j].maxCal) {
-						for (int l=0; l<100; l++) {
-							if (diet[i].ID == outOfRangeIDs[l]) {
-								flag=1;
-							}
-						}
-						if (flag == 0) {
-                        				outOfRangeIDs[count++] = diet[i].ID;
-                        				break;
-						}
-                    			}
-                		}
-            		}
-        	}
-    	}
-	sortDescending(outOfRangeIDs, count);
+		list->IDs = IDs;
+		list->capacity = capacity;
+	}
+	list->IDs[list->count++] = (int)batch->values[FIELD_ID][i];
+}
 
-	printf("IDs fora do intervalo de calorias no período definido:\n");
-    	for (int i = 0; i < count; i++) {
-        	printf("%d\n", outOfRangeIDs[i]);
-    	}
+int outOfRangeIDs(Diet *diet, MealPlan *mealPlan, Period period, int max_size, int numPlans, int **IDs) {
+	QueryKey key = {.ID = -1, .meal = "", .period = period};
+	// Uma dieta esta fora de algum plano do paciente se ficar abaixo do maior minimo ou acima do menor maximo
+	Aggregate limits[] = {{AGGREGATE_MAX, FIELD_MIN_CAL, FIELD_MIN_CAL}, {AGGREGATE_MIN, FIELD_MAX_CAL, FIELD_MAX_CAL}};
+	JoinField fields[] = {{FIELD_MIN_CAL, FIELD_MIN_CAL}, {FIELD_MAX_CAL, FIELD_MAX_CAL}};
+	SortKey order = {.field = FIELD_ID, .text = 0, .descending = 1};
+	IDList list = {.IDs = NULL, .count = 0, .capacity = 0, .status = 0};
 
-    	return count;
+	Operator *plans = aggregateOperator(scanOperator(mealPlan, numPlans, MEAL_PLAN), 0, limits, 2);
+	Operator *diets = filterOperator(scanOperator(diet, max_size, DIET), &key);
+	Operator *outside = rangeOperator(joinOperator(diets, plans, 0, fields, 2, 0, 0), FIELD_CALORIES, FIELD_MIN_CAL, FIELD_MAX_CAL, 0);
+	Operator *sorted = sortOperator(aggregateOperator(outside, 0, NULL, 0), &order, 1);
+
+	if (runPipeline(sorted, collectPatientID, &list) == -1 || list.status != 0) {
+		memFree(list.IDs);
+		*IDs = NULL;
+		return -1;
+	}
+	*IDs = list.IDs;
+	return list.count;
 }
 
-int listMealPlan(MealPlan *mealPlan, Period period, int max_size, char *mealType, int IDNum) {
-	int i, count=0;
-	
+int outOfRange(Diet *diet, MealPlan *mealPlan, Period period, int max_size, int numPlans) {
+	int *IDs;
+
+	printf("IDs fora do intervalo de calorias no período definido:\n");
+	int count = outOfRangeIDs(diet, mealPlan, period, max_size, numPlans, &IDs);
+	if (count == -1) {
+		printf("Memoria insuficiente.\n");
+		return 0;
+	}
+	for (int i = 0; i < count; i++) {
+		printf("%d\n", IDs[i]);
+	}
+	memFree(IDs);
+	return count;
+}
+
+static void printMealPlanHeader(Period period, char *mealType) {
 	printf("Lista das refeicoes: %s\n", mealType);
 	printf("Periodo: %02d-%02d-%04d - %02d-%02d-%04d\n", period.begin.day, period.begin.month, period.begin.year, period.end.day, period.end.month, period.end.year);
+}
 
-	for (i=0; i<max_size; i++) {
-		if (dateInPeriod(mealPlan[i].date, period) == 1 && (mealPlan[i].ID == IDNum) && !(strcmp(mealPlan[i].meal, mealType))) {
-			printf("Data: %02d-%02d-%04d, Calorias Minimas: %d, Calorias Maximas: %d\n", mealPlan[i].date.day, mealPlan[i].date.month, mealPlan[i].date.year, mealPlan[i].minCal, mealPlan[i].maxCal);
-			count++;
-		}
+static void printMealPlanRow(MealPlan *mealPlan) {
+	printf("Data: %02d-%02d-%04d, Calorias Minimas: %d, Calorias Maximas: %d\n", mealPlan->date.day, mealPlan->date.month, mealPlan->date.year, mealPlan->minCal, mealPlan->maxCal);
+}
+
+// Refeicoes listadas por 'listMealPlan'
+typedef struct {
+	MealPlan *mealPlan;
+	int *rows;
+	int count;
+} MealPlanList;
+
+static void printListedPlan(const Batch *batch, int i, void *context) {
+	MealPlanList *list = (MealPlanList *)context;
+	int row = batch->values[FIELD_ROW][i];
+
+	printMealPlanRow(&list->mealPlan[row]);
+	if (list->rows != NULL) {
+		list->rows[list->count] = row;
 	}
+	list->count++;
+}
 
-	return count;
+int listMealPlan(MealPlan *mealPlan, Period period, int max_size, char *mealType, int IDNum, int *rows) {
+	QueryKey key = {.ID = IDNum, .period = period};
+	MealPlanList list = {.mealPlan = mealPlan, .rows = rows, .count = 0};
+
+	printMealPlanHeader(period, mealType);
+
+	// No filtro, o ID -1 e a refeicao vazia aceitam qualquer registo; aqui nao correspondem a nenhum
+	if (IDNum == -1 || mealType[0] == '\0') {
+		return 0;
+	}
+	snprintf(key.meal, sizeof(key.meal), "%s", mealType);
+	if (runPipeline(filterOperator(scanOperator(mealPlan, max_size, MEAL_PLAN), &key), printListedPlan, &list) == -1) {
+		printf("Memoria insuficiente.\n");
+	}
+
+	return list.count;
+}
+
+void printMealPlanRows(MealPlan *mealPlan, Period period, char *mealType, const int *rows, int count) {
+	printMealPlanHeader(period, mealType);
+	for (int i = 0; i < count; i++) {
+		printMealPlanRow(&mealPlan[rows[i]]);
+	}
+}
+
+static void readAverage(const Batch *batch, int i, void *context) {
+        float *average = (float *)context;
+        *average = (float)batch->values[FIELD_SUM][i] / batch->values[FIELD_COUNT][i];
 }
 
 float averageCalories(Diet *diet, Period period, int max_size, char *mealType, int IDNum) {
-        int i, sum=0, count=0;
+        QueryKey key = {.ID = IDNum, .period = period};
+        Aggregate totals[] = {{AGGREGATE_SUM, FIELD_CALORIES, FIELD_SUM}, {AGGREGATE_COUNT, FIELD_CALORIES, FIELD_COUNT}};
         float averageCal = 0.0;
 
-        for (i=0; i<max_size; i++) {
-                if (dateInPeriod(diet[i].date, period) == 1 && (diet[i].ID == IDNum) && !strcmp(diet[i].meal, mealType)) {
-                        sum += diet[i].calories;
-                        count++;
-                }
+        if (IDNum == -1 || mealType[0] == '\0') {
+                return averageCal;
         }
-        if (count != 0) {
-                averageCal = (float)sum/count;
+        snprintf(key.meal, sizeof(key.meal), "%s", mealType);
+        // Com o paciente e a refeicao fixos ha no maximo um grupo
+        if (runPipeline(aggregateOperator(filterOperator(scanOperator(diet, max_size, DIET), &key), 0, totals, 2), readAverage, &averageCal) == -1) {
+                printf("Memoria insuficiente.\n");
         }
         return averageCal;
 }
 
-void printTable(MealPlan *mealPlans, Diet *diets, Patients *patients, int max_size) {
-	InfoTable infoTable[100] = {[0 ... 99] = {.patient = {.ID = -1, .name = "", .phoneNumber = 0}, .minCal = 0, .maxCal = 0, .calories = 0}}; // Inicializo todos a -1 para verificar quais posicoes estao vazias;
-								      
-	//Criando o array q vai ser usado para preencher a tabela. Comeco por iterar pelo array de mealPlans para buscar o tipo de refeicao associado a um utilizador e tambem o max e min de calorias totais para aquela refeicao
-	for (int plan = 0; plan<max_size && mealPlans[plan].ID != -1; plan++) {
-
-		for(int line = 0;line < 100;line++){
-			// Se percorrer ate achar um lugar vazio, tenho que adicionar uma nova entrada no infoTable
-			if (infoTable[line].patient.ID == -1) {
-				//Nova entrada na tabela
-				infoTable[line].patient.ID = mealPlans[plan].ID;
-				strcpy(infoTable[line].meal, mealPlans[plan].meal);
-				infoTable[line].period.begin = mealPlans[plan].date;
-				infoTable[line].period.end = mealPlans[plan].date;
-				infoTable[line].minCal = mealPlans[plan].minCal;
-				infoTable[line].maxCal = mealPlans[plan].maxCal;	
-				break;
-			} else if (infoTable[line].patient.ID == mealPlans[plan].ID && !(strcmp(infoTable[line].meal, mealPlans[plan].meal))) {
-				switch (dateInPeriod(mealPlans[plan].date, infoTable[line].period)) {
-					//Data antes, logo passa ser o inicio do periodo
-					case -1:
-						infoTable[line].period.begin = mealPlans[plan].date;
-						break;
-					//Data depois do periodo, logo passa a ser o fim do periodo
-					case 2:
-						infoTable[line].period.end = mealPlans[plan].date;
-						break;
-
-					default:
-						break;
-
-				}
-
-				printf("Vou alterar uma entrada existente\n");
-				infoTable[line].minCal += mealPlans[plan].minCal;
-				infoTable[line].maxCal += mealPlans[plan].maxCal;
-				break;
-			}
+static void printTableRow(const Batch *batch, int i, void *context) {
+	const Patients *patients = (const Patients *)context;
+	long patient = batch->values[FIELD_PATIENT][i];
+	Date begin = keyDate(batch->values[FIELD_FIRST_DATE][i]), end = keyDate(batch->values[FIELD_LAST_DATE][i]);
+
+	printf("| %04d | %-14s | %-14s | %02d-%02d-%04d | %02d-%02d-%04d | %8d | %8d | %8d |\n", (int)batch->values[FIELD_ID][i], patient != -1 ? patients[patient].name : "", batch->text[i], begin.day, begin.month, begin.year, end.day, end.month, end.year, (int)batch->values[FIELD_MIN_CAL][i], (int)batch->values[FIELD_MAX_CAL][i], (int)batch->values[FIELD_SUM][i]);
+}
+
+void printTable(MealPlan *mealPlans, int numMealPlans, Diet *diets, int numDiets, Patients *patients, int numPatients) {
+	Aggregate groups[] = {
+		{AGGREGATE_MIN, FIELD_DATE, FIELD_FIRST_DATE},
+		{AGGREGATE_MAX, FIELD_DATE, FIELD_LAST_DATE},
+		{AGGREGATE_SUM, FIELD_MIN_CAL, FIELD_MIN_CAL},
+		{AGGREGATE_SUM, FIELD_MAX_CAL, FIELD_MAX_CAL}
+	};
+	Aggregate consumed = {AGGREGATE_SUM, FIELD_CALORIES, FIELD_SUM};
+	JoinField periodFields[] = {{FIELD_FIRST_DATE, FIELD_FIRST_DATE}, {FIELD_LAST_DATE, FIELD_LAST_DATE}};
+	JoinField consumedField = {FIELD_SUM, FIELD_SUM};
+	JoinField patientField = {FIELD_ROW, FIELD_PATIENT};
+	SortKey order[] = {{.field = FIELD_ID, .text = 0, .descending = 0}, {.field = FIELD_ID, .text = 1, .descending = 0}};
+
+	// Cada grupo (paciente, refeicao) do plano da origem a uma linha; o periodo vai da primeira a ultima data do grupo
+	Operator *lines = aggregateOperator(scanOperator(mealPlans, numMealPlans, MEAL_PLAN), 1, groups, 4);
+
+	// O consumo de cada linha e a soma das dietas do mesmo paciente e refeicao dentro do periodo da linha
+	Operator *periods = aggregateOperator(scanOperator(mealPlans, numMealPlans, MEAL_PLAN), 1, groups, 2);
+	Operator *meals = joinOperator(scanOperator(diets, numDiets, DIET), periods, 1, periodFields, 2, 0, 0);
+	Operator *consumption = aggregateOperator(rangeOperator(meals, FIELD_DATE, FIELD_FIRST_DATE, FIELD_LAST_DATE, 1), 1, &consumed, 1);
+
+	lines = joinOperator(lines, consumption, 1, &consumedField, 1, 1, 0);
+	lines = joinOperator(lines, scanOperator(patients, numPatients, PATIENTS), 0, &patientField, 1, 1, -1);
+	lines = sortOperator(lines, order, 2);
+
+    	printf("+------+----------------+----------------+------------+------------+----------+----------+----------+\n");
+    	printf("| NP   | Paciente       | Tipo Refeição  | Início     | Fim        | Mínimo   | Máximo   | Consumo  |\n");
+    	printf("+------+----------------+----------------+------------+------------+----------+----------+----------+\n");
+
+	if (runPipeline(lines, printTableRow, patients) == -1) {
+		printf("Memoria insuficiente.\n");
+	}
+
+    	printf("+------+----------------+----------------+------------+------------+----------+----------+----------+\n");
+}
+
+
+static int compareDailyTotals(const void *a, const void *b) {
+	const DailyTotal *first = (const DailyTotal *)a;
+	const DailyTotal *second = (const DailyTotal *)b;
+
+	if (first->ID != second->ID) {
+		return (first->ID > second->ID) - (first->ID < second->ID);
+	}
+	return (first->day > second->day) - (first->day < second->day);
+}
+
+// Percorre os totais diarios de um unico paciente (ordenados por dia) com uma janela deslizante.
+// Cada passo custa O(1) amortizado: um dia entra na soma quando a janela o alcanca e sai quando a janela o ultrapassa.
+// Como cada paciente e independente, esta funcao pode ser chamada em paralelo para grupos diferentes.
+static int rollingWindowPatient(const DailyTotal *totals, int count, int window, int calories, int firstDay, int lastDay) {
+	int head = 0, tail = 0, ranges = 0, rangeBegin = 0, inRange = 0;
+	long sum = 0, limit = (long)calories * window;
+	int start = totals[0].day > firstDay ? totals[0].day : firstDay;
+	int end = totals[count - 1].day + window - 1 < lastDay ? totals[count - 1].day + window - 1 : lastDay;
+
+	for (int day = start; day <= end; day++) {
+		while (head < count && totals[head].day <= day) {
+			sum += totals[head++].calories;
 		}
+		while (tail < head && totals[tail].day <= day - window) {
+			sum -= totals[tail++].calories;
+		}
+
+		if (sum > limit && !inRange) {
+			inRange = 1;
+			rangeBegin = day;
+		} else if (sum <= limit && inRange) {
+			inRange = 0;
+			Date begin = daysToDate(rangeBegin), last = daysToDate(day - 1);
+			printf("Paciente %04d: %02d-%02d-%04d a %02d-%02d-%04d\n", totals[0].ID, begin.day, begin.month, begin.year, last.day, last.month, last.year);
+			ranges++;
+		}
+	}
+	if (inRange) {
+		Date begin = daysToDate(rangeBegin), last = daysToDate(end);
+		printf("Paciente %04d: %02d-%02d-%04d a %02d-%02d-%04d\n", totals[0].ID, begin.day, begin.month, begin.year, last.day, last.month, last.year);
+		ranges++;
+	}
+	return ranges;
+}
+
+int rollingCalories(Diet *diet, int max_size, int calories, int window, Period period) {
+	int firstDay = dateToDays(period.begin), lastDay = dateToDays(period.end);
+	int count = 0, patients = 0;
+
+	if (window < 1) {
+		return 0;
 	}
 
-	for (int line=0; (line < 100) && (infoTable[line].patient.ID != -1); line++) {
-		for (int patient=0; patient < max_size; patient++) {
-			if (infoTable[line].patient.ID == patients[patient].ID) {
-				strcpy(infoTable[line].patient.name, patients[patient].name);
-				break;
-			}
+	DailyTotal *totals = memAlloc(MEM_QUERY, sizeof(DailyTotal) * (max_size > 0 ? max_size : 1));
+	if (totals == NULL) {
+		printf("Memoria insuficiente.\n");
+		return -1;
+	}
+
+	// Os dias anteriores ao periodo entram nas primeiras janelas, para que a media no inicio do periodo seja correta
+	for (int i = 0; i < max_size; i++) {
+		if (diet[i].ID == -1) {
+			continue;
+		}
+		int day = dateToDays(diet[i].date);
+		if (day >= firstDay - window + 1 && day <= lastDay) {
+			totals[count++] = (DailyTotal){.ID = diet[i].ID, .day = day, .calories = diet[i].calories};
 		}
 	}
 
-	for (int line = 0; (line < 100) && (infoTable[line].patient.ID != -1); line++) {
-		for (int diet=0; diet<max_size && diets[diet].ID != -1; diet++) {
-			if ((infoTable[line].patient.ID == diets[diet].ID) && (dateInPeriod(diets[diet].date, infoTable[line].period) == 1) && (!strcmp(infoTable[line].meal, diets[diet].meal))) {
-				infoTable[line].calories += diets[diet].calories;
-				break;
-			}
+	qsort(totals, count, sizeof(DailyTotal), compareDailyTotals);
+
+	// Junta as refeicoes do mesmo paciente no mesmo dia num unico total diario
+	int daily = 0;
+	for (int i = 0; i < count; i++) {
+		if (daily > 0 && totals[daily - 1].ID == totals[i].ID && totals[daily - 1].day == totals[i].day) {
+			totals[daily - 1].calories += totals[i].calories;
+		} else {
+			totals[daily++] = totals[i];
 		}
 	}
 
-    	printf("+------+----------------+----------------+------------+------------+----------+----------+----------+\n");
-    	printf("| NP   | Paciente       | Tipo Refeição  | Início     | Fim        | Mínimo   | Máximo   | Consumo  |\n");
-    	printf("+------+----------------+----------------+------------+------------+----------+----------+----------+\n");
-	
-	for (int line = 0; line<100 && infoTable[line].patient.ID != -1; line++) {
-		printf("| %04d | %-14s | %-14s | %02d-%02d-%04d | %02d-%02d-%04d | %8d | %8d | %8d |\n", infoTable[line].patient.ID, infoTable[line].patient.name, infoTable[line].meal, infoTable[line].period.begin.day, infoTable[line].period.begin.month, infoTable[line].period.begin.year, infoTable[line].period.end.day, infoTable[line].period.end.month, infoTable[line].period.end.year, infoTable[line].minCal, infoTable[line].maxCal, infoTable[line].calories);
+	printf("Pacientes com media movel de %d dias acima de %d calorias:\n", window, calories);
+	for (int begin = 0, end; begin < daily; begin = end) {
+		for (end = begin + 1; end < daily && totals[end].ID == totals[begin].ID; end++) { }
+		if (rollingWindowPatient(&totals[begin], end - begin, window, calories, firstDay, lastDay) > 0) {
+			patients++;
+		}
+	}
+
+	memFree(totals);
+	return patients;
+}
+
+// Parametros da classificacao de 'topPatients'
+typedef struct {
+	Diet *diet;
+	PlanIndex *plans;
+	RankCriterion criterion;
+	long calories;
+} RankQuery;
+
+// Marca em FIELD_FLAG as refeicoes fora do intervalo do plano em vigor
+static void flagOutOfPlan(Batch *batch, void *context) {
+	const RankQuery *query = (const RankQuery *)context;
 
+	for (int i = 0; i < batch->count; i++) {
+		Diet *diet = &query->diet[batch->values[FIELD_ROW][i]];
+		const PlanVersion *plan = activePlan(query->plans, diet->ID, diet->meal, dateToDays(diet->date));
+		batch->values[FIELD_FLAG][i] = plan != NULL && (diet->calories < plan->minCal || diet->calories > plan->maxCal);
 	}
-	
-    	printf("+------+----------------+----------------+------------+------------+----------+----------+----------+\n");
+	batch->fields |= 1u << FIELD_FLAG;
+}
+
+// Remove os pacientes que nao ultrapassaram o limite (RANK_EXCESS)
+static void keepExcess(Batch *batch, void *context) {
+	const RankQuery *query = (const RankQuery *)context;
+	int kept = 0;
+
+	for (int i = 0; i < batch->count; i++) {
+		batch->values[FIELD_ID][kept] = batch->values[FIELD_ID][i];
+		batch->values[FIELD_SUM][kept] = batch->values[FIELD_SUM][i];
+		kept += batch->values[FIELD_SUM][i] > query->calories;
+	}
+	batch->fields = (1u << FIELD_ID) | (1u << FIELD_SUM);
+	batch->count = kept;
+}
+
+static double rankScore(const Batch *batch, int i, void *context) {
+	const RankQuery *query = (const RankQuery *)context;
+
+	switch (query->criterion) {
+		case RANK_EXCESS:
+			return batch->values[FIELD_SUM][i] - query->calories;
+		case RANK_OUT_OF_PLAN:
+			return (double)batch->values[FIELD_FLAG][i] / batch->values[FIELD_COUNT][i];
+		default:
+			return batch->values[FIELD_SUM][i];
+	}
+}
+
+// Pacientes devolvidos por 'rankPatients'
+typedef struct {
+	const RankQuery *query;
+	RankedPatient *ranked;
+	int count;
+	int capacity;
+	int status;
+} RankList;
+
+static void collectRank(const Batch *batch, int i, void *context) {
+	RankList *list = (RankList *)context;
+
+	if (list->count == list->capacity) {
+		int capacity = list->capacity > 0 ? list->capacity * 2 : 16;
+		RankedPatient *ranked = memRealloc(MEM_QUERY, list->ranked, sizeof(RankedPatient) * capacity);
+		if (ranked == NULL) {
+			list->status = -1;
+			return;
+		}
+		list->ranked = ranked;
+		list->capacity = capacity;
+	}
+	list->ranked[list->count].ID = (int)batch->values[FIELD_ID][i];
+	list->ranked[list->count].score = rankScore(batch, i, (void *)list->query);
+	list->count++;
+}
+
+int rankPatients(Diet *diet, int numDiets, MealPlan *mealPlan, int numPlans, Period period, RankCriterion criterion, int calories, int k, RankedPatient **ranked) {
+	RankQuery query = {.diet = diet, .plans = NULL, .criterion = criterion, .calories = calories};
+	RankList list = {.query = &query, .ranked = NULL, .count = 0, .capacity = 0, .status = 0};
+	QueryKey key = {.ID = -1, .meal = "", .period = period};
+	Aggregate totals[] = {
+		{AGGREGATE_SUM, FIELD_CALORIES, FIELD_SUM},
+		{AGGREGATE_COUNT, FIELD_CALORIES, FIELD_COUNT},
+		{AGGREGATE_SUM, FIELD_FLAG, FIELD_FLAG}
+	};
+
+	*ranked = NULL;
+	if (k < 1) {
+		return 0;
+	}
+
+	if (criterion == RANK_OUT_OF_PLAN) {
+		query.plans = buildPlanIndex(mealPlan, numPlans);
+		if (query.plans == NULL) {
+			return -1;
+		}
+	}
+
+	// Cada paciente e agregado numa tabela de dispersao e o top-K guarda apenas os 'k' melhores num heap minimo
+	Operator *meals = filterOperator(scanOperator(diet, numDiets, DIET), &key);
+	if (criterion == RANK_OUT_OF_PLAN) {
+		meals = mapOperator(meals, flagOutOfPlan, &query);
+	}
+	Operator *patients = aggregateOperator(meals, 0, totals, criterion == RANK_OUT_OF_PLAN ? 3 : 2);
+	if (criterion == RANK_EXCESS) {
+		patients = mapOperator(patients, keepExcess, &query);
+	}
+
+	int count = runPipeline(topOperator(patients, k, rankScore, &query), collectRank, &list);
+	freePlanIndex(query.plans);
+	if (count == -1 || list.status != 0) {
+		memFree(list.ranked);
+		return -1;
+	}
+	*ranked = list.ranked;
+	return list.count;
+}
+
+void printRanking(const RankedPatient *ranked, int count, RankCriterion criterion) {
+	for (int i = 0; i < count; i++) {
+		if (criterion == RANK_OUT_OF_PLAN) {
+			printf("%2d. %04d: %.1f%% das refeicoes fora do plano\n", i + 1, ranked[i].ID, ranked[i].score * 100);
+		} else {
+			printf("%2d. %04d: %.0f calorias\n", i + 1, ranked[i].ID, ranked[i].score);
+		}
+	}
+}
+
+int topPatients(Diet *diet, int numDiets, MealPlan *mealPlan, int numPlans, Period period, RankCriterion criterion, int calories, int k) {
+	RankedPatient *ranked;
+
+	if (k < 1) {
+		return 0;
+	}
+	printf("Top %d pacientes:\n", k);
+	int count = rankPatients(diet, numDiets, mealPlan, numPlans, period, criterion, calories, k, &ranked);
+	if (count == -1) {
+		printf("Memoria insuficiente.\n");
+		return -1;
+	}
+	printRanking(ranked, count, criterion);
+	memFree(ranked);
+	return count;
+}
+
+#define QUANTILE_THREADS 4
+
+// Resumo de quantis de um tipo de refeicao
+typedef struct {
+	char meal[50];
+	QuantileSketch *sketch;
+} MealSketch;
+
+// Parte das dietas processada por uma thread, com os resumos parciais que essa thread constroi
+typedef struct {
+	Diet *diet;
+	int count;
+	Period period;
+	int IDNum;
+	MealSketch *meals;
+	int numMeals;
+	int status;
+} QuantileTask;
+
+static void freeMealSketches(MealSketch *meals, int numMeals) {
+	for (int i = 0; i < numMeals; i++) {
+		freeSketch(meals[i].sketch);
+	}
+	memFree(meals);
+}
+
+// Devolve o resumo da refeicao, criando-o se ainda nao existir; os tipos de refeicao sao poucos
+static QuantileSketch *mealSketch(MealSketch **meals, int *numMeals, const char *meal) {
+	for (int i = 0; i < *numMeals; i++) {
+		if (!strcmp((*meals)[i].meal, meal)) {
+			return (*meals)[i].sketch;
+		}
+	}
+	MealSketch *grown = memRealloc(MEM_QUERY, *meals, sizeof(MealSketch) * (*numMeals + 1));
+	if (grown == NULL) {
+		return NULL;
+	}
+	*meals = grown;
+	QuantileSketch *sketch = createSketch();
+	if (sketch == NULL) {
+		return NULL;
+	}
+	strcpy(grown[*numMeals].meal, meal);
+	grown[*numMeals].sketch = sketch;
+	(*numMeals)++;
+	return sketch;
+}
+
+static void *buildQuantileSketches(void *arg) {
+	QuantileTask *task = (QuantileTask *)arg;
+
+	task->status = 0;
+	for (int i = 0; i < task->count; i++) {
+		Diet *diet = &task->diet[i];
+		if (diet->ID == -1 || (task->IDNum != -1 && diet->ID != task->IDNum) || dateInPeriod(diet->date, task->period) != 1) {
+			continue;
+		}
+		QuantileSketch *sketch = mealSketch(&task->meals, &task->numMeals, diet->meal);
+		if (sketch == NULL || sketchUpdate(sketch, diet->calories) != 0) {
+			task->status = -1;
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+static int compareMealSketches(const void *a, const void *b) {
+	return strcmp(((const MealSketch *)a)->meal, ((const MealSketch *)b)->meal);
 }
 
+int calorieQuantiles(Diet *diet, int max_size, Period period, int IDNum) {
+	QuantileTask tasks[QUANTILE_THREADS] = {0};
+	pthread_t threads[QUANTILE_THREADS];
+	int started[QUANTILE_THREADS] = {0};
+	int numTasks = max_size >= 65536 ? QUANTILE_THREADS : 1, status = 0;
+
+	// Cada thread resume uma parte contigua das dietas; os resumos parciais sao depois fundidos
+	for (int i = 0; i < numTasks; i++) {
+		tasks[i].diet = diet + (long)max_size * i / numTasks;
+		tasks[i].count = (long)max_size * (i + 1) / numTasks - (long)max_size * i / numTasks;
+		tasks[i].period = period;
+		tasks[i].IDNum = IDNum;
+		// A primeira parte e resumida pela thread atual
+		started[i] = i > 0 && pthread_create(&threads[i], NULL, buildQuantileSketches, &tasks[i]) == 0;
+	}
+	buildQuantileSketches(&tasks[0]);
+	for (int i = 1; i < numTasks; i++) {
+		if (started[i]) {
+			pthread_join(threads[i], NULL);
+		} else {
+			buildQuantileSketches(&tasks[i]);
+		}
+	}
+
+	for (int i = 1; i < numTasks; i++) {
+		for (int meal = 0; meal < tasks[i].numMeals && status == 0; meal++) {
+			QuantileSketch *sketch = mealSketch(&tasks[0].meals, &tasks[0].numMeals, tasks[i].meals[meal].meal);
+			if (sketch == NULL || sketchMerge(sketch, tasks[i].meals[meal].sketch) != 0) {
+				status = -1;
+			}
+		}
+		if (tasks[i].status != 0) {
+			status = -1;
+		}
+		freeMealSketches(tasks[i].meals, tasks[i].numMeals);
+	}
+	if (tasks[0].status != 0 || status != 0) {
+		printf("Memoria insuficiente.\n");
+		freeMealSketches(tasks[0].meals, tasks[0].numMeals);
+		return -1;
+	}
+
+	MealSketch *meals = tasks[0].meals;
+	int numMeals = tasks[0].numMeals;
+	qsort(meals, numMeals, sizeof(MealSketch), compareMealSketches);
+
+	printf("%-20s | %9s | %7s | %7s | %7s | %5s\n", "Refeicao", "Registos", "Mediana", "P90", "P99", "Erro");
+	for (int i = 0; i < numMeals; i++) {
+		QuantileSketch *sketch = meals[i].sketch;
+		printf("%-20s | %9ld | %7d | %7d | %7d | %4.1f%%\n", meals[i].meal, sketchCount(sketch), sketchQuantile(sketch, 0.5),
+			sketchQuantile(sketch, 0.9), sketchQuantile(sketch, 0.99), sketchRankError(sketch) * 100);
+	}
+	printf("Erro: desvio maximo da posicao de cada quantil, em percentagem dos registos (99%% de confianca).\n");
+
+	freeMealSketches(meals, numMeals);
+	return numMeals;
+}
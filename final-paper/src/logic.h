@@ -20,6 +20,9 @@
  * - Verificação do consumo calórico em relação aos planos alimentares.
  * - Listagem de refeições conforme critérios específicos.
  * - Cálculo da média de calorias consumidas por um paciente.
+ * - Deteção de médias móveis diárias acima de um limite.
+ * - Classificação dos K pacientes com pior consumo calórico.
+ * - Estimativa dos quantis de calorias de cada tipo de refeição.
  *
  * @note Este ficheiro depende das definições das estruturas de dados em 'types.h'.
  */
@@ -31,28 +34,34 @@
  *
  * Esta função constrói e imprime uma tabela detalhada que mostra o plano alimentar de cada paciente,
  * incluindo os tipos de refeição, o período de cada plano, as calorias mínimas e máximas estipuladas,
- * e o total de calorias consumidas. A função itera sobre os arrays 'mealPlans' e 'diets', preenchendo
- * uma estrutura auxiliar 'infoTable' para armazenar as informações consolidadas antes de imprimir.
+ * e o total de calorias consumidas. A consulta é executada por lotes (ver 'pipeline.h'): os planos são
+ * agrupados por (paciente, refeição), as dietas são juntadas com o período de cada grupo por dispersão e
+ * somadas, e o resultado é juntado com o consumo e com os pacientes antes de ser ordenado. O consumo de cada
+ * linha é a soma de todas as dietas do mesmo paciente e refeição dentro do período do plano. Cada array é
+ * percorrido uma vez e apenas as linhas da tabela são ordenadas.
  *
  * @param mealPlans Ponteiro para o array de estruturas 'MealPlan', representando os planos alimentares.
  * @param diets Ponteiro para o array de estruturas 'Diet', representando o consumo de calorias dos pacientes.
  * @param patients Ponteiro para o array de estruturas 'Patients', contendo informações sobre os pacientes.
- * @param max_size Tamanho máximo dos arrays 'mealPlans', 'diets' e 'patients'.
+ * @param numMealPlans Número de elementos no array 'mealPlans'.
+ * @param numDiets Número de elementos no array 'diets'.
+ * @param numPatients Número de elementos no array 'patients'.
  *
  * @note Esta função pressupõe que os arrays 'mealPlans', 'diets' e 'patients' são válidos e que o tamanho máximo
  *       dos arrays é respeitado. Além disso, assume-se que os IDs dos pacientes são únicos.
  *
- * @warning A função utiliza um array fixo 'infoTable' de tamanho 100 para armazenar as informações consolidadas.
- *          Se houver mais de 100 pacientes únicos, a tabela não poderá representar todos eles.
+ * @note As linhas são apresentadas por ordem de paciente e tipo de refeição. Entradas com ID -1 são ignoradas.
+ *
+ * @warning Se não houver memória para a consulta, a tabela é impressa sem linhas.
  */
-void printTable(MealPlan *mealPlans, Diet *diets, Patients *patients, int max_size);
+void printTable(MealPlan *mealPlans, int numMealPlans, Diet *diets, int numDiets, Patients *patients, int numPatients);
 
 /**
  * @brief Calcula o número de pacientes que excederam um limite de calorias num determinado período.
  *
  * Esta função percorre um array de estruturas 'Diet' e identifica quantos pacientes
  * consumiram mais calorias do que o limite especificado durante um período de tempo definido.
- * Usa um array auxiliar 'idCalories' para armazenar e somar as calorias consumidas por cada paciente.
+ * As calorias de cada paciente são somadas por lotes, numa tabela de dispersão (ver 'pipeline.h').
  *
  * @param diet Ponteiro para o array de estruturas 'Diet', que contém os dados de consumo de calorias.
  * @param max_size Tamanho máximo do array 'diet'.
@@ -60,13 +69,10 @@ void printTable(MealPlan *mealPlans, Diet *diets, Patients *patients, int max_si
  * @param period Estrutura 'Period' que define o período de tempo durante o qual o consumo é avaliado.
  *
  * @return Retorna o número de pacientes que excederam o limite de calorias no período especificado.
- *         Retorna -1 se o número de pacientes únicos exceder 100, indicando que o limite do array foi atingido.
+ *         Retorna -1 se não houver memória.
  *
  * @note Esta função pressupõe que o array 'diet' e a estrutura 'period' são válidos e que o tamanho máximo
  *       do array 'diet' é respeitado nas chamadas da função.
- *
- * @warning A função utiliza um array fixo de tamanho 100 para rastrear os pacientes. Se houver mais de 100
- *          pacientes únicos no período especificado, a função não poderá rastreá-los todos e retornará -1.
  */
 int exceededCalories(Diet *diet,int max_size, int calories, Period period);
 
@@ -75,22 +81,41 @@ int exceededCalories(Diet *diet,int max_size, int calories, Period period);
  *
  * Esta função compara o consumo calórico dos pacientes, registrado no array 'diet', com os intervalos
  * calóricos definidos no seu plano de refeições, 'mealPlan', durante um determinado período. Os IDs dos
- * pacientes cuja ingestão calórica esteja fora do intervalo são armazenados e contados.
+ * pacientes cuja ingestão calórica esteja fora do intervalo são impressos por ordem decrescente e contados.
+ * Os planos são reduzidos ao maior mínimo e ao menor máximo de cada paciente e juntados com as dietas do
+ * período por dispersão, pelo que o custo é O(dietas + planos) em vez de O(dietas × planos).
  *
  * @param diet Ponteiro para o array de estruturas 'Diet', que contém os dados de consumo de calorias dos pacientes.
  * @param mealPlan Ponteiro para o array de estruturas 'MealPlan', que define os intervalos calóricos para os pacientes.
  * @param period Estrutura 'Period' que define o período de tempo durante o qual o consumo é avaliado.
- * @param max_size Tamanho máximo dos arrays 'diet' e 'mealPlan'.
+ * @param max_size Tamanho máximo do array 'diet'.
+ * @param numPlans Número de elementos no array 'mealPlan'.
  *
  * @return Retorna o número de pacientes cujo consumo de calorias está fora do intervalo estipulado no seu plano de refeições.
  *
  * @note Esta função pressupõe que os arrays 'diet' e 'mealPlan' são válidos, e que o tamanho máximo dos arrays é respeitado.
  *       Além disso, assume-se que os IDs dos pacientes são únicos.
  *
- * @warning A função utiliza um array fixo de tamanho 100 para armazenar os IDs dos pacientes. Se houver mais de 100
- *          pacientes únicos no período especificado, a função não poderá rastrear todos e os resultados podem não ser completos.
+ * @warning Se não houver memória para a consulta, a lista fica incompleta e é retornado 0.
+ */
+int outOfRange(Diet *diet, MealPlan *mealPlan, Period period, int max_size, int numPlans);
+
+/**
+ * @brief Devolve os IDs dos pacientes cujo consumo ficou fora do intervalo do seu plano num período.
+ *
+ * Faz o mesmo cálculo que 'outOfRange', mas guarda os IDs num array em vez de os imprimir. É usada por
+ * 'outOfRange' e pela versão por local de 'sites.h', que junta as listas de cada local.
+ *
+ * @param diet Ponteiro para o array de estruturas 'Diet'.
+ * @param mealPlan Ponteiro para o array de estruturas 'MealPlan'.
+ * @param period Estrutura 'Period' que define o período avaliado.
+ * @param max_size Número de elementos no array 'diet'.
+ * @param numPlans Número de elementos no array 'mealPlan'.
+ * @param IDs Recebe o array com os IDs, por ordem decrescente, a libertar com 'memFree'.
+ *
+ * @return Retorna o número de IDs, ou -1 se não houver memória.
  */
-int outOfRange(Diet *diet, MealPlan *mealPlan, Period period, int max_size);
+int outOfRangeIDs(Diet *diet, MealPlan *mealPlan, Period period, int max_size, int numPlans, int **IDs);
 
 /**
  * @brief Lista as refeições de um plano alimentar para um paciente específico num dado período.
@@ -104,6 +129,8 @@ int outOfRange(Diet *diet, MealPlan *mealPlan, Period period, int max_size);
  * @param max_size Tamanho máximo do array 'mealPlan'.
  * @param mealType String que representa o tipo de refeição a ser listada (ex: "almoço", "jantar").
  * @param IDNum Identificador numérico do paciente para o qual as refeições serão listadas.
+ * @param rows Array opcional (pode ser NULL) que recebe as posições, no array 'mealPlan', das refeições listadas.
+ *             Deve ter espaço para 'max_size' elementos. Permite guardar o resultado na cache de consultas.
  *
  * @return Retorna o número de refeições listadas que correspondem aos critérios especificados.
  *
@@ -114,7 +141,21 @@ int outOfRange(Diet *diet, MealPlan *mealPlan, Period period, int max_size);
  *          dos resultados, podendo ser menos adequada para grandes conjuntos de dados ou para a integração em interfaces
  *          de utilizador mais complexas.
  */
-int listMealPlan(MealPlan *mealPlan, Period period, int max_size, char *mealType, int IDNum);
+int listMealPlan(MealPlan *mealPlan, Period period, int max_size, char *mealType, int IDNum, int *rows);
+
+/**
+ * @brief Imprime uma lista de refeições de um plano alimentar já calculada anteriormente.
+ *
+ * Esta função produz exatamente a mesma saída que 'listMealPlan', mas a partir das posições das refeições
+ * em vez de percorrer o array 'mealPlan'. É usada quando o resultado da consulta está na cache.
+ *
+ * @param mealPlan Ponteiro para o array de estruturas 'MealPlan'.
+ * @param period Estrutura 'Period' da consulta original.
+ * @param mealType String com o tipo de refeição da consulta original.
+ * @param rows Posições das refeições a imprimir.
+ * @param count Número de elementos de 'rows'.
+ */
+void printMealPlanRows(MealPlan *mealPlan, Period period, char *mealType, const int *rows, int count);
 
 /**
  * @brief Calcula a média de calorias consumidas por um paciente num tipo específico de refeição durante um período.
@@ -140,4 +181,100 @@ int listMealPlan(MealPlan *mealPlan, Period period, int max_size, char *mealType
  */
 float averageCalories(Diet *diet, Period period, int max_size, char *mealType, int IDNum);
 
+/**
+ * @brief Identifica os pacientes cuja média móvel diária de calorias excedeu um limite num período.
+ *
+ * Esta função reduz o array 'diet' a totais diários por paciente, ordena-os por paciente e data e
+ * percorre cada paciente com uma janela deslizante de 'window' dias. A soma da janela é atualizada
+ * em O(1) a cada dia (entra o dia novo, sai o dia mais antigo), pelo que o custo total é proporcional
+ * ao número de dias analisados e não a dias × janela. Os dias sem registos contam como 0 calorias.
+ * São impressos os pacientes e os intervalos de datas em que a média da janela terminada nesse dia
+ * ultrapassou 'calories'.
+ *
+ * @param diet Ponteiro para o array de estruturas 'Diet', que contém os dados de consumo de calorias.
+ * @param max_size Tamanho máximo do array 'diet'.
+ * @param calories Limite da média diária de calorias.
+ * @param window Número de dias da janela deslizante (ex: 7).
+ * @param period Estrutura 'Period' com os dias em que a média é avaliada.
+ *
+ * @return Retorna o número de pacientes com pelo menos um dia acima do limite, ou -1 se não houver memória.
+ *
+ * @note As refeições dos 'window' - 1 dias anteriores ao início do período também entram nas primeiras janelas.
+ *       Cada paciente é processado de forma independente, o que permite dividir o trabalho por pacientes.
+ */
+int rollingCalories(Diet *diet, int max_size, int calories, int window, Period period);
+
+/**
+ * @brief Lista os K pacientes com pior consumo calórico num período, segundo um critério.
+ *
+ * Esta função agrega o consumo de cada paciente no período numa tabela de dispersão e mantém
+ * um heap mínimo limitado a 'k' elementos com os melhores candidatos (ver 'topOperator'). Cada paciente
+ * custa O(log k) e a memória da classificação é O(k), independentemente do número de pacientes. Em caso de
+ * empate fica primeiro o menor ID.
+ *
+ * Os critérios disponíveis são:
+ * - RANK_TOTAL: total de calorias consumidas.
+ * - RANK_EXCESS: calorias consumidas acima de 'calories' (só entram os pacientes acima do limite).
+ * - RANK_OUT_OF_PLAN: fração das refeições fora do intervalo mínimo/máximo do plano em vigor, ou seja,
+ *   o plano do mesmo paciente e refeição com a data mais recente que não seja posterior à refeição. O plano
+ *   em vigor de cada refeição é procurado no índice de intervalos dos planos (ver 'planindex.h'), em O(log n).
+ *
+ * @param diet Ponteiro para o array de estruturas 'Diet'.
+ * @param numDiets Número de elementos no array 'diet'.
+ * @param mealPlan Ponteiro para o array de estruturas 'MealPlan' (usado apenas por RANK_OUT_OF_PLAN).
+ * @param numPlans Número de elementos no array 'mealPlan'.
+ * @param period Estrutura 'Period' que define o período avaliado.
+ * @param criterion Critério de classificação.
+ * @param calories Limite de calorias usado por RANK_EXCESS.
+ * @param k Número máximo de pacientes a apresentar.
+ *
+ * @return Retorna o número de pacientes listados, ou -1 se não houver memória.
+ */
+int topPatients(Diet *diet, int numDiets, MealPlan *mealPlan, int numPlans, Period period, RankCriterion criterion, int calories, int k);
+
+/**
+ * @brief Calcula a classificação de 'topPatients' sem a imprimir.
+ *
+ * Os pacientes ficam por ordem decrescente de pontuação e, em caso de empate, por ordem crescente de ID.
+ *
+ * @param diet Ponteiro para o array de estruturas 'Diet'.
+ * @param numDiets Número de elementos no array 'diet'.
+ * @param mealPlan Ponteiro para o array de estruturas 'MealPlan' (usado apenas por RANK_OUT_OF_PLAN).
+ * @param numPlans Número de elementos no array 'mealPlan'.
+ * @param period Estrutura 'Period' que define o período avaliado.
+ * @param criterion Critério de classificação.
+ * @param calories Limite de calorias usado por RANK_EXCESS.
+ * @param k Número máximo de pacientes a devolver.
+ * @param ranked Recebe o array com os pacientes classificados, a libertar com 'memFree'.
+ *
+ * @return Retorna o número de pacientes em 'ranked', ou -1 se não houver memória.
+ */
+int rankPatients(Diet *diet, int numDiets, MealPlan *mealPlan, int numPlans, Period period, RankCriterion criterion, int calories, int k, RankedPatient **ranked);
+
+/**
+ * @brief Imprime uma classificação calculada por 'rankPatients', numerada a partir de 1.
+ *
+ * @param ranked Array com os pacientes classificados.
+ * @param count Número de elementos de 'ranked'.
+ * @param criterion Critério usado na classificação, que define a forma de apresentar a pontuação.
+ */
+void printRanking(const RankedPatient *ranked, int count, RankCriterion criterion);
+
+/**
+ * @brief Imprime a mediana e os percentis 90 e 99 das calorias de cada tipo de refeição num período.
+ *
+ * Esta função constrói um resumo de quantis ('sketch.h') por tipo de refeição, com memória limitada
+ * independentemente do número de registos. Para muitos registos, o array é dividido por várias threads,
+ * cada uma com os seus resumos, que são fundidos no fim. Para cada refeição é impresso também o erro máximo
+ * da posição dos quantis, que é 0 quando o número de registos é pequeno o suficiente para o cálculo ser exato.
+ *
+ * @param diet Ponteiro para o array de estruturas 'Diet'.
+ * @param max_size Número de elementos no array 'diet'.
+ * @param period Estrutura 'Period' que define o período avaliado.
+ * @param IDNum ID do paciente, ou -1 para considerar todos os pacientes.
+ *
+ * @return Retorna o número de tipos de refeição listados, ou -1 se não houver memória.
+ */
+int calorieQuantiles(Diet *diet, int max_size, Period period, int IDNum);
+
 #endif // LOGIC_H
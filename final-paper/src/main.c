@@ -2,10 +2,21 @@
 #include "logic.h"
 #include "types.h"
 #include "menu.h"
+#include "loader.h"
+#include "cache.h"
+#include "ingest.h"
+#include "diskindex.h"
+#include "alerts.h"
+#include "profile.h"
+#include "planner.h"
+#include "sample.h"
+#include "memtrack.h"
 
+#include <pthread.h>
 #include <string.h>
 #include <stdio.h>
-#define MAX_SIZE 100
+#include <stdlib.h>
+#include <time.h>
 
 /**
  * @file main.c
@@ -18,80 +29,236 @@
  * calórico, listar planos nutricionais, calcular a média de calorias consumidas e visualizar uma tabela de informações.
  *
  * As operações implementadas neste ficheiro fazem uso intensivo das funções definidas em 'utils.h' e 'logic.h',
- * e dos tipos de dados definidos em 'types.h'. Dados iniciais são carregados de ficheiros de texto, e o utilizador
- * pode interagir com estes dados através de várias opções de menu.
+ * e dos tipos de dados definidos em 'types.h'. Dados iniciais são carregados de ficheiros de texto em simultâneo
+ * através de 'loader.h', e o utilizador pode interagir com estes dados através de várias opções de menu.
  *
  * @note Este ficheiro depende das definições em 'utils.h', 'logic.h' e 'types.h' para a sua funcionalidade.
  *
+ * Os argumentos que não começam por '--' são diretorias de dados (por omissão 'data'). Com várias diretorias,
+ * cada uma é tratada como um local e os IDs dos pacientes recebem o prefixo do local (ver 'loadSites').
+ *
  * @warning A função 'main' assume que os ficheiros de dados necessários estão disponíveis e no formato correto.
  *          O programa pode não funcionar como esperado se estes ficheiros estiverem ausentes ou malformados.
  */
 
-int main () {
-	int choice;
-	
-	Diet diets[MAX_SIZE];
-	Patients patients[MAX_SIZE];
-	MealPlan mealPlans[MAX_SIZE];
+// Escrita em segundo plano de '--live': insere um ficheiro enquanto o menu continua disponivel
+typedef struct {
+	Dataset *dataset;
+	char *path;
+	FileType fileType;
+	int count;
+} LiveIngest;
+
+static void *liveIngestTask(void *arg) {
+	LiveIngest *task = (LiveIngest *)arg;
+	task->count = ingestFile(task->dataset, task->path, task->fileType);
+	return NULL;
+}
+
+int main (int argc, char *argv[]) {
+	int choice, lazy = 0, buildIndex = 0, live = 0, memoryReport = 0;
+	size_t cacheBudget = 1 << 20;
+	char *ingestPath = NULL;
+	char *alertSink = NULL;
+	FileType ingestType = DIET;
+	char *directories[argc > 1 ? argc : 1];
+	int numDirectories = 0;
+	Dataset dataset;
 	
-	initializeDiets(diets, MAX_SIZE);
-	initializePatients(patients, MAX_SIZE);
-	initializeMealPlans(mealPlans, MAX_SIZE);
+	// '--lazy' adia a interpretacao de cada coluna ate a primeira consulta que precisa dela
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--lazy")) {
+			lazy = 1;
+		} else if (!strcmp(argv[i], "--live")) {
+			// Com '--ingest-diet=' ou '--ingest-plan=', insere o ficheiro em segundo plano e mostra o menu
+			live = 1;
+		} else if (!strcmp(argv[i], "--profile")) {
+			// Mede o carregamento e cada consulta com os contadores de hardware (ver 'profile.h')
+			setProfiling(1);
+		} else if (!strcmp(argv[i], "--explain")) {
+			// Mostra o plano escolhido para cada consulta e o numero de registos estimado e real (ver 'planner.h')
+			setExplain(1);
+		} else if (!strncmp(argv[i], "--memory-budget=", 16)) {
+			// Orcamento de memoria de cada subsistema, em MB, no formato indices:64,cache:8 (ver 'memtrack.h')
+			if (parseMemoryBudgets(argv[i] + 16) != 0) {
+				printf("Orcamento de memoria invalido: %s\n", argv[i] + 16);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--approximate") || !strncmp(argv[i], "--approximate=", 14)) {
+			// As opcoes 1 e 4 respondem a partir de uma amostra das dietas, com o erro relativo pedido em % (5 por omissao)
+			double error = argv[i][13] == '=' ? strtod(argv[i] + 14, NULL) : 5;
+			if (error <= 0 || error >= 100) {
+				printf("Erro pretendido invalido: %s\n", argv[i] + 14);
+				return 1;
+			}
+			setSampleError(error / 100);
+		} else if (!strcmp(argv[i], "--memory-report")) {
+			// Escreve a memoria usada por cada subsistema no stderr antes de terminar
+			memoryReport = 1;
+		} else if (!strncmp(argv[i], "--cache-budget=", 15)) {
+			// Memoria maxima, em bytes, da cache de resultados (0 desativa a cache)
+			cacheBudget = strtoul(argv[i] + 15, NULL, 10);
+		} else if (!strcmp(argv[i], "--build-index")) {
+			// Constroi o indice em disco usado por '--lazy' nas consultas sobre um paciente e termina
+			buildIndex = 1;
+		} else if (!strncmp(argv[i], "--ingest-diet=", 14)) {
+			ingestPath = argv[i] + 14;
+			ingestType = DIET;
+		} else if (!strncmp(argv[i], "--ingest-plan=", 14)) {
+			ingestPath = argv[i] + 14;
+			ingestType = MEAL_PLAN;
+		} else if (!strncmp(argv[i], "--alerts=", 9)) {
+			// Destino dos alertas de dietas inseridas fora do plano: stdout, file:<caminho> ou unix:<caminho>
+			alertSink = argv[i] + 9;
+		} else if (strncmp(argv[i], "--", 2)) {
+			// Os restantes argumentos sao diretorias de dados, uma por local
+			directories[numDirectories++] = argv[i];
+		}
+	}
+	if (numDirectories == 0) {
+		directories[numDirectories++] = "data";
+	}
+	if (buildIndex) {
+		int status = 0;
+		for (int i = 0; i < numDirectories; i++) {
+			int keys = buildDiskIndex(directories[i]);
+			if (keys < 0) {
+				status = 1;
+			} else {
+				printf("Indice de %s construido: %d chaves\n", directories[i], keys);
+			}
+		}
+		return status;
+	}
 	
-	int numPatients = readFile("data/patients.txt", patients, MAX_SIZE, PATIENTS);
-	if (numPatients == -1) {
-		printf("Erro ao ler dados dos pacientes.\n");
+	// Os tres ficheiros sao lidos em simultaneo, cada um na sua thread; varias diretorias sao lidas tambem em paralelo
+	profileBegin();
+	int status = numDirectories == 1 ? loadDataset(&dataset, directories[0], lazy) : loadSites(&dataset, directories, numDirectories);
+	if (status != 0) {
+		printf("Erro ao ler os ficheiros de dados.\n");
 		return 1;
 	}
+	profileEnd(lazy ? "loadDataset (--lazy)" : "loadDataset", (long)dataset.numPatients + dataset.numDiets + dataset.numMealPlans);
+	dataset.cache = createCache(cacheBudget);
+	// Os registos novos sao escritos em lotes de 4096 linhas, com um unico fsync por lote
+	// Com varios locais os IDs tem prefixo, pelo que a escrita so esta disponivel com uma unica diretoria
+	if (numDirectories == 1) {
+		dataset.log = openIngestLog(directories[0], 4096);
+	}
+	// O monitor de alertas comeca com todos os planos ja existentes; os planos inseridos depois sao acrescentados por 'ingestMealPlan'
+	if (alertSink != NULL && dataset.log != NULL) {
+		dataset.alerts = createAlertMonitor(alertSink);
+		if (dataset.alerts == NULL || requireColumns(&dataset, MEAL_PLAN, COL_ALL) != 0) {
+			freeDataset(&dataset);
+			return 1;
+		}
+		for (int i = 0; i < dataset.numMealPlans; i++) {
+			if (alertAddPlan(dataset.alerts, &dataset.mealPlans[i]) != 0) {
+				printf("Memoria insuficiente.\n");
+				freeDataset(&dataset);
+				return 1;
+			}
+		}
+	}
 	
-	int numDiets = readFile("data/diet.txt", diets, MAX_SIZE, DIET);
-	if (numDiets == -1) {
-		printf("Erro ao ler dados da dieta.\n");
-		return 1;
+	// '--ingest-diet=<ficheiro>' e '--ingest-plan=<ficheiro>' acrescentam os registos do ficheiro e terminam
+	if (ingestPath != NULL && !live) {
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		int count = ingestFile(&dataset, ingestPath, ingestType);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		printf("%d registos inseridos em %.3f s (%.0f registos/s)\n", count, seconds, seconds > 0 ? count / seconds : 0.0);
+		printIngestStats(dataset.log);
+		printAlertStats(dataset.alerts);
+		if (memoryReport) {
+			printMemoryReport(stderr);
+		}
+		freeDataset(&dataset);
+		return count < 0;
 	}
 	
-	int numMealPlans = readFile("data/mealPlan.txt", mealPlans, MAX_SIZE, MEAL_PLAN);
-	if (numMealPlans == -1) {
-		printf("Erro ao ler dados do plano alimentar.\n");
-		return 1;
+	// Com '--live' as consultas leem a ultima versao publicada pela escrita, sem a bloquear (ver 'epoch.h')
+	LiveIngest liveIngest = {.dataset = &dataset, .path = ingestPath, .fileType = ingestType, .count = 0};
+	pthread_t writer;
+	if (ingestPath != NULL) {
+		if (dataset.log == NULL || requireColumns(&dataset, PATIENTS, COL_ALL) != 0 || requireColumns(&dataset, DIET, COL_ALL) != 0 ||
+				requireColumns(&dataset, MEAL_PLAN, COL_ALL) != 0 || publishSnapshot(&dataset) != 0 ||
+				pthread_create(&writer, NULL, liveIngestTask, &liveIngest) != 0) {
+			printf("Nao foi possivel iniciar a escrita em segundo plano.\n");
+			freeDataset(&dataset);
+			return 1;
+		}
 	}
 	
 	do {
 		choice = showMenuAndGetChoice();
 		
+		// Com a escrita em segundo plano, cada consulta le os seus parametros e so depois toma a ultima versao
+		// publicada dos dados, durante o calculo (ver 'beginQuery' em 'menu.c')
 		switch (choice) {
 		    case 1:
-			    handleExceededCalories(diets, MAX_SIZE);
-			    waitForUserInput();
+			    handleExceededCalories(&dataset);
 			    break;
 		    case 2:
-			    handleOutOfRange(diets, mealPlans, numDiets);
-			    waitForUserInput();
+			    handleOutOfRange(&dataset);
 			    break;
 		
 		    case 3:
-			    handleMealPlan(mealPlans, MAX_SIZE);
-			    waitForUserInput();
+			    handleMealPlan(&dataset);
 			    break;
 		
 		    case 4:
-			    handleAverageCalories(diets, numDiets);
-			    waitForUserInput();
+			    handleAverageCalories(&dataset);
 			    break;
 		
 		    case 5:
-			    handlePrintTable(mealPlans, diets, patients, MAX_SIZE);
-			    waitForUserInput();
+			    handlePrintTable(&dataset);
+			    break;
+		
+		    case 6:
+			    handleRollingCalories(&dataset);
+			    break;
+		
+		    case 7:
+			    handleTopPatients(&dataset);
+			    break;
+		
+		    case 8:
+			    handleStats(&dataset);
+			    break;
+		
+		    case 9:
+			    if (ingestPath != NULL) {
+				    printf("Com --live, os registos sao inseridos apenas pela escrita em segundo plano.\n");
+			    } else {
+				    handleIngest(&dataset);
+			    }
+			    break;
+		
+		    case 10:
+			    handleCalorieQuantiles(&dataset);
 			    break;
 		
 		    case 0:
-			    return 0;
+			    break;
 		
 		    default:
 			    printf("Escolha indisponivel\n");
 		            break;
 		}
+		if (choice >= 1 && choice <= 10) {
+			waitForUserInput();
+		}
 	} while (choice != 0);
 	
+	if (ingestPath != NULL) {
+		pthread_join(writer, NULL);
+		printf("Escrita em segundo plano: %d registos inseridos\n", liveIngest.count);
+	}
+	if (memoryReport) {
+		printMemoryReport(stderr);
+	}
+	freeDataset(&dataset);
 	return 0;
 }
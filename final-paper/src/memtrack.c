@@ -0,0 +1,170 @@
+#include "memtrack.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file memtrack.c
+ * @brief Implementação da camada de reserva de memória com contabilização por subsistema.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'memtrack.h'. Cada bloco é precedido por um
+ * cabeçalho de 16 bytes com o tamanho pedido e o subsistema, o que mantém o alinhamento devolvido por 'malloc'.
+ * Os contadores são atualizados com operações atómicas, porque os ficheiros são carregados em várias threads e
+ * a escrita de '--live' corre em paralelo com as consultas. Os bytes contabilizados são os pedidos, sem o
+ * cabeçalho.
+ *
+ * O orçamento é verificado depois de os bytes serem somados ao subsistema: se o total passar o orçamento, os
+ * bytes são devolvidos e a reserva falha. Duas reservas simultâneas nunca ultrapassam assim o orçamento juntas.
+ */
+
+// Cabecalho guardado antes de cada bloco
+typedef struct {
+	size_t size;
+	int tag;
+	int unused;
+} BlockHeader;
+
+// Contadores de um subsistema
+typedef struct {
+	size_t live;
+	size_t peak;
+	size_t budget;
+	long allocations;
+	long refused;
+} MemoryCounters;
+
+static MemoryCounters counters[NUM_MEMORY_TAGS];
+
+static const char *tagNames[NUM_MEMORY_TAGS] = {"registos", "texto", "indices", "cache", "consultas", "escrita"};
+
+// Soma 'size' bytes ao subsistema; devolve -1, sem alterar o total, se o orcamento for ultrapassado
+static int reserve(MemoryTag tag, size_t size) {
+	MemoryCounters *counter = &counters[tag];
+	size_t live = __atomic_add_fetch(&counter->live, size, __ATOMIC_RELAXED);
+	size_t budget = __atomic_load_n(&counter->budget, __ATOMIC_RELAXED);
+
+	if (budget != 0 && live > budget) {
+		__atomic_sub_fetch(&counter->live, size, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&counter->refused, 1, __ATOMIC_RELAXED);
+		return -1;
+	}
+	size_t peak = __atomic_load_n(&counter->peak, __ATOMIC_RELAXED);
+	while (live > peak && !__atomic_compare_exchange_n(&counter->peak, &peak, live, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+	return 0;
+}
+
+static void release(MemoryTag tag, size_t size) {
+	__atomic_sub_fetch(&counters[tag].live, size, __ATOMIC_RELAXED);
+}
+
+void *memAlloc(MemoryTag tag, size_t size) {
+	if (reserve(tag, size) != 0) {
+		return NULL;
+	}
+	BlockHeader *header = malloc(sizeof(BlockHeader) + size);
+	if (header == NULL) {
+		release(tag, size);
+		return NULL;
+	}
+	header->size = size;
+	header->tag = tag;
+	__atomic_add_fetch(&counters[tag].allocations, 1, __ATOMIC_RELAXED);
+	return header + 1;
+}
+
+void *memCalloc(MemoryTag tag, size_t count, size_t size) {
+	if (size != 0 && count > (size_t)-1 / size) {
+		return NULL;
+	}
+	void *pointer = memAlloc(tag, count * size);
+	if (pointer != NULL) {
+		memset(pointer, 0, count * size);
+	}
+	return pointer;
+}
+
+void *memRealloc(MemoryTag tag, void *pointer, size_t size) {
+	if (pointer == NULL) {
+		return memAlloc(tag, size);
+	}
+	BlockHeader *header = (BlockHeader *)pointer - 1;
+	MemoryTag owner = (MemoryTag)header->tag;
+	size_t oldSize = header->size;
+
+	if (size > oldSize && reserve(owner, size - oldSize) != 0) {
+		return NULL;
+	}
+	BlockHeader *resized = realloc(header, sizeof(BlockHeader) + size);
+	if (resized == NULL) {
+		if (size > oldSize) {
+			release(owner, size - oldSize);
+		}
+		return NULL;
+	}
+	if (size < oldSize) {
+		release(owner, oldSize - size);
+	}
+	resized->size = size;
+	return resized + 1;
+}
+
+void memFree(void *pointer) {
+	if (pointer == NULL) {
+		return;
+	}
+	BlockHeader *header = (BlockHeader *)pointer - 1;
+	release((MemoryTag)header->tag, header->size);
+	free(header);
+}
+
+void setMemoryBudget(MemoryTag tag, size_t bytes) {
+	__atomic_store_n(&counters[tag].budget, bytes, __ATOMIC_RELAXED);
+}
+
+int parseMemoryBudgets(const char *spec) {
+	while (*spec != '\0') {
+		const char *colon = strchr(spec, ':');
+		if (colon == NULL) {
+			return -1;
+		}
+		int tag = 0;
+		while (tag < NUM_MEMORY_TAGS && (strlen(tagNames[tag]) != (size_t)(colon - spec) || strncmp(spec, tagNames[tag], colon - spec) != 0)) {
+			tag++;
+		}
+		char *end;
+		unsigned long megabytes = strtoul(colon + 1, &end, 10);
+		if (tag == NUM_MEMORY_TAGS || end == colon + 1 || (*end != ',' && *end != '\0')) {
+			return -1;
+		}
+		setMemoryBudget((MemoryTag)tag, megabytes << 20);
+		spec = *end == ',' ? end + 1 : end;
+	}
+	return 0;
+}
+
+void printMemoryReport(FILE *out) {
+	size_t live = 0, peak = 0;
+
+	fprintf(out, "Memoria por subsistema (KB):\n");
+	fprintf(out, "%-10s %12s %12s %10s %9s %10s\n", "", "em uso", "maximo", "reservas", "recusas", "orcamento");
+	for (int tag = 0; tag < NUM_MEMORY_TAGS; tag++) {
+		MemoryCounters counter;
+		counter.live = __atomic_load_n(&counters[tag].live, __ATOMIC_RELAXED);
+		counter.peak = __atomic_load_n(&counters[tag].peak, __ATOMIC_RELAXED);
+		counter.budget = __atomic_load_n(&counters[tag].budget, __ATOMIC_RELAXED);
+		counter.allocations = __atomic_load_n(&counters[tag].allocations, __ATOMIC_RELAXED);
+		counter.refused = __atomic_load_n(&counters[tag].refused, __ATOMIC_RELAXED);
+		live += counter.live;
+		peak += counter.peak;
+
+		fprintf(out, "%-10s %12zu %12zu %10ld %9ld ", tagNames[tag], counter.live >> 10, counter.peak >> 10, counter.allocations, counter.refused);
+		if (counter.budget != 0) {
+			fprintf(out, "%10zu\n", counter.budget >> 10);
+		} else {
+			fprintf(out, "%10s\n", "-");
+		}
+	}
+	// O maximo total e a soma dos maximos de cada subsistema, que podem ter ocorrido em momentos diferentes
+	fprintf(out, "%-10s %12zu %12zu\n", "total", live >> 10, peak >> 10);
+}
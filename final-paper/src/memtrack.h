@@ -0,0 +1,94 @@
+#ifndef MEMTRACK_H
+#define MEMTRACK_H
+
+#include "types.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @file memtrack.h
+ * @brief Cabeçalho da camada de reserva de memória com contabilização por subsistema.
+ *
+ * Este ficheiro de cabeçalho declara as funções pelas quais passa toda a memória reservada pelo programa. Cada
+ * bloco é atribuído a um subsistema ('MemoryTag'), guardado num pequeno cabeçalho antes do bloco, e para cada
+ * subsistema são mantidos os bytes em uso, o máximo atingido e o número de reservas.
+ *
+ * Cada subsistema pode ter um orçamento. Uma reserva que o ultrapasse falha como se não houvesse memória, e
+ * cada subsistema reage a essa falha à sua maneira:
+ * - a cache de resultados descarta os resultados menos usados até o novo caber;
+ * - o índice por data e as estatísticas do planeador não são construídos, e as consultas percorrem os registos;
+ * - nos restantes subsistemas a operação falha com "Memoria insuficiente.".
+ *
+ * Os blocos reservados por estas funções têm de ser libertados com 'memFree', e nunca com 'free'.
+ */
+
+/**
+ * @brief Reserva um bloco de memória para um subsistema.
+ *
+ * @param tag Subsistema a que o bloco é atribuído.
+ * @param size Tamanho do bloco, em bytes.
+ *
+ * @return Retorna o bloco, ou NULL se não houver memória ou se o orçamento do subsistema for ultrapassado.
+ */
+void *memAlloc(MemoryTag tag, size_t size);
+
+/**
+ * @brief Reserva um bloco de memória inicializado a zero para um subsistema.
+ *
+ * @param tag Subsistema a que o bloco é atribuído.
+ * @param count Número de elementos.
+ * @param size Tamanho de cada elemento, em bytes.
+ *
+ * @return Retorna o bloco, ou NULL se não houver memória ou se o orçamento do subsistema for ultrapassado.
+ */
+void *memCalloc(MemoryTag tag, size_t count, size_t size);
+
+/**
+ * @brief Altera o tamanho de um bloco, mantendo o seu conteúdo.
+ *
+ * @param tag Subsistema a que o bloco é atribuído, se 'pointer' for NULL. Um bloco existente mantém o seu subsistema.
+ * @param pointer Bloco a alterar (pode ser NULL).
+ * @param size Novo tamanho, em bytes.
+ *
+ * @return Retorna o bloco com o novo tamanho, ou NULL se não houver memória ou se o orçamento do subsistema for
+ *         ultrapassado (nesse caso o bloco original não é alterado).
+ */
+void *memRealloc(MemoryTag tag, void *pointer, size_t size);
+
+/**
+ * @brief Liberta um bloco reservado por 'memAlloc', 'memCalloc' ou 'memRealloc'.
+ *
+ * @param pointer Bloco a libertar (pode ser NULL).
+ */
+void memFree(void *pointer);
+
+/**
+ * @brief Define o orçamento de um subsistema.
+ *
+ * @param tag Subsistema.
+ * @param bytes Número máximo de bytes em uso pelo subsistema, ou 0 para não ter limite.
+ */
+void setMemoryBudget(MemoryTag tag, size_t bytes);
+
+/**
+ * @brief Interpreta uma lista de orçamentos no formato "<subsistema>:<MB>[,<subsistema>:<MB>...]".
+ *
+ * Os nomes dos subsistemas são os usados no relatório ("registos", "texto", "indices", "cache", "consultas"
+ * e "escrita").
+ *
+ * @param spec Lista de orçamentos.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se a lista for inválida (os orçamentos já interpretados ficam definidos).
+ */
+int parseMemoryBudgets(const char *spec);
+
+/**
+ * @brief Escreve a repartição da memória por subsistema: bytes em uso, máximo atingido, reservas, reservas
+ *        recusadas pelo orçamento e orçamento.
+ *
+ * @param out Ficheiro onde o relatório é escrito (ex: stdout ou stderr).
+ */
+void printMemoryReport(FILE *out);
+
+#endif // MEMTRACK_H
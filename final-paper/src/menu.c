@@ -2,6 +2,18 @@
 #include "menu.h"
 #include "logic.h"
 #include "types.h"
+#include "loader.h"
+#include "cache.h"
+#include "ingest.h"
+#include "sites.h"
+#include "diskindex.h"
+#include "alerts.h"
+#include "profile.h"
+#include "schema.h"
+#include "planner.h"
+#include "sample.h"
+#include "rowstore.h"
+#include "memtrack.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,125 +32,608 @@
  */
 
 
+// O indice em disco so e usado enquanto as colunas ainda nao foram interpretadas em memoria
+static int useDiskIndex(Dataset *dataset, FileType fileType, unsigned columns) {
+        return dataset->diskIndex != NULL && (dataset->lazyFiles[fileType].parsed & columns) != columns;
+}
+
 /**
- * @brief Inicializa um array de Diet com valores padrão.
+ * @brief Começa a parte de uma consulta que lê as dietas e os planos, depois de lidos todos os parâmetros.
+ *
+ * Com a escrita em segundo plano ('dataset->snapshot' não é NULL), a consulta lê a última versão publicada
+ * ('beginRead'). A vista só é tomada depois de o utilizador escrever os parâmetros: enquanto a vista está aberta
+ * a memória retirada pela escrita não pode ser libertada, e a consulta responde sobre a versão mais recente.
+ * Os pacientes e os seus índices não são alterados pela escrita e podem ser lidos antes, em 'dataset'.
+ *
+ * @param dataset Conjunto de dados carregado.
+ * @param view Estrutura que recebe a vista, se houver escrita em segundo plano.
  *
- * @param diets Array de estruturas Diet a ser inicializado.
- * @param size Tamanho do array a ser inicializado.
+ * @return Retorna o conjunto de dados a consultar ('dataset' ou 'view'), ou NULL se já existirem demasiadas
+ *         consultas em simultaneo.
  */
-void initializeDiets(Diet diets[], int size) {
-        for (int i = 0; i < size; i++) {
-                diets[i] = (Diet){.ID = -1, .date = {0}, .meal = "", .food = "", .calories = 0};
+static Dataset *beginQuery(Dataset *dataset, Dataset *view) {
+        if (__atomic_load_n(&dataset->snapshot, __ATOMIC_ACQUIRE) == NULL) {
+                return dataset;
         }
+        if (beginRead(dataset, view) != 0) {
+                printf("Demasiadas consultas em simultaneo.\n");
+                return NULL;
+        }
+        return view;
 }
 
-
-/**
- * @brief Inicializa um array de Patients com valores padrão.
- *
- * @param patients Array de estruturas Patients a ser inicializado.
- * @param size Tamanho do array a ser inicializado.
- */
-void initializePatients(Patients patients[], int size) {
-        for (int i = 0; i < size; i++) {
-                patients[i] = (Patients){.ID = -1, .name = "", .phoneNumber = 0};
+// Termina a parte da consulta iniciada por 'beginQuery'
+static void endQuery(Dataset *dataset, Dataset *target) {
+        if (target != dataset) {
+                endRead();
         }
 }
 
 /**
- * @brief Inicializa um array de MealPlan com valores padrão.
+ * @brief Lê um paciente indicado pelo ID, pelo nome completo ou pelo início do nome.
+ *
+ * Um número é usado diretamente como ID. Caso contrário, o texto é procurado primeiro como nome completo
+ * e depois como prefixo; se o prefixo corresponder a vários pacientes, estes são listados e o pedido repete-se.
  *
- * @param mealPlans Array de estruturas MealPlan a ser inicializado.
- * @param size Tamanho do array a ser inicializado.
+ * @param dataset Conjunto de dados carregado.
+ *
+ * @return Retorna o ID do paciente, ou -1 se nenhum paciente corresponder ao texto.
  */
-void initializeMealPlans(MealPlan mealPlans[], int size) {
-        for (int i = 0; i < size; i++) {
-                mealPlans[i] = (MealPlan){.ID = -1, .date = {0}, .meal = "", .minCal = 0, .maxCal = 0};
+static int readPatientID(Dataset *dataset) {
+        char text[50], *end;
+
+        if (scanf(" %49[^\n]", text) != 1) {
+                return -1;
         }
+        for (int length = strlen(text); length > 0 && (text[length - 1] == ' ' || text[length - 1] == '\r'); length--) {
+                text[length - 1] = 0;
+        }
+        long ID = strtol(text, &end, 10);
+        if (end != text && *end == '\0') {
+                return (int)ID;
+        }
+
+        if (requireColumns(dataset, PATIENTS, COL_ID | COL_NAME) != 0) {
+                printf("Memoria insuficiente.\n");
+                return -1;
+        }
+        int row = findPatientByName(dataset, text);
+        if (row != -1) {
+                return dataset->patients[row].ID;
+        }
+        int first, count = patientsWithPrefix(dataset, text, &first);
+        if (count == 0) {
+                printf("Paciente nao encontrado.\n");
+                return -1;
+        }
+        if (count == 1) {
+                return dataset->patients[dataset->patientsByName[first]].ID;
+        }
+        printf("%d pacientes comecam por '%s':\n", count, text);
+        for (int i = 0; i < count && i < 10; i++) {
+                Patients *patient = &dataset->patients[dataset->patientsByName[first + i]];
+                printf("  %04d - %s\n", patient->ID, patient->name);
+        }
+        if (count > 10) {
+                printf("  ...\n");
+        }
+        printf("Escreva o ID ou o nome completo do paciente: \n");
+        return readPatientID(dataset);
 }
 
+// Parte de 'handleExceededCalories' que le as dietas, depois de lidos os parametros
+static void exceededCaloriesQuery(Dataset *dataset, int caloriesLimit, Period period) {
+        Estimate estimate;
+        if (dataset->sample != NULL) {
+                profileBegin();
+                int status = estimateExceededCalories(dataset->sample, caloriesLimit, period, &estimate);
+                profileEnd("estimateExceededCalories", status == 0 ? estimate.sampleRows : 0);
+                if (status == 0) {
+                        printf("Numero de pacientes que excederam a quantidade de calorias no periodo definido: ~%.0f (IC 95%%: %.0f a %.0f, %ld dietas da amostra)\n",
+                                estimate.value, estimate.low, estimate.high, estimate.sampleRows);
+                        return;
+                }
+        }
+        QueryKey key = {.kind = QUERY_EXCEEDED_CALORIES, .ID = -1, .period = period, .limit = caloriesLimit};
+        size_t size;
+        const int *cached = cacheLookup(dataset->cache, &key, &size);
+        int count;
+        if (cached != NULL) {
+                count = *cached;
+                explainPlan(NULL, 0);
+        } else {
+                QueryPlan plan = planQuery(dataset, &key, 0);
+                Diet *diets = NULL;
+                int numDiets = dataset->numDiets;
+                if (plan.path == PLAN_DATE_INDEX && (diets = memAlloc(MEM_QUERY, sizeof(Diet) * (numDiets > 0 ? numDiets : 1))) == NULL) {
+                        printf("Memoria insuficiente.\n");
+                        return;
+                }
+                profileBegin();
+                if (plan.path == PLAN_PARALLEL_SITES) {
+                        count = parallelExceededCalories(dataset, caloriesLimit, period);
+                } else if (plan.path == PLAN_DATE_INDEX) {
+                        numDiets = dietsInPeriod(dataset, period, diets);
+                        count = exceededCalories(diets, numDiets, caloriesLimit, period);
+                } else {
+                        count = exceededCalories(dataset->diets, numDiets, caloriesLimit, period);
+                }
+                profileEnd("exceededCalories", numDiets);
+                if (explaining()) {
+                        explainPlan(&plan, matchingRows(plan.path == PLAN_DATE_INDEX ? diets : dataset->diets, numDiets, DIET, &key));
+                }
+                memFree(diets);
+                if (count >= 0) {
+                        cacheStore(dataset->cache, &key, &count, sizeof(count));
+                }
+        }
+        printf("Numero de pacientes que excederam a quantidade de calorias no periodo definido: %d\n", count);
+}
 
 /**
  * @brief Processa e exibe o número de pacientes que excederam um limite de calorias.
  *
- * @param diets Array de Diet contendo informações dietéticas.
- * @param size Tamanho do array de Diet.
+ * O planeador escolhe entre percorrer todas as dietas e passar a 'exceededCalories' apenas as dietas do
+ * período, obtidas através do índice por data, conforme a fração de dietas que o período abrange.
+ * Com vários locais, cada local é avaliado em paralelo e os resultados parciais são somados.
+ * O resultado fica guardado na cache de resultados, identificado pelo limite e pelo período.
+ * No modo aproximado, a resposta é estimada a partir da amostra das dietas (ver 'sample.h').
+ *
+ * @param dataset Conjunto de dados carregado.
  */
-void handleExceededCalories(Diet diets[], int size) {
+void handleExceededCalories(Dataset *dataset) {
+        // A amostra precisa tambem da refeicao, para ser construida no modo preguicoso
+        if (requireColumns(dataset, DIET, COL_ID | COL_DATE | COL_CALORIES | (sampleError() > 0 ? COL_MEAL : 0)) != 0) {
+                printf("Memoria insuficiente.\n");
+                return;
+        }
         int caloriesLimit;
         Period period;
         printf("Limite de calorias: \n");
         scanf("%d", &caloriesLimit);
         fillPeriod(&period);
-        printf("Numero de pacientes que excederam a quantidade de calorias no periodo definido: %d\n", exceededCalories(diets, size, caloriesLimit, period));
+        Dataset view, *target = beginQuery(dataset, &view);
+        if (target != NULL) {
+                exceededCaloriesQuery(target, caloriesLimit, period);
+                endQuery(dataset, target);
+        }
 }
 
 /**
  * @brief Identifica e exibe refeições que estão fora do intervalo calórico estabelecido.
  *
- * @param diets Array de Diet contendo informações dietéticas.
- * @param mealPlans Array de MealPlan.
- * @param numDiets Número de elementos no array de Diet.
+ * @param dataset Conjunto de dados carregado.
  */
-void handleOutOfRange(Diet diets[], MealPlan mealPlans[], int numDiets) {
+void handleOutOfRange(Dataset *dataset) {
+        if (requireColumns(dataset, DIET, COL_ID | COL_DATE | COL_CALORIES) != 0 ||
+                requireColumns(dataset, MEAL_PLAN, COL_ID | COL_LIMITS) != 0) {
+                printf("Memoria insuficiente.\n");
+                return;
+        }
         Period period;
         fillPeriod(&period);
-        int count = outOfRange(diets, mealPlans, period, numDiets);
+        Dataset view, *target = beginQuery(dataset, &view);
+        if (target == NULL) {
+                return;
+        }
+        profileBegin();
+        int count;
+        if (target->numSites > 0) {
+                count = parallelOutOfRange(target, period);
+        } else {
+                count = outOfRange(target->diets, target->mealPlans, period, target->numDiets, target->numMealPlans);
+        }
+        profileEnd("outOfRange", target->numDiets + target->numMealPlans);
         printf("Numero de refeicoes caloricas fora do intervalo: %d\n", count);
+        endQuery(dataset, target);
 }
 
 
+// Parte de 'handleMealPlan' que le os planos, depois de lidos os parametros
+static void mealPlanQuery(Dataset *dataset, int IDPatient, char *mealName, Period period) {
+        unsigned columns = COL_ID | COL_DATE | COL_MEAL | COL_LIMITS;
+QueryKey key = {.kind = QUERY_MEAL_PLAN, .ID = IDPatient, .period = period};
+        strcpy(key.meal, mealName);
+        size_t size;
+        MealPlan *plans = NULL;
+        int count;
+        const int *cached = cacheLookup(dataset->cache, &key, &size);
+        if (cached != NULL) {
+                printMealPlanRows(dataset->mealPlans, period, mealName, cached, size / sizeof(int));
+                explainPlan(NULL, size / sizeof(int));
+        } else {
+                QueryPlan plan = planQuery(dataset, &key, useDiskIndex(dataset, MEAL_PLAN, columns));
+                if (plan.path == PLAN_DISK_INDEX && (count = readIndexedRows(dataset->diskIndex, MEAL_PLAN, IDPatient, mealName, (void **)&plans)) >= 0) {
+                        // As linhas lidas do indice nao estao no array 'mealPlans', por isso o resultado nao fica na cache
+                        count = listMealPlan(plans, period, count, mealName, IDPatient, NULL);
+                        memFree(plans);
+                } else {
+                        if (requireColumns(dataset, MEAL_PLAN, columns) != 0) {
+                                printf("Memoria insuficiente.\n");
+                                return;
+                        }
+                        int first = 0, slice, *positions = NULL;
+                        MealPlan *candidates = dataset->mealPlans;
+                        if (plan.path == PLAN_PATIENT_INDEX) {
+                                if ((slice = patientRows(dataset, MEAL_PLAN, IDPatient, period, &positions, (void **)&plans)) < 0) {
+                                        printf("Memoria insuficiente.\n");
+                                        return;
+                                }
+                                candidates = plans;
+                        } else {
+                                patientSlice(dataset, IDPatient, MEAL_PLAN, &first, &slice);
+                                candidates += first;
+                        }
+                        int *rows = memAlloc(MEM_QUERY, sizeof(int) * (slice > 0 ? slice : 1));
+                        count = listMealPlan(candidates, period, slice, mealName, IDPatient, rows);
+                        if (rows != NULL) {
+                                // As posicoes devolvidas sao relativas a 'candidates'
+                                for (int i = 0; i < count; i++) {
+                                        rows[i] = positions != NULL ? positions[rows[i]] : rows[i] + first;
+                                }
+                                cacheStore(dataset->cache, &key, rows, sizeof(int) * count);
+                        }
+                        memFree(rows);
+                        memFree(positions);
+                        memFree(plans);
+                }
+                explainPlan(&plan, count);
+        }
+        printf("Plano nutricional para a refeicao '%s' do paciente com ID %d listado.\n", mealName, IDPatient);
+}
+
 /**
  * @brief Gerencia e exibe um plano de refeições para um paciente específico.
  *
- * @param mealPlans Array de MealPlan.
- * @param size Tamanho do array de MealPlan.
+ * O planeador escolhe entre percorrer os planos do local do paciente, copiar apenas os planos do paciente no
+ * período (a partir das posições guardadas no armazenamento dos planos) e, no modo preguiçoso com índice em disco e enquanto os
+ * planos não forem lidos, ler apenas as linhas do paciente e da refeição pedidos. As posições das refeições
+ * listadas ficam guardadas na cache de resultados; repetir a mesma consulta imprime-as diretamente, sem
+ * percorrer o array de planos.
+ *
+ * @param dataset Conjunto de dados carregado.
  */
-void handleMealPlan(MealPlan mealPlans[], int size) {
+void handleMealPlan(Dataset *dataset) {
+        if (requireColumns(dataset, PATIENTS, COL_ID | COL_NAME) != 0) {
+                printf("Memoria insuficiente.\n");
+                return;
+        }
         int IDPatient;
         char mealName[50];
         Period period;
-        printf("ID do paciente: \n");
-        scanf("%d", &IDPatient);
+        printf("Paciente (ID ou nome): \n");
+        IDPatient = readPatientID(dataset);
+        if (IDPatient == -1) {
+                return;
+        }
+        int row = findPatientRow(dataset, IDPatient);
+        if (row != -1) {
+                printf("Paciente: %s\n", dataset->patients[row].name);
+        }
         printf("Refeicao: \n");
         scanf("%s", mealName);
         fillPeriod(&period);
-        listMealPlan(mealPlans, period, size, mealName, IDPatient);
-        printf("Plano nutricional para a refeicao '%s' do paciente com ID %d listado.\n", mealName, IDPatient);
+        Dataset view, *target = beginQuery(dataset, &view);
+        if (target != NULL) {
+                mealPlanQuery(target, IDPatient, mealName, period);
+                endQuery(dataset, target);
+        }
+}
+
+// Parte de 'handleAverageCalories' que le as dietas, depois de lidos os parametros
+static void averageCaloriesQuery(Dataset *dataset, int IDPatient, char *mealName, Period period) {
+        unsigned columns = COL_ID | COL_DATE | COL_MEAL | COL_CALORIES;
+        float avgCal;
+Estimate estimate;
+        // No modo preguicoso a amostra so e construida quando as colunas das dietas sao interpretadas
+        if (sampleError() > 0 && requireColumns(dataset, DIET, columns) == 0 && dataset->sample != NULL) {
+                profileBegin();
+                int status = estimateAverageCalories(dataset->sample, period, mealName, IDPatient, &estimate);
+                profileEnd("estimateAverageCalories", status == 0 ? estimate.sampleRows : 0);
+                if (status == 0) {
+                        printf("A média de calorias para '%s' do paciente com ID %d é: ~%.0f (IC 95%%: %.0f a %.0f, %ld dietas da amostra)\n",
+                                mealName, IDPatient, estimate.value, estimate.low, estimate.high, estimate.sampleRows);
+                        return;
+                }
+        }
+        QueryKey key = {.kind = QUERY_AVERAGE_CALORIES, .ID = IDPatient, .period = period};
+        strcpy(key.meal, mealName);
+        size_t size;
+        const float *cached = cacheLookup(dataset->cache, &key, &size);
+        if (cached != NULL) {
+                avgCal = *cached;
+                explainPlan(NULL, 0);
+        } else {
+                QueryPlan plan = planQuery(dataset, &key, useDiskIndex(dataset, DIET, columns));
+                Diet *copy = NULL, *rows;
+                int count = plan.path == PLAN_DISK_INDEX ? readIndexedRows(dataset->diskIndex, DIET, IDPatient, mealName, (void **)&copy) : -1;
+                rows = copy;
+                if (count < 0) {
+                        if (requireColumns(dataset, DIET, columns) != 0) {
+                                printf("Memoria insuficiente.\n");
+                                return;
+                        }
+                        if (plan.path == PLAN_PATIENT_INDEX) {
+                                if ((count = patientRows(dataset, DIET, IDPatient, period, NULL, (void **)&copy)) < 0) {
+                                        printf("Memoria insuficiente.\n");
+                                        return;
+                                }
+                                rows = copy;
+                        } else {
+                                int first;
+                                patientSlice(dataset, IDPatient, DIET, &first, &count);
+                                rows = dataset->diets + first;
+                        }
+                }
+                avgCal = averageCalories(rows, period, count, mealName, IDPatient);
+                if (explaining()) {
+                        explainPlan(&plan, matchingRows(rows, count, DIET, &key));
+                }
+                memFree(copy);
+                cacheStore(dataset->cache, &key, &avgCal, sizeof(avgCal));
+        }
+        printf("A média de calorias para '%s' do paciente com ID %d é: %.0f\n", mealName, IDPatient, avgCal);
 }
 
 /**
  * @brief Calcula e exibe a média de calorias consumidas por um paciente.
  *
- * @param diets Array de Diet.
- * @param numDiets Número de elementos no array de Diet.
+ * O planeador escolhe entre percorrer as dietas do local do paciente, copiar apenas as dietas do paciente no
+ * período (a partir das posições guardadas no armazenamento das dietas) e, no modo preguiçoso com índice em disco e enquanto as
+ * dietas não forem lidas, ler apenas as linhas do paciente e da refeição pedidos. A média calculada fica
+ * guardada na cache de resultados, identificada pelo paciente, refeição e período.
+ * No modo aproximado, a média é estimada a partir da amostra das dietas (ver 'sample.h').
+ *
+ * @param dataset Conjunto de dados carregado.
  */
-void handleAverageCalories(Diet diets[], int numDiets) {
+void handleAverageCalories(Dataset *dataset) {
         int IDPatient;
-        float avgCal;
         char mealName[50];
         Period period;
-        printf("ID do paciente: \n");
-        scanf("%d", &IDPatient);
+        printf("Paciente (ID ou nome): \n");
+        IDPatient = readPatientID(dataset);
         clearInputBuffer();
+        if (IDPatient == -1) {
+                return;
+        }
         printf("Refeicao: \n");
         fgets(mealName, sizeof(mealName), stdin);
         mealName[strcspn(mealName, "\n")] = 0;
         fillPeriod(&period);
-        avgCal = averageCalories(diets, period, numDiets, mealName, IDPatient);
-        printf("A média de calorias para '%s' do paciente com ID %d é: %.0f\n", mealName, IDPatient, avgCal);
+        Dataset view, *target = beginQuery(dataset, &view);
+        if (target != NULL) {
+                averageCaloriesQuery(target, IDPatient, mealName, period);
+                endQuery(dataset, target);
+        }
+}
+
+/**
+ * @brief Processa e exibe os pacientes cuja média móvel de calorias excedeu um limite.
+ *
+ * @param dataset Conjunto de dados carregado.
+ */
+void handleRollingCalories(Dataset *dataset) {
+        if (requireColumns(dataset, DIET, COL_ID | COL_DATE | COL_CALORIES) != 0) {
+                printf("Memoria insuficiente.\n");
+                return;
+        }
+        int caloriesLimit, window;
+        Period period;
+        printf("Limite da media diaria de calorias: \n");
+        scanf("%d", &caloriesLimit);
+        printf("Numero de dias da janela (ex: 7): \n");
+        scanf("%d", &window);
+        fillPeriod(&period);
+        Dataset view, *target = beginQuery(dataset, &view);
+        if (target == NULL) {
+                return;
+        }
+        profileBegin();
+        int count = rollingCalories(target->diets, target->numDiets, caloriesLimit, window, period);
+        profileEnd("rollingCalories", target->numDiets);
+        printf("Numero de pacientes acima do limite: %d\n", count);
+        endQuery(dataset, target);
+}
+
+/**
+ * @brief Processa e exibe os K pacientes com pior consumo calórico segundo um critério.
+ *
+ * @param dataset Conjunto de dados carregado.
+ */
+void handleTopPatients(Dataset *dataset) {
+        if (requireColumns(dataset, DIET, COL_ID | COL_DATE | COL_MEAL | COL_CALORIES) != 0 ||
+                requireColumns(dataset, MEAL_PLAN, COL_ID | COL_DATE | COL_MEAL | COL_LIMITS) != 0) {
+                printf("Memoria insuficiente.\n");
+                return;
+        }
+        int criterion, k, caloriesLimit = 0;
+        Period period;
+        printf("Criterio (1-Total de calorias, 2-Excesso sobre o limite, 3-Refeicoes fora do plano): \n");
+        scanf("%d", &criterion);
+        if (criterion < RANK_TOTAL || criterion > RANK_OUT_OF_PLAN) {
+                printf("Criterio invalido\n");
+                return;
+        }
+        if (criterion == RANK_EXCESS) {
+                printf("Limite de calorias: \n");
+                scanf("%d", &caloriesLimit);
+        }
+        printf("Numero de pacientes (K): \n");
+        scanf("%d", &k);
+        fillPeriod(&period);
+        Dataset view, *target = beginQuery(dataset, &view);
+        if (target == NULL) {
+                return;
+        }
+        profileBegin();
+        if (target->numSites > 0) {
+                parallelTopPatients(target, period, criterion, caloriesLimit, k);
+        } else {
+                topPatients(target->diets, target->numDiets, target->mealPlans, target->numMealPlans, period, criterion, caloriesLimit, k);
+        }
+        profileEnd("topPatients", target->numDiets + target->numMealPlans);
+        endQuery(dataset, target);
 }
 
 /**
  * @brief Exibe uma tabela com informações consolidadas de dietas e planos de refeições.
  *
- * @param mealPlans Array de MealPlan.
- * @param diets Array de Diet.
- * @param patients Array de Patients.
- * @param size Tamanho dos arrays.
+ * @param dataset Conjunto de dados carregado.
  */
-void handlePrintTable(MealPlan mealPlans[], Diet diets[], Patients patients[], int size) {
-        printTable(mealPlans, diets, patients, size);
+void handlePrintTable(Dataset *dataset) {
+        if (requireColumns(dataset, MEAL_PLAN, COL_ID | COL_DATE | COL_MEAL | COL_LIMITS) != 0 ||
+                requireColumns(dataset, DIET, COL_ID | COL_DATE | COL_MEAL | COL_CALORIES) != 0 ||
+                requireColumns(dataset, PATIENTS, COL_ID | COL_NAME) != 0) {
+                printf("Memoria insuficiente.\n");
+                return;
+        }
+        Dataset view, *target = beginQuery(dataset, &view);
+        if (target == NULL) {
+                return;
+        }
+        profileBegin();
+        printTable(target->mealPlans, target->numMealPlans, target->diets, target->numDiets, target->patients, target->numPatients);
+        profileEnd("printTable", target->numDiets + target->numMealPlans + target->numPatients);
+        endQuery(dataset, target);
+}
+
+// Le uma linha de texto do utilizador, sem o '\n' final
+static void readText(char *text, int size) {
+        fgets(text, size, stdin);
+        text[strcspn(text, "\n")] = 0;
+}
+
+/**
+ * @brief Regista uma nova refeição consumida ou uma nova entrada do plano alimentar.
+ *
+ * O registo fica imediatamente visível nas consultas e é escrito em disco de seguida, com 'fsync'.
+ *
+ * @param dataset Conjunto de dados carregado, com o caminho de escrita aberto.
+ */
+void handleIngest(Dataset *dataset) {
+        int type, status;
+        Date date;
+        if (dataset->log == NULL) {
+                printf("A escrita nao esta disponivel (so com uma unica diretoria de dados nao comprimidos).\n");
+                return;
+        }
+        printf("Tipo de registo (1-Refeicao consumida, 2-Plano alimentar): \n");
+        scanf("%d", &type);
+        if (type != 1 && type != 2) {
+                printf("Tipo invalido\n");
+                return;
+        }
+
+        Diet diet = {.ID = -1};
+        MealPlan mealPlan = {.ID = -1};
+        printf("Paciente (ID ou nome): \n");
+        int IDPatient = readPatientID(dataset);
+        if (IDPatient == -1) {
+                return;
+        }
+        diet.ID = mealPlan.ID = IDPatient;
+        printf("Data (dd-mm-aaaa): \n");
+        if (scanf("%d-%d-%d", &date.day, &date.month, &date.year) != 3 || date.month < 1 || date.month > 12 || date.day < 1 || date.day > 31) {
+                printf("Data invalida\n");
+                return;
+        }
+        clearInputBuffer();
+
+        if (type == 1) {
+                diet.date = date;
+                printf("Refeicao: \n");
+                readText(diet.meal, sizeof(diet.meal));
+                printf("Alimentos: \n");
+                readText(diet.food, sizeof(diet.food));
+                printf("Calorias: \n");
+                scanf("%d", &diet.calories);
+                status = ingestDiet(dataset, &diet);
+        } else {
+                mealPlan.date = date;
+                printf("Refeicao: \n");
+                readText(mealPlan.meal, sizeof(mealPlan.meal));
+                printf("Calorias minimas e maximas (min max): \n");
+                scanf("%d %d", &mealPlan.minCal, &mealPlan.maxCal);
+                status = ingestMealPlan(dataset, &mealPlan);
+        }
+
+        if (status != 0) {
+                printf("Nao foi possivel registar (os textos nao podem estar vazios nem conter ';').\n");
+                return;
+        }
+        if (commitIngest(dataset) != 0) {
+                printf("Registo inserido, mas ainda nao guardado em disco: a escrita sera repetida no proximo lote.\n");
+                return;
+        }
+        printf("Registo guardado.\n");
+}
+
+// Parte de 'handleCalorieQuantiles' que le as dietas, depois de lidos os parametros
+static void calorieQuantilesQuery(Dataset *dataset, int IDPatient, Period period) {
+if (IDPatient != 0) {
+                int first, slice;
+                patientSlice(dataset, IDPatient, DIET, &first, &slice);
+                calorieQuantiles(dataset->diets + first, slice, period, IDPatient);
+                return;
+        }
+        Diet *diets = memAlloc(MEM_QUERY, sizeof(Diet) * (dataset->numDiets > 0 ? dataset->numDiets : 1));
+        if (diets == NULL) {
+                printf("Memoria insuficiente.\n");
+                return;
+        }
+        profileBegin();
+        int numDiets = dietsInPeriod(dataset, period, diets);
+        calorieQuantiles(diets, numDiets, period, -1);
+        profileEnd("calorieQuantiles", numDiets);
+        memFree(diets);
+}
+
+/**
+ * @brief Processa e exibe a mediana e os percentis 90 e 99 das calorias por tipo de refeição.
+ *
+ * @param dataset Conjunto de dados carregado.
+ */
+void handleCalorieQuantiles(Dataset *dataset) {
+        if (requireColumns(dataset, DIET, COL_ID | COL_DATE | COL_MEAL | COL_CALORIES) != 0) {
+                printf("Memoria insuficiente.\n");
+                return;
+        }
+        int IDPatient;
+        Period period;
+        printf("Paciente (ID ou nome, 0 para todos): \n");
+        IDPatient = readPatientID(dataset);
+        if (IDPatient == -1) {
+                return;
+        }
+        fillPeriod(&period);
+        Dataset view, *target = beginQuery(dataset, &view);
+        if (target != NULL) {
+                calorieQuantilesQuery(target, IDPatient, period);
+                endQuery(dataset, target);
+        }
+}
+
+/**
+ * @brief Exibe as estatísticas de utilização do programa, incluindo a cache de resultados, os segmentos do
+ *        armazenamento de cada ficheiro e a memória por subsistema.
+ *
+ * @param dataset Conjunto de dados carregado.
+ */
+void handleStats(Dataset *dataset) {
+        Dataset view, *target = beginQuery(dataset, &view);
+        if (target == NULL) {
+                return;
+        }
+        printf("Pacientes: %d, Dietas: %d, Planos: %d\n", target->numPatients, target->numDiets, target->numMealPlans);
+        printSites(target);
+        printCacheStats(target->cache);
+        printIngestStats(target->log);
+        printAlertStats(target->alerts);
+        printSampleStats(target->sample);
+        printStoreStats(target->stores[DIET], "dietas");
+        printStoreStats(target->stores[MEAL_PLAN], "planos");
+        printMemoryReport(stdout);
+        endQuery(dataset, target);
 }
 
 /**
@@ -157,6 +652,11 @@ int showMenuAndGetChoice() {
 	printf("3-Plano Nutricional\n");
 	printf("4-Media Calorias Consumidas\n");
 	printf("5-Tabela de Informacoes\n");
+	printf("6-Media Movel de Calorias\n");
+	printf("7-Pacientes com Maior Consumo\n");
+	printf("8-Estatisticas\n");
+	printf("9-Registar Refeicao ou Plano\n");
+	printf("10-Quantis de Calorias por Refeicao\n");
 	printf("0-Sair\n");
 	printf("-----------------------------------\n");
 	
@@ -16,14 +16,16 @@
  */
 
 
-void initializeDiets(Diet diets[], int size);
-void initializePatients(Patients patients[], int size);
-void initializeMealPlans(MealPlan mealPlans[], int size);
-void handleExceededCalories(Diet diets[], int size);
-void handleOutOfRange(Diet diets[], MealPlan mealPlans[], int numDiets);
-void handleMealPlan(MealPlan mealPlans[], int size);
-void handleAverageCalories(Diet diets[], int numDiets);
-void handlePrintTable(MealPlan mealPlans[], Diet diets[], Patients patients[], int size);
+void handleExceededCalories(Dataset *dataset);
+void handleOutOfRange(Dataset *dataset);
+void handleMealPlan(Dataset *dataset);
+void handleAverageCalories(Dataset *dataset);
+void handleRollingCalories(Dataset *dataset);
+void handleTopPatients(Dataset *dataset);
+void handleCalorieQuantiles(Dataset *dataset);
+void handlePrintTable(Dataset *dataset);
+void handleStats(Dataset *dataset);
+void handleIngest(Dataset *dataset);
 void clearScreen();
 void waitForUserInput();
 int showMenuAndGetChoice();
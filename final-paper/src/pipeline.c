@@ -0,0 +1,883 @@
+#include "pipeline.h"
+#include "memtrack.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file pipeline.c
+ * @brief Implementação do motor de consultas por lotes.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'pipeline.h'. Cada operador é uma estrutura
+ * que começa por 'struct Operator', com a função que preenche o lote seguinte e a função que o fecha. A função
+ * 'next' devolve o número de linhas escritas no lote, 0 no fim da entrada ou -1 se não houver memória.
+ *
+ * Os filtros não fazem saltos por linha: cada linha é escrita na lista de linhas mantidas e a posição seguinte só
+ * avança se a linha passar na comparação. No fim, apenas as colunas preenchidas do lote são compactadas.
+ *
+ * Os operadores que guardam linhas (agregação, junção, ordenação e top-K) guardam-nas com todas as colunas, numa
+ * 'StoredRow'. A agregação e a junção usam a mesma tabela de dispersão com endereçamento aberto, indexada pelo ID
+ * e, quando pedido, pelo texto.
+ */
+
+#define FIELD(field) (1u << (field))
+
+struct Operator {
+	int (*next)(Operator *self, Batch *batch);
+	void (*close)(Operator *self);
+};
+
+// Linha guardada fora de um lote
+typedef struct {
+	long values[NUM_FIELDS];
+	const char *text;
+} StoredRow;
+
+// Linhas guardadas pela ordem de insercao, com uma tabela de dispersao opcional sobre o ID (e o texto)
+typedef struct {
+	StoredRow *rows;
+	int numRows, capacity;
+	int *slots;
+	unsigned slotsMask;
+	int byText;
+} RowTable;
+
+typedef struct {
+	Operator base;
+	const void *rows;
+	int count, position;
+	FileType fileType;
+} ScanOperator;
+
+typedef struct {
+	Operator base;
+	Operator *child;
+	long first, last;
+	long ID;
+	char meal[50];
+	int keep[BATCH_SIZE];
+} FilterOperator;
+
+typedef struct {
+	Operator base;
+	Operator *child;
+	BatchField field, low, high;
+	int inside;
+	int keep[BATCH_SIZE];
+} RangeOperator;
+
+typedef struct {
+	Operator base;
+	Operator *child;
+	void (*map)(Batch *batch, void *context);
+	void *context;
+} MapOperator;
+
+typedef struct {
+	Operator base;
+	Operator *child;
+	Aggregate aggregates[NUM_FIELDS];
+	int numAggregates;
+	unsigned fields;
+	RowTable groups;
+	int built, emitted;
+	Batch *input;
+	int groupOf[BATCH_SIZE];
+} AggregateOperator;
+
+typedef struct {
+	Operator base;
+	Operator *probe, *build;
+	JoinField fields[NUM_FIELDS];
+	int numFields;
+	int outer;
+	long missing;
+	RowTable table;
+	int built;
+	int matchOf[BATCH_SIZE];
+	int keep[BATCH_SIZE];
+} JoinOperator;
+
+typedef struct {
+	Operator base;
+	Operator *child;
+	SortKey *keys;
+	int numKeys;
+	unsigned fields;
+	RowTable table;
+	int built, emitted;
+	Batch *input;
+} SortOperator;
+
+// Linha do heap do top-K e a respetiva pontuacao
+typedef struct {
+	double score;
+	StoredRow row;
+} ScoredRow;
+
+typedef struct {
+	Operator base;
+	Operator *child;
+	int k;
+	double (*score)(const Batch *batch, int i, void *context);
+	void *context;
+	unsigned fields;
+	ScoredRow *heap;
+	int size, capacity;
+	int built, emitted;
+	Batch *input;
+} TopOperator;
+
+// Chaves da ordenacao em curso, usadas pela funcao de comparacao do qsort
+static __thread const SortKey *sortKeys;
+static __thread int numSortKeys;
+
+long dateKey(Date date) {
+	return ((long)date.year * 16 + date.month) * 32 + date.day;
+}
+
+Date keyDate(long key) {
+	return (Date){.day = key & 31, .month = (key >> 5) & 15, .year = key >> 9};
+}
+
+// Mantem apenas as linhas de 'keep' (por ordem crescente), copiando apenas as colunas preenchidas
+static void compactBatch(Batch *batch, const int *keep, int count) {
+	if (count == batch->count) {
+		return;
+	}
+	for (int field = 0; field < NUM_FIELDS; field++) {
+		if (batch->fields & FIELD(field)) {
+			long *values = batch->values[field];
+			for (int i = 0; i < count; i++) {
+				values[i] = values[keep[i]];
+			}
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		batch->text[i] = batch->text[keep[i]];
+	}
+	batch->count = count;
+}
+
+// Copia as linhas guardadas a partir de '*emitted' para o lote, com as colunas de 'fields'
+static int emitRows(const StoredRow *rows, int count, int *emitted, unsigned fields, Batch *batch) {
+	int n = 0;
+	for (; n < BATCH_SIZE && *emitted < count; n++, (*emitted)++) {
+		const StoredRow *row = &rows[*emitted];
+		for (int field = 0; field < NUM_FIELDS; field++) {
+			batch->values[field][n] = row->values[field];
+		}
+		batch->text[n] = row->text;
+	}
+	batch->fields = fields;
+	batch->count = n;
+	return n;
+}
+
+// Copia a linha 'i' de um lote para uma linha guardada
+static void storeRow(StoredRow *row, const Batch *batch, int i) {
+	for (int field = 0; field < NUM_FIELDS; field++) {
+		row->values[field] = batch->fields & FIELD(field) ? batch->values[field][i] : 0;
+	}
+	row->text = batch->text[i];
+}
+
+static unsigned hashKey(long ID, const char *text, int byText) {
+	unsigned hash = (unsigned)ID * 2654435761u;
+	if (byText) {
+		for (; *text != '\0'; text++) {
+			hash = (hash ^ (unsigned char)*text) * 16777619u;
+		}
+	}
+	return hash;
+}
+
+static void freeRowTable(RowTable *table) {
+	memFree(table->rows);
+	memFree(table->slots);
+}
+
+// Acrescenta uma linha vazia no fim da tabela; devolve a sua posicao ou -1 se nao houver memoria
+static int appendRow(RowTable *table) {
+	if (table->numRows == table->capacity) {
+		int capacity = table->capacity > 0 ? table->capacity * 2 : 64;
+		StoredRow *grown = memRealloc(MEM_QUERY, table->rows, sizeof(StoredRow) * capacity);
+		if (grown == NULL) {
+			return -1;
+		}
+		table->rows = grown;
+		table->capacity = capacity;
+	}
+	return table->numRows++;
+}
+
+// Procura a linha com a chave indicada; devolve a sua posicao ou -1 se nao existir
+static int findRow(const RowTable *table, long ID, const char *text) {
+	if (table->slots == NULL) {
+		return -1;
+	}
+	for (unsigned slot = hashKey(ID, text, table->byText) & table->slotsMask;; slot = (slot + 1) & table->slotsMask) {
+		int position = table->slots[slot];
+		if (position == -1) {
+			return -1;
+		}
+		const StoredRow *row = &table->rows[position];
+		if (row->values[FIELD_ID] == ID && (!table->byText || strcmp(row->text, text) == 0)) {
+			return position;
+		}
+	}
+}
+
+// Acrescenta uma linha com a chave indicada (que nao pode existir) e regista-a na tabela de dispersao
+static int insertRow(RowTable *table, long ID, const char *text) {
+	if ((unsigned)(table->numRows + 1) * 2 > (table->slots == NULL ? 0 : table->slotsMask + 1)) {
+		unsigned size = table->slots == NULL ? 128 : (table->slotsMask + 1) * 2;
+		int *slots = memAlloc(MEM_QUERY, sizeof(int) * size);
+		if (slots == NULL) {
+			return -1;
+		}
+		memset(slots, -1, sizeof(int) * size);
+		for (int i = 0; i < table->numRows; i++) {
+			unsigned slot = hashKey(table->rows[i].values[FIELD_ID], table->rows[i].text, table->byText) & (size - 1);
+			while (slots[slot] != -1) {
+				slot = (slot + 1) & (size - 1);
+			}
+			slots[slot] = i;
+		}
+		memFree(table->slots);
+		table->slots = slots;
+		table->slotsMask = size - 1;
+	}
+
+	int position = appendRow(table);
+	if (position == -1) {
+		return -1;
+	}
+	table->rows[position].values[FIELD_ID] = ID;
+	table->rows[position].text = text;
+	unsigned slot = hashKey(ID, text, table->byText) & table->slotsMask;
+	while (table->slots[slot] != -1) {
+		slot = (slot + 1) & table->slotsMask;
+	}
+	table->slots[slot] = position;
+	return position;
+}
+
+// Aloca um operador e preenche as funcoes comuns; em caso de falha fecha os operadores recebidos
+static void *newOperator(size_t size, int (*next)(Operator *, Batch *), void (*close)(Operator *),
+		Operator *first, Operator *second) {
+	Operator *op = memCalloc(MEM_QUERY, 1, size);
+	if (op == NULL) {
+		closeOperator(first);
+		closeOperator(second);
+		return NULL;
+	}
+	op->next = next;
+	op->close = close;
+	return op;
+}
+
+static void closeLeaf(Operator *self) {
+	memFree(self);
+}
+
+static int nextScan(Operator *self, Batch *batch) {
+	ScanOperator *scan = (ScanOperator *)self;
+	int n = 0;
+
+	if (scan->fileType == DIET) {
+		const Diet *diets = scan->rows;
+		batch->fields = FIELD(FIELD_ID) | FIELD(FIELD_DATE) | FIELD(FIELD_ROW) | FIELD(FIELD_CALORIES);
+		for (; n < BATCH_SIZE && scan->position < scan->count; scan->position++) {
+			const Diet *diet = &diets[scan->position];
+			if (diet->ID == -1) {
+				continue;
+			}
+			batch->values[FIELD_ID][n] = diet->ID;
+			batch->values[FIELD_DATE][n] = dateKey(diet->date);
+			batch->values[FIELD_ROW][n] = scan->position;
+			batch->values[FIELD_CALORIES][n] = diet->calories;
+			batch->text[n] = diet->meal;
+			n++;
+		}
+	} else if (scan->fileType == MEAL_PLAN) {
+		const MealPlan *plans = scan->rows;
+		batch->fields = FIELD(FIELD_ID) | FIELD(FIELD_DATE) | FIELD(FIELD_ROW) | FIELD(FIELD_MIN_CAL) |
+				FIELD(FIELD_MAX_CAL);
+		for (; n < BATCH_SIZE && scan->position < scan->count; scan->position++) {
+			const MealPlan *plan = &plans[scan->position];
+			if (plan->ID == -1) {
+				continue;
+			}
+			batch->values[FIELD_ID][n] = plan->ID;
+			batch->values[FIELD_DATE][n] = dateKey(plan->date);
+			batch->values[FIELD_ROW][n] = scan->position;
+			batch->values[FIELD_MIN_CAL][n] = plan->minCal;
+			batch->values[FIELD_MAX_CAL][n] = plan->maxCal;
+			batch->text[n] = plan->meal;
+			n++;
+		}
+	} else {
+		const Patients *patients = scan->rows;
+		batch->fields = FIELD(FIELD_ID) | FIELD(FIELD_ROW);
+		for (; n < BATCH_SIZE && scan->position < scan->count; scan->position++) {
+			const Patients *patient = &patients[scan->position];
+			if (patient->ID == -1) {
+				continue;
+			}
+			batch->values[FIELD_ID][n] = patient->ID;
+			batch->values[FIELD_ROW][n] = scan->position;
+			batch->text[n] = patient->name;
+			n++;
+		}
+	}
+	batch->count = n;
+	return n;
+}
+
+Operator *scanOperator(const void *rows, int count, FileType fileType) {
+	ScanOperator *scan = newOperator(sizeof(ScanOperator), nextScan, closeLeaf, NULL, NULL);
+	if (scan == NULL) {
+		return NULL;
+	}
+	scan->rows = rows;
+	scan->count = rows != NULL ? count : 0;
+	scan->fileType = fileType;
+	return &scan->base;
+}
+
+static void closeUnary(Operator *self) {
+	// Todos os operadores com uma entrada guardam-na logo a seguir a 'base'
+	closeOperator(((MapOperator *)self)->child);
+	memFree(self);
+}
+
+static int nextFilter(Operator *self, Batch *batch) {
+	FilterOperator *filter = (FilterOperator *)self;
+	int count;
+
+	while ((count = filter->child->next(filter->child, batch)) > 0) {
+		const long *dates = batch->values[FIELD_DATE], *IDs = batch->values[FIELD_ID];
+		int kept = 0;
+		for (int i = 0; i < count; i++) {
+			filter->keep[kept] = i;
+			kept += (dates[i] >= filter->first) & (dates[i] <= filter->last) &
+					((filter->ID == -1) | (IDs[i] == filter->ID));
+		}
+		if (filter->meal[0] != '\0') {
+			int matched = 0;
+			for (int i = 0; i < kept; i++) {
+				filter->keep[matched] = filter->keep[i];
+				matched += strcmp(batch->text[filter->keep[i]], filter->meal) == 0;
+			}
+			kept = matched;
+		}
+		compactBatch(batch, filter->keep, kept);
+		if (kept > 0) {
+			return kept;
+		}
+	}
+	return count;
+}
+
+Operator *filterOperator(Operator *child, const QueryKey *key) {
+	if (child == NULL) {
+		return NULL;
+	}
+	FilterOperator *filter = newOperator(sizeof(FilterOperator), nextFilter, closeUnary, child, NULL);
+	if (filter == NULL) {
+		return NULL;
+	}
+	filter->child = child;
+	filter->first = dateKey(key->period.begin);
+	filter->last = dateKey(key->period.end);
+	filter->ID = key->ID;
+	strcpy(filter->meal, key->meal);
+	return &filter->base;
+}
+
+static int nextRange(Operator *self, Batch *batch) {
+	RangeOperator *range = (RangeOperator *)self;
+	int count;
+
+	while ((count = range->child->next(range->child, batch)) > 0) {
+		const long *values = batch->values[range->field];
+		const long *low = batch->values[range->low], *high = batch->values[range->high];
+		int kept = 0;
+		for (int i = 0; i < count; i++) {
+			range->keep[kept] = i;
+			kept += ((values[i] >= low[i]) & (values[i] <= high[i])) == range->inside;
+		}
+		compactBatch(batch, range->keep, kept);
+		if (kept > 0) {
+			return kept;
+		}
+	}
+	return count;
+}
+
+Operator *rangeOperator(Operator *child, BatchField field, BatchField low, BatchField high, int inside) {
+	if (child == NULL) {
+		return NULL;
+	}
+	RangeOperator *range = newOperator(sizeof(RangeOperator), nextRange, closeUnary, child, NULL);
+	if (range == NULL) {
+		return NULL;
+	}
+	range->child = child;
+	range->field = field;
+	range->low = low;
+	range->high = high;
+	range->inside = inside != 0;
+	return &range->base;
+}
+
+static int nextMap(Operator *self, Batch *batch) {
+	MapOperator *map = (MapOperator *)self;
+	int count;
+
+	while ((count = map->child->next(map->child, batch)) > 0) {
+		map->map(batch, map->context);
+		if (batch->count > 0) {
+			return batch->count;
+		}
+	}
+	return count;
+}
+
+Operator *mapOperator(Operator *child, void (*map)(Batch *batch, void *context), void *context) {
+	if (child == NULL) {
+		return NULL;
+	}
+	MapOperator *op = newOperator(sizeof(MapOperator), nextMap, closeUnary, child, NULL);
+	if (op == NULL) {
+		return NULL;
+	}
+	op->child = child;
+	op->map = map;
+	op->context = context;
+	return &op->base;
+}
+
+// Le toda a entrada e calcula as agregacoes de cada grupo
+static int buildGroups(AggregateOperator *aggregate) {
+	RowTable *groups = &aggregate->groups;
+	Batch *input = aggregate->input;
+	int count;
+
+	while ((count = aggregate->child->next(aggregate->child, input)) > 0) {
+		// Primeiro o grupo de cada linha, depois cada agregacao num ciclo sobre a coluna
+		const long *IDs = input->values[FIELD_ID];
+		for (int i = 0; i < count; i++) {
+			int group = findRow(groups, IDs[i], input->text[i]);
+			if (group == -1) {
+				group = insertRow(groups, IDs[i], input->text[i]);
+				if (group == -1) {
+					return -1;
+				}
+				for (int j = 0; j < aggregate->numAggregates; j++) {
+					const Aggregate *a = &aggregate->aggregates[j];
+					groups->rows[group].values[a->output] = a->function == AGGREGATE_MIN ? LONG_MAX :
+							a->function == AGGREGATE_MAX ? LONG_MIN : 0;
+				}
+			}
+			aggregate->groupOf[i] = group;
+		}
+
+		StoredRow *rows = groups->rows;
+		const int *groupOf = aggregate->groupOf;
+		for (int j = 0; j < aggregate->numAggregates; j++) {
+			const Aggregate *a = &aggregate->aggregates[j];
+			const long *values = input->values[a->input];
+			int output = a->output;
+			switch (a->function) {
+				case AGGREGATE_SUM:
+					for (int i = 0; i < count; i++) {
+						rows[groupOf[i]].values[output] += values[i];
+					}
+					break;
+				case AGGREGATE_COUNT:
+					for (int i = 0; i < count; i++) {
+						rows[groupOf[i]].values[output]++;
+					}
+					break;
+				case AGGREGATE_MIN:
+					for (int i = 0; i < count; i++) {
+						long *value = &rows[groupOf[i]].values[output];
+						*value = values[i] < *value ? values[i] : *value;
+					}
+					break;
+				case AGGREGATE_MAX:
+					for (int i = 0; i < count; i++) {
+						long *value = &rows[groupOf[i]].values[output];
+						*value = values[i] > *value ? values[i] : *value;
+					}
+					break;
+			}
+		}
+	}
+	return count;
+}
+
+static int nextAggregate(Operator *self, Batch *batch) {
+	AggregateOperator *aggregate = (AggregateOperator *)self;
+
+	if (!aggregate->built) {
+		if (buildGroups(aggregate) == -1) {
+			return -1;
+		}
+		aggregate->built = 1;
+	}
+	return emitRows(aggregate->groups.rows, aggregate->groups.numRows, &aggregate->emitted, aggregate->fields, batch);
+}
+
+static void closeAggregate(Operator *self) {
+	AggregateOperator *aggregate = (AggregateOperator *)self;
+	closeOperator(aggregate->child);
+	freeRowTable(&aggregate->groups);
+	memFree(aggregate->input);
+	memFree(aggregate);
+}
+
+Operator *aggregateOperator(Operator *child, int byText, const Aggregate *aggregates, int count) {
+	if (child == NULL) {
+		return NULL;
+	}
+	AggregateOperator *aggregate = newOperator(sizeof(AggregateOperator), nextAggregate, closeAggregate, child, NULL);
+	if (aggregate == NULL) {
+		return NULL;
+	}
+	aggregate->child = child;
+	aggregate->groups.byText = byText;
+	aggregate->input = memAlloc(MEM_QUERY, sizeof(Batch));
+	if (aggregate->input == NULL) {
+		closeAggregate(&aggregate->base);
+		return NULL;
+	}
+	aggregate->fields = FIELD(FIELD_ID);
+	for (int i = 0; i < count && i < NUM_FIELDS; i++) {
+		aggregate->aggregates[i] = aggregates[i];
+		aggregate->fields |= FIELD(aggregates[i].output);
+	}
+	aggregate->numAggregates = count < NUM_FIELDS ? count : NUM_FIELDS;
+	return &aggregate->base;
+}
+
+// Le todo o lado construido para a tabela de dispersao, guardando apenas a primeira linha de cada chave
+static int buildJoin(JoinOperator *join, Batch *batch) {
+	RowTable *table = &join->table;
+	int count;
+
+	while ((count = join->build->next(join->build, batch)) > 0) {
+		for (int i = 0; i < count; i++) {
+			long ID = batch->values[FIELD_ID][i];
+			if (findRow(table, ID, batch->text[i]) != -1) {
+				continue;
+			}
+			int position = insertRow(table, ID, batch->text[i]);
+			if (position == -1) {
+				return -1;
+			}
+			storeRow(&table->rows[position], batch, i);
+		}
+	}
+	return count;
+}
+
+static int nextJoin(Operator *self, Batch *batch) {
+	JoinOperator *join = (JoinOperator *)self;
+	int count;
+
+	if (!join->built) {
+		// O lote de saida ainda nao esta em uso e serve para ler o lado construido
+		if (buildJoin(join, batch) == -1) {
+			return -1;
+		}
+		join->built = 1;
+	}
+
+	while ((count = join->probe->next(join->probe, batch)) > 0) {
+		const long *IDs = batch->values[FIELD_ID];
+		int kept = 0;
+		for (int i = 0; i < count; i++) {
+			int match = findRow(&join->table, IDs[i], batch->text[i]);
+			join->keep[kept] = i;
+			join->matchOf[kept] = match;
+			kept += join->outer | (match != -1);
+		}
+		compactBatch(batch, join->keep, kept);
+
+		const StoredRow *rows = join->table.rows;
+		for (int j = 0; j < join->numFields; j++) {
+			long *to = batch->values[join->fields[j].to];
+			int from = join->fields[j].from;
+			for (int i = 0; i < kept; i++) {
+				to[i] = join->matchOf[i] != -1 ? rows[join->matchOf[i]].values[from] : join->missing;
+			}
+			batch->fields |= FIELD(join->fields[j].to);
+		}
+		if (kept > 0) {
+			return kept;
+		}
+	}
+	return count;
+}
+
+static void closeJoin(Operator *self) {
+	JoinOperator *join = (JoinOperator *)self;
+	closeOperator(join->probe);
+	closeOperator(join->build);
+	freeRowTable(&join->table);
+	memFree(join);
+}
+
+Operator *joinOperator(Operator *probe, Operator *build, int byText, const JoinField *fields, int count, int outer, long missing) {
+	if (probe == NULL || build == NULL) {
+		closeOperator(probe);
+		closeOperator(build);
+		return NULL;
+	}
+	JoinOperator *join = newOperator(sizeof(JoinOperator), nextJoin, closeJoin, probe, build);
+	if (join == NULL) {
+		return NULL;
+	}
+	join->probe = probe;
+	join->build = build;
+	join->table.byText = byText;
+	for (int i = 0; i < count && i < NUM_FIELDS; i++) {
+		join->fields[i] = fields[i];
+	}
+	join->numFields = count < NUM_FIELDS ? count : NUM_FIELDS;
+	join->outer = outer != 0;
+	join->missing = missing;
+	return &join->base;
+}
+
+static int compareStoredRows(const void *a, const void *b) {
+	const StoredRow *rowA = a, *rowB = b;
+
+	for (int i = 0; i < numSortKeys; i++) {
+		const SortKey *key = &sortKeys[i];
+		int result;
+		if (key->text) {
+			result = strcmp(rowA->text, rowB->text);
+		} else {
+			long valueA = rowA->values[key->field], valueB = rowB->values[key->field];
+			result = (valueA > valueB) - (valueA < valueB);
+		}
+		if (result != 0) {
+			return key->descending ? -result : result;
+		}
+	}
+	return 0;
+}
+
+static int nextSort(Operator *self, Batch *batch) {
+	SortOperator *sort = (SortOperator *)self;
+	RowTable *table = &sort->table;
+
+	if (!sort->built) {
+		int count;
+		while ((count = sort->child->next(sort->child, sort->input)) > 0) {
+			for (int i = 0; i < count; i++) {
+				int position = appendRow(table);
+				if (position == -1) {
+					return -1;
+				}
+				storeRow(&table->rows[position], sort->input, i);
+			}
+			sort->fields |= sort->input->fields;
+		}
+		if (count == -1) {
+			return -1;
+		}
+		sortKeys = sort->keys;
+		numSortKeys = sort->numKeys;
+		qsort(table->rows, table->numRows, sizeof(StoredRow), compareStoredRows);
+		sort->built = 1;
+	}
+	return emitRows(table->rows, table->numRows, &sort->emitted, sort->fields, batch);
+}
+
+static void closeSort(Operator *self) {
+	SortOperator *sort = (SortOperator *)self;
+	closeOperator(sort->child);
+	freeRowTable(&sort->table);
+	memFree(sort->keys);
+	memFree(sort->input);
+	memFree(sort);
+}
+
+Operator *sortOperator(Operator *child, const SortKey *keys, int count) {
+	if (child == NULL) {
+		return NULL;
+	}
+	SortOperator *sort = newOperator(sizeof(SortOperator), nextSort, closeSort, child, NULL);
+	if (sort == NULL) {
+		return NULL;
+	}
+	sort->child = child;
+	sort->input = memAlloc(MEM_QUERY, sizeof(Batch));
+	sort->keys = memAlloc(MEM_QUERY, sizeof(SortKey) * (count > 0 ? count : 1));
+	if (sort->input == NULL || sort->keys == NULL) {
+		closeSort(&sort->base);
+		return NULL;
+	}
+	memcpy(sort->keys, keys, sizeof(SortKey) * count);
+	sort->numKeys = count;
+	return &sort->base;
+}
+
+// Indica se 'a' deve ficar abaixo de 'b' no resultado: menor pontuacao ou, no empate, maior ID
+static int rankedBelow(const ScoredRow *a, const ScoredRow *b) {
+	if (a->score != b->score) {
+		return a->score < b->score;
+	}
+	return a->row.values[FIELD_ID] > b->row.values[FIELD_ID];
+}
+
+static int compareScoredDescending(const void *a, const void *b) {
+	return rankedBelow(a, b) - rankedBelow(b, a);
+}
+
+// Insere uma linha no heap minimo limitado a 'k' elementos, cuja raiz e a pior linha guardada
+static int pushScored(TopOperator *top, const ScoredRow *row) {
+	ScoredRow *heap = top->heap;
+	int i;
+
+	if (top->size < top->k) {
+		if (top->size == top->capacity) {
+			int capacity = top->capacity > 0 ? top->capacity * 2 : 16;
+			capacity = capacity < top->k ? capacity : top->k;
+			heap = memRealloc(MEM_QUERY, top->heap, sizeof(ScoredRow) * capacity);
+			if (heap == NULL) {
+				return -1;
+			}
+			top->heap = heap;
+			top->capacity = capacity;
+		}
+		i = top->size++;
+		while (i > 0 && rankedBelow(row, &heap[(i - 1) / 2])) {
+			heap[i] = heap[(i - 1) / 2];
+			i = (i - 1) / 2;
+		}
+		heap[i] = *row;
+		return 0;
+	}
+	if (top->size == 0 || !rankedBelow(&heap[0], row)) {
+		return 0;
+	}
+	i = 0;
+	for (;;) {
+		int child = 2 * i + 1;
+		if (child >= top->size) {
+			break;
+		}
+		if (child + 1 < top->size && rankedBelow(&heap[child + 1], &heap[child])) {
+			child++;
+		}
+		if (!rankedBelow(&heap[child], row)) {
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = *row;
+	return 0;
+}
+
+static int nextTop(Operator *self, Batch *batch) {
+	TopOperator *top = (TopOperator *)self;
+
+	if (!top->built) {
+		int count;
+		while ((count = top->child->next(top->child, top->input)) > 0) {
+			for (int i = 0; i < count; i++) {
+				ScoredRow row;
+				row.score = top->score(top->input, i, top->context);
+				storeRow(&row.row, top->input, i);
+				if (pushScored(top, &row) == -1) {
+					return -1;
+				}
+			}
+			top->fields |= top->input->fields;
+		}
+		if (count == -1) {
+			return -1;
+		}
+		qsort(top->heap, top->size, sizeof(ScoredRow), compareScoredDescending);
+		top->built = 1;
+	}
+
+	int n = 0;
+	for (; n < BATCH_SIZE && top->emitted < top->size; n++, top->emitted++) {
+		const StoredRow *row = &top->heap[top->emitted].row;
+		for (int field = 0; field < NUM_FIELDS; field++) {
+			batch->values[field][n] = row->values[field];
+		}
+		batch->text[n] = row->text;
+	}
+	batch->fields = top->fields;
+	batch->count = n;
+	return n;
+}
+
+static void closeTop(Operator *self) {
+	TopOperator *top = (TopOperator *)self;
+	closeOperator(top->child);
+	memFree(top->heap);
+	memFree(top->input);
+	memFree(top);
+}
+
+Operator *topOperator(Operator *child, int k, double (*score)(const Batch *batch, int i, void *context), void *context) {
+	if (child == NULL) {
+		return NULL;
+	}
+	TopOperator *top = newOperator(sizeof(TopOperator), nextTop, closeTop, child, NULL);
+	if (top == NULL) {
+		return NULL;
+	}
+	top->child = child;
+	top->k = k > 0 ? k : 0;
+	top->score = score;
+	top->context = context;
+	top->input = memAlloc(MEM_QUERY, sizeof(Batch));
+	if (top->input == NULL) {
+		closeTop(&top->base);
+		return NULL;
+	}
+	return &top->base;
+}
+
+int runPipeline(Operator *root, void (*output)(const Batch *batch, int i, void *context), void *context) {
+	if (root == NULL) {
+		return -1;
+	}
+	Batch *batch = memAlloc(MEM_QUERY, sizeof(Batch));
+	if (batch == NULL) {
+		closeOperator(root);
+		return -1;
+	}
+
+	int rows = 0, count;
+	while ((count = root->next(root, batch)) > 0) {
+		if (output != NULL) {
+			for (int i = 0; i < count; i++) {
+				output(batch, i, context);
+			}
+		}
+		rows += count;
+	}
+
+	memFree(batch);
+	closeOperator(root);
+	return count == -1 ? -1 : rows;
+}
+
+void closeOperator(Operator *op) {
+	if (op != NULL) {
+		op->close(op);
+	}
+}
@@ -0,0 +1,172 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "types.h"
+
+/**
+ * @file pipeline.h
+ * @brief Cabeçalho do motor de consultas por lotes.
+ *
+ * Este ficheiro de cabeçalho declara os operadores com que as consultas de 'logic.c' são construídas. Cada
+ * operador produz lotes de até BATCH_SIZE linhas ('Batch'), guardadas coluna a coluna, e lê os lotes do operador
+ * (ou operadores) que recebe na construção. Uma consulta é uma árvore de operadores cuja raiz é passada a
+ * 'runPipeline', que pede os lotes um a um e entrega cada linha do resultado à função de saída.
+ *
+ * Os operadores que precisam de todas as linhas antes de produzir a primeira (agregação, junção do lado construído,
+ * ordenação e top-K) consomem a entrada na primeira chamada; os restantes trabalham um lote de cada vez.
+ *
+ * Cada construtor fica dono dos operadores que recebe. Se algum deles for NULL, ou se não houver memória, o
+ * construtor fecha os restantes e devolve NULL, pelo que uma árvore pode ser construída numa única expressão e
+ * verificada apenas em 'runPipeline'.
+ */
+
+/**
+ * @brief Converte uma data numa chave inteira com a mesma ordem que 'dateInPeriod' usa (ano, mês, dia).
+ *
+ * @param date Data a converter.
+ *
+ * @return Retorna a chave da data.
+ */
+long dateKey(Date date);
+
+/**
+ * @brief Converte uma chave criada por 'dateKey' de volta numa data.
+ *
+ * @param key Chave da data.
+ *
+ * @return Retorna a data.
+ */
+Date keyDate(long key);
+
+/**
+ * @brief Cria um operador que lê um array de registos.
+ *
+ * As colunas produzidas são FIELD_ID, FIELD_DATE, FIELD_ROW e o texto, mais FIELD_CALORIES nas dietas e
+ * FIELD_MIN_CAL e FIELD_MAX_CAL nos planos. Nos pacientes são produzidas apenas FIELD_ID, FIELD_ROW e o nome como
+ * texto. Os registos vazios (ID -1) não são produzidos.
+ *
+ * @param rows Array de 'Patients', 'Diet' ou 'MealPlan' (conforme 'fileType'), que tem de existir até ao fim da consulta.
+ * @param count Número de elementos do array.
+ * @param fileType Tipo dos registos.
+ *
+ * @return Retorna o operador, ou NULL se não houver memória.
+ */
+Operator *scanOperator(const void *rows, int count, FileType fileType);
+
+/**
+ * @brief Cria um operador que mantém apenas as linhas com data no período, do paciente e da refeição indicados.
+ *
+ * @param child Operador de entrada.
+ * @param key Filtros: 'period' aplica-se sempre; um 'ID' igual a -1 ou uma refeição vazia não filtram.
+ *
+ * @return Retorna o operador, ou NULL se não houver memória.
+ */
+Operator *filterOperator(Operator *child, const QueryKey *key);
+
+/**
+ * @brief Cria um operador que compara uma coluna com o intervalo definido por outras duas colunas da mesma linha.
+ *
+ * @param child Operador de entrada.
+ * @param field Coluna comparada.
+ * @param low Coluna com o limite inferior do intervalo.
+ * @param high Coluna com o limite superior do intervalo.
+ * @param inside 1 para manter as linhas dentro do intervalo (limites incluídos), 0 para manter as de fora.
+ *
+ * @return Retorna o operador, ou NULL se não houver memória.
+ */
+Operator *rangeOperator(Operator *child, BatchField field, BatchField low, BatchField high, int inside);
+
+/**
+ * @brief Cria um operador que aplica uma função a cada lote.
+ *
+ * A função pode preencher colunas (acrescentando-as a 'fields') e pode remover linhas, compactando o lote e
+ * atualizando 'count'. Os lotes que ficam vazios não são passados ao operador seguinte.
+ *
+ * @param child Operador de entrada.
+ * @param map Função aplicada a cada lote.
+ * @param context Valor passado a 'map'.
+ *
+ * @return Retorna o operador, ou NULL se não houver memória.
+ */
+Operator *mapOperator(Operator *child, void (*map)(Batch *batch, void *context), void *context);
+
+/**
+ * @brief Cria um operador que agrupa as linhas por paciente (e por texto) com uma tabela de dispersão.
+ *
+ * Cada grupo produz uma linha com FIELD_ID, o texto (se 'byText' for 1) e as colunas de saída das agregações.
+ * Os grupos são produzidos pela ordem em que aparecem na entrada.
+ *
+ * @param child Operador de entrada.
+ * @param byText 1 para agrupar também pelo texto (refeição), 0 para agrupar apenas pelo ID.
+ * @param aggregates Agregações calculadas para cada grupo (pode ser NULL se 'count' for 0).
+ * @param count Número de agregações (no máximo NUM_FIELDS).
+ *
+ * @return Retorna o operador, ou NULL se não houver memória.
+ */
+Operator *aggregateOperator(Operator *child, int byText, const Aggregate *aggregates, int count);
+
+/**
+ * @brief Cria um operador de junção por dispersão entre dois operadores, pelo ID (e pelo texto).
+ *
+ * O lado 'build' é lido por completo para uma tabela de dispersão; se uma chave se repetir, vale a primeira linha.
+ * Cada linha de 'probe' recebe as colunas indicadas da linha com a mesma chave.
+ *
+ * @param probe Operador cujas linhas são produzidas.
+ * @param build Operador lido para a tabela de dispersão.
+ * @param byText 1 para juntar também pelo texto, 0 para juntar apenas pelo ID.
+ * @param fields Colunas copiadas de 'build' para as linhas de 'probe'.
+ * @param count Número de colunas copiadas (no máximo NUM_FIELDS).
+ * @param outer 0 para descartar as linhas de 'probe' sem correspondência, 1 para as manter.
+ * @param missing Valor escrito nas colunas copiadas das linhas sem correspondência (apenas com 'outer').
+ *
+ * @return Retorna o operador, ou NULL se não houver memória.
+ */
+Operator *joinOperator(Operator *probe, Operator *build, int byText, const JoinField *fields, int count, int outer, long missing);
+
+/**
+ * @brief Cria um operador que ordena todas as linhas da entrada.
+ *
+ * @param child Operador de entrada.
+ * @param keys Chaves de ordenação, da mais importante para a menos importante.
+ * @param count Número de chaves.
+ *
+ * @return Retorna o operador, ou NULL se não houver memória.
+ */
+Operator *sortOperator(Operator *child, const SortKey *keys, int count);
+
+/**
+ * @brief Cria um operador que mantém apenas as 'k' linhas com maior pontuação, por ordem decrescente.
+ *
+ * As linhas são guardadas num heap mínimo limitado a 'k' elementos, pelo que a memória usada é O(k). Em caso de
+ * empate na pontuação fica primeiro o menor ID.
+ *
+ * @param child Operador de entrada.
+ * @param k Número de linhas a manter.
+ * @param score Função que calcula a pontuação da linha 'i' de um lote.
+ * @param context Valor passado a 'score'.
+ *
+ * @return Retorna o operador, ou NULL se não houver memória.
+ */
+Operator *topOperator(Operator *child, int k, double (*score)(const Batch *batch, int i, void *context), void *context);
+
+/**
+ * @brief Executa uma consulta: pede os lotes à raiz e entrega cada linha à função de saída.
+ *
+ * No fim, a árvore de operadores é fechada.
+ *
+ * @param root Raiz da consulta (pode ser NULL, se a construção falhou).
+ * @param output Função chamada para cada linha do resultado (pode ser NULL para apenas contar as linhas).
+ * @param context Valor passado a 'output'.
+ *
+ * @return Retorna o número de linhas do resultado, ou -1 se a raiz for NULL ou não houver memória.
+ */
+int runPipeline(Operator *root, void (*output)(const Batch *batch, int i, void *context), void *context);
+
+/**
+ * @brief Fecha um operador e todos os operadores que recebeu, libertando a memória.
+ *
+ * @param op Operador a fechar (pode ser NULL).
+ */
+void closeOperator(Operator *op);
+
+#endif // PIPELINE_H
@@ -0,0 +1,175 @@
+#include "planindex.h"
+#include "utils.h"
+#include "memtrack.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file planindex.c
+ * @brief Implementação do índice de intervalos dos planos alimentares.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'planindex.h'. A tabela usa endereçamento
+ * aberto com sondagem linear e é duplicada quando fica meio cheia. Cada entrada guarda a dispersão do par
+ * (paciente, refeição), para que as comparações de cadeias de caracteres só sejam feitas quando as dispersões
+ * coincidem.
+ */
+
+// Entrada da tabela: todas as versoes do plano de um paciente para uma refeicao, ordenadas por dia
+typedef struct {
+	int ID;
+	unsigned hash;
+	char meal[50];
+	PlanVersion *versions;
+	int count;
+	int capacity;
+} PlanEntry;
+
+struct PlanIndex {
+	PlanEntry *entries;
+	int mask;
+	int used;
+};
+
+static unsigned hashKey(int ID, const char *meal) {
+	unsigned hash = 2166136261u ^ (unsigned)ID;
+
+	for (const char *c = meal; *c != '\0'; c++) {
+		hash = (hash ^ (unsigned char)*c) * 16777619u;
+	}
+	return hash * 16777619u;
+}
+
+// Devolve a posicao da entrada do par (ID, refeicao), ou a posicao vazia onde deve ser inserida
+static int findSlot(const PlanEntry *entries, int mask, int ID, const char *meal, unsigned hash) {
+	int slot = hash & mask;
+
+	while (entries[slot].versions != NULL) {
+		if (entries[slot].hash == hash && entries[slot].ID == ID && !strcmp(entries[slot].meal, meal)) {
+			break;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+static int growTable(PlanIndex *index) {
+	int size = index->entries != NULL ? (index->mask + 1) * 2 : 1024;
+	PlanEntry *entries = memCalloc(MEM_INDEX, size, sizeof(PlanEntry));
+
+	if (entries == NULL) {
+		return -1;
+	}
+	if (index->entries != NULL) {
+		for (int i = 0; i <= index->mask; i++) {
+			PlanEntry *entry = &index->entries[i];
+			if (entry->versions != NULL) {
+				entries[findSlot(entries, size - 1, entry->ID, entry->meal, entry->hash)] = *entry;
+			}
+		}
+		memFree(index->entries);
+	}
+	index->entries = entries;
+	index->mask = size - 1;
+	return 0;
+}
+
+PlanIndex *createPlanIndex(void) {
+	PlanIndex *index = memCalloc(MEM_INDEX, 1, sizeof(PlanIndex));
+
+	if (index == NULL || growTable(index) != 0) {
+		memFree(index);
+		return NULL;
+	}
+	return index;
+}
+
+PlanIndex *buildPlanIndex(const MealPlan *mealPlans, int numMealPlans) {
+	PlanIndex *index = createPlanIndex();
+
+	for (int i = 0; index != NULL && i < numMealPlans; i++) {
+		if (mealPlans[i].ID != -1 && addPlanVersion(index, &mealPlans[i]) != 0) {
+			freePlanIndex(index);
+			index = NULL;
+		}
+	}
+	return index;
+}
+
+int addPlanVersion(PlanIndex *index, const MealPlan *mealPlan) {
+	unsigned hash = hashKey(mealPlan->ID, mealPlan->meal);
+	int day = dateToDays(mealPlan->date);
+
+	if ((index->used + 1) * 2 > index->mask + 1 && growTable(index) != 0) {
+		return -1;
+	}
+	PlanEntry *entry = &index->entries[findSlot(index->entries, index->mask, mealPlan->ID, mealPlan->meal, hash)];
+	if (entry->versions == NULL) {
+		entry->versions = memAlloc(MEM_INDEX, sizeof(PlanVersion) * 2);
+		if (entry->versions == NULL) {
+			return -1;
+		}
+		entry->ID = mealPlan->ID;
+		entry->hash = hash;
+		strcpy(entry->meal, mealPlan->meal);
+		entry->capacity = 2;
+		index->used++;
+	}
+
+	// Os planos chegam quase sempre por ordem de data, por isso a posicao e procurada a partir do fim
+	int position = entry->count;
+	while (position > 0 && entry->versions[position - 1].day > day) {
+		position--;
+	}
+	PlanVersion version = {.day = day, .minCal = mealPlan->minCal, .maxCal = mealPlan->maxCal};
+	if (position > 0 && entry->versions[position - 1].day == day) {
+		entry->versions[position - 1] = version;
+		return 0;
+	}
+	if (entry->count == entry->capacity) {
+		PlanVersion *versions = memRealloc(MEM_INDEX, entry->versions, sizeof(PlanVersion) * entry->capacity * 2);
+		if (versions == NULL) {
+			return -1;
+		}
+		entry->versions = versions;
+		entry->capacity *= 2;
+	}
+	memmove(&entry->versions[position + 1], &entry->versions[position], sizeof(PlanVersion) * (entry->count - position));
+	entry->versions[position] = version;
+	entry->count++;
+	return 0;
+}
+
+const PlanVersion *activePlan(const PlanIndex *index, int ID, const char *meal, int day) {
+	const PlanEntry *entry = &index->entries[findSlot(index->entries, index->mask, ID, meal, hashKey(ID, meal))];
+	int low = 0, high = entry->count - 1, found = -1;
+
+	if (entry->versions == NULL) {
+		return NULL;
+	}
+	if (entry->versions[high].day <= day) {
+		return &entry->versions[high];
+	}
+	// Ultima versao com dia menor ou igual a 'day'
+	while (low <= high) {
+		int mid = low + (high - low) / 2;
+		if (entry->versions[mid].day <= day) {
+			found = mid;
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return found == -1 ? NULL : &entry->versions[found];
+}
+
+void freePlanIndex(PlanIndex *index) {
+	if (index == NULL) {
+		return;
+	}
+	for (int i = 0; i <= index->mask; i++) {
+		memFree(index->entries[i].versions);
+	}
+	memFree(index->entries);
+	memFree(index);
+}
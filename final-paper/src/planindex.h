@@ -0,0 +1,70 @@
+#ifndef PLANINDEX_H
+#define PLANINDEX_H
+
+#include "types.h"
+
+/**
+ * @file planindex.h
+ * @brief Cabeçalho do índice de intervalos dos planos alimentares.
+ *
+ * Este ficheiro de cabeçalho declara um índice que associa cada par (paciente, refeição) às versões do seu
+ * plano alimentar, ordenadas por data. O plano em vigor numa data é a última versão com data igual ou
+ * anterior, pelo que cada versão cobre o intervalo até à versão seguinte:
+ * - O par é procurado numa tabela de dispersão com endereçamento aberto, em O(1).
+ * - A versão em vigor é encontrada por pesquisa binária nas versões do par, em O(log n). Como as dietas
+ *   chegam normalmente por ordem cronológica, a versão mais recente é testada primeiro.
+ *
+ * O índice é usado pelas consultas de 'logic.c' que juntam as dietas com o plano em vigor e pelos alertas
+ * do caminho de escrita, que lhe acrescentam os planos inseridos.
+ */
+
+/**
+ * @brief Cria um índice vazio.
+ *
+ * @return Retorna o novo índice, ou NULL se não houver memória.
+ */
+PlanIndex *createPlanIndex(void);
+
+/**
+ * @brief Cria um índice com os planos de um array.
+ *
+ * @param mealPlans Array de planos alimentares. Os registos vazios (ID -1) são ignorados.
+ * @param numMealPlans Número de elementos do array.
+ *
+ * @return Retorna o novo índice, ou NULL se não houver memória.
+ */
+PlanIndex *buildPlanIndex(const MealPlan *mealPlans, int numMealPlans);
+
+/**
+ * @brief Acrescenta um plano ao índice.
+ *
+ * Se o par (paciente, refeição) já tiver uma versão no mesmo dia, essa versão é substituída.
+ *
+ * @param index Índice.
+ * @param mealPlan Plano a acrescentar.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não houver memória.
+ */
+int addPlanVersion(PlanIndex *index, const MealPlan *mealPlan);
+
+/**
+ * @brief Devolve a versão do plano em vigor para um paciente e refeição num dia.
+ *
+ * @param index Índice.
+ * @param ID Identificador do paciente.
+ * @param meal Refeição.
+ * @param day Dia, como número de dias (ver 'dateToDays').
+ *
+ * @return Retorna a versão em vigor, ou NULL se o par não tiver plano ou se o plano ainda não estava em vigor
+ *         nesse dia. O ponteiro deixa de ser válido quando é acrescentado um plano ao índice.
+ */
+const PlanVersion *activePlan(const PlanIndex *index, int ID, const char *meal, int day);
+
+/**
+ * @brief Liberta um índice.
+ *
+ * @param index Índice a libertar (pode ser NULL).
+ */
+void freePlanIndex(PlanIndex *index);
+
+#endif // PLANINDEX_H
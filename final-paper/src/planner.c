@@ -0,0 +1,500 @@
+#include "planner.h"
+#include "utils.h"
+#include "sites.h"
+#include "diskindex.h"
+#include "memtrack.h"
+#include "rowstore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * @file planner.c
+ * @brief Implementação do planeador de consultas baseado em custos.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'planner.h'. As estatísticas de um ficheiro
+ * são recolhidas em duas passagens: a primeira conta os registos de cada paciente e refeição e encontra o intervalo
+ * de meses, a segunda conta os registos de cada mês. As posições dos registos de cada paciente vêm do
+ * armazenamento do ficheiro (ver 'rowstore.h').
+ *
+ * O custo de cada forma de acesso é o número estimado de registos que visita, pesado pelo custo de cada visita
+ * (ver as constantes COST_). Os valores são estimativas relativas escolhidas à mão, não medições: só indicam quantas
+ * vezes uma visita é mais cara do que a leitura sequencial de uma linha em memória, e só importam uns em relação aos outros.
+ */
+
+// Custo de visitar uma linha de um array em memoria, por ordem
+#define COST_SCAN 1.0
+// Custo de copiar uma linha a partir da sua posicao (acesso aleatorio)
+#define COST_FETCH 2.0
+// Custo de interpretar um byte de um ficheiro cujas colunas ainda nao foram lidas
+#define COST_PARSE_BYTE 1.5
+// Custo fixo de uma leitura com o indice em disco (abrir o ficheiro de dados) e de cada linha lida com 'pread'
+#define COST_DISK_OPEN 500.0
+#define COST_DISK_ROW 40.0
+// Custo de criar e esperar por uma thread
+#define COST_THREAD 2000.0
+
+// Numero maximo de refeicoes diferentes contadas; as restantes sao contadas em conjunto
+#define MAX_MEALS 16
+
+struct TableStats {
+	int rows;
+	int emptyRows;
+	int numPatients;
+	int *patientIDs;
+	int *patientRows;
+	int *slots;
+	int slotsMask;
+	int firstMonth;
+	int numMonths;
+	int *monthRows;
+	int hasMeals;
+	int numMeals;
+	char meals[MAX_MEALS][50];
+	int mealRows[MAX_MEALS];
+	int otherMeals;
+};
+
+static const char *pathNames[PLAN_COUNT] = {
+	"leitura completa",
+	"indice por data",
+	"leitura do local",
+	"leitura paralela por local",
+	"indice por paciente",
+	"indice em disco"
+};
+
+static int explainEnabled = 0;
+
+// Campos comuns a 'Diet' e 'MealPlan' usados pelas estatisticas
+static void rowFields(const void *rows, FileType fileType, int i, int *ID, Date *date, const char **meal) {
+	if (fileType == DIET) {
+		const Diet *diet = (const Diet *)rows + i;
+		*ID = diet->ID;
+		*date = diet->date;
+		*meal = diet->meal;
+	} else {
+		const MealPlan *plan = (const MealPlan *)rows + i;
+		*ID = plan->ID;
+		*date = plan->date;
+		*meal = plan->meal;
+	}
+}
+
+static const void *tableRows(const Dataset *dataset, FileType fileType, int *count) {
+	if (fileType == DIET) {
+		*count = dataset->numDiets;
+		return dataset->diets;
+	}
+	*count = dataset->numMealPlans;
+	return dataset->mealPlans;
+}
+
+static unsigned hashID(int ID) {
+	return (unsigned)ID * 2654435761u;
+}
+
+// Posicao do paciente nas estatisticas, ou -1 se nao tiver registos
+static int findEntry(const TableStats *stats, int ID) {
+	unsigned slot = hashID(ID) & stats->slotsMask;
+
+	while (stats->slots[slot] != -1) {
+		if (stats->patientIDs[stats->slots[slot]] == ID) {
+			return stats->slots[slot];
+		}
+		slot = (slot + 1) & stats->slotsMask;
+	}
+	return -1;
+}
+
+// Duplica a tabela de dispersao quando fica meio cheia
+static int growSlots(TableStats *stats) {
+	int size = (stats->slotsMask + 1) * 2;
+	int *slots = memAlloc(MEM_INDEX, sizeof(int) * size);
+	int *patientIDs = memRealloc(MEM_INDEX, stats->patientIDs, sizeof(int) * size / 2);
+	int *patientRows = memRealloc(MEM_INDEX, stats->patientRows, sizeof(int) * size / 2);
+
+	if (patientIDs != NULL) {
+		stats->patientIDs = patientIDs;
+	}
+	if (patientRows != NULL) {
+		stats->patientRows = patientRows;
+	}
+	if (slots == NULL || patientIDs == NULL || patientRows == NULL) {
+		memFree(slots);
+		return -1;
+	}
+	memset(slots, -1, sizeof(int) * size);
+	for (int entry = 0; entry < stats->numPatients; entry++) {
+		unsigned slot = hashID(stats->patientIDs[entry]) & (size - 1);
+		while (slots[slot] != -1) {
+			slot = (slot + 1) & (size - 1);
+		}
+		slots[slot] = entry;
+	}
+	memFree(stats->slots);
+	stats->slots = slots;
+	stats->slotsMask = size - 1;
+	return 0;
+}
+
+static int addPatient(TableStats *stats, int ID) {
+	int entry = findEntry(stats, ID);
+	if (entry != -1) {
+		return entry;
+	}
+	if ((stats->numPatients + 1) * 2 > stats->slotsMask + 1 && growSlots(stats) != 0) {
+		return -1;
+	}
+	unsigned slot = hashID(ID) & stats->slotsMask;
+	while (stats->slots[slot] != -1) {
+		slot = (slot + 1) & stats->slotsMask;
+	}
+	entry = stats->numPatients++;
+	stats->slots[slot] = entry;
+	stats->patientIDs[entry] = ID;
+	stats->patientRows[entry] = 0;
+	return entry;
+}
+
+// Mes de uma data como numero de meses desde o ano 0, ou -1 se a data for invalida
+static int monthOf(Date date) {
+	return date.month >= 1 && date.month <= 12 && date.year >= 0 ? date.year * 12 + date.month - 1 : -1;
+}
+
+static void countMeal(TableStats *stats, const char *meal) {
+	for (int i = 0; i < stats->numMeals; i++) {
+		if (!strcmp(stats->meals[i], meal)) {
+			stats->mealRows[i]++;
+			return;
+		}
+	}
+	if (stats->numMeals == MAX_MEALS) {
+		stats->otherMeals++;
+		return;
+	}
+	snprintf(stats->meals[stats->numMeals], sizeof(stats->meals[0]), "%s", meal);
+	stats->mealRows[stats->numMeals++] = 1;
+}
+
+// Recolhe as estatisticas dos registos, ou devolve NULL se nao houver memoria
+static TableStats *collectStats(const void *rows, int count, FileType fileType, unsigned parsed) {
+	TableStats *stats = memCalloc(MEM_INDEX, 1, sizeof(TableStats));
+	if (stats == NULL) {
+		return NULL;
+	}
+	stats->hasMeals = (parsed & COL_MEAL) != 0;
+	stats->slotsMask = 63;
+	stats->slots = memAlloc(MEM_INDEX, sizeof(int) * 64);
+	stats->patientIDs = memAlloc(MEM_INDEX, sizeof(int) * 32);
+	stats->patientRows = memAlloc(MEM_INDEX, sizeof(int) * 32);
+	if (stats->slots == NULL || stats->patientIDs == NULL || stats->patientRows == NULL) {
+		freeTableStats(stats);
+		return NULL;
+	}
+	memset(stats->slots, -1, sizeof(int) * 64);
+
+	// Primeira passagem: registos por paciente e refeicao, e o intervalo de meses
+	int firstMonth = -1, lastMonth = -1;
+	for (int i = 0; i < count; i++) {
+		int ID;
+		Date date;
+		const char *meal;
+		rowFields(rows, fileType, i, &ID, &date, &meal);
+		// Os registos sem ID (ID igual a -1) sao ignorados pelas consultas, por isso ficam fora das contagens
+		if (ID == -1) {
+			stats->emptyRows++;
+			continue;
+		}
+		int entry = addPatient(stats, ID);
+		if (entry == -1) {
+			freeTableStats(stats);
+			return NULL;
+		}
+		stats->patientRows[entry]++;
+		int month = monthOf(date);
+		if (month != -1 && (firstMonth == -1 || month < firstMonth)) {
+			firstMonth = month;
+		}
+		if (month > lastMonth) {
+			lastMonth = month;
+		}
+		if (stats->hasMeals) {
+			countMeal(stats, meal);
+		}
+	}
+
+	stats->rows = count - stats->emptyRows;
+	stats->firstMonth = firstMonth;
+	stats->numMonths = firstMonth == -1 ? 0 : lastMonth - firstMonth + 1;
+	stats->monthRows = memCalloc(MEM_INDEX, stats->numMonths > 0 ? stats->numMonths : 1, sizeof(int));
+	if (stats->monthRows == NULL) {
+		freeTableStats(stats);
+		return NULL;
+	}
+
+	// Segunda passagem: histograma mensal
+	for (int i = 0; i < count; i++) {
+		int ID;
+		Date date;
+		const char *meal;
+		rowFields(rows, fileType, i, &ID, &date, &meal);
+		int month = monthOf(date);
+		if (ID != -1 && month != -1) {
+			stats->monthRows[month - firstMonth]++;
+		}
+	}
+	return stats;
+}
+
+void buildTableStats(Dataset *dataset, FileType fileType) {
+	if (fileType == PATIENTS) {
+		return;
+	}
+	freeTableStats(dataset->stats[fileType]);
+	dataset->stats[fileType] = NULL;
+
+	unsigned parsed = dataset->lazyFiles[fileType].parsed;
+	if ((parsed & (COL_ID | COL_DATE)) != (COL_ID | COL_DATE)) {
+		return;
+	}
+
+	// Sem memoria (ou acima do orcamento dos indices) as estatisticas ficam a NULL e as consultas percorrem os registos
+	int count;
+	const void *rows = tableRows(dataset, fileType, &count);
+	dataset->stats[fileType] = collectStats(rows, count, fileType, parsed);
+}
+
+void freeTableStats(TableStats *stats) {
+	if (stats == NULL) {
+		return;
+	}
+	memFree(stats->patientIDs);
+	memFree(stats->patientRows);
+	memFree(stats->slots);
+	memFree(stats->monthRows);
+	memFree(stats);
+}
+
+// Fracao dos registos com data no periodo; dentro de um mes as datas sao consideradas uniformes
+static double periodSelectivity(const TableStats *stats, Period period) {
+	int begin = dateToDays(period.begin), end = dateToDays(period.end) + 1;
+	double rows = 0;
+
+	if (stats->rows == 0) {
+		return 0;
+	}
+	for (int i = 0; i < stats->numMonths; i++) {
+		int month = stats->firstMonth + i;
+		int first = dateToDays((Date){.day = 1, .month = month % 12 + 1, .year = month / 12});
+		int next = dateToDays((Date){.day = 1, .month = (month + 1) % 12 + 1, .year = (month + 1) / 12});
+		int overlap = (end < next ? end : next) - (begin > first ? begin : first);
+		if (overlap > 0) {
+			rows += (double)stats->monthRows[i] * overlap / (next - first);
+		}
+	}
+	return rows / stats->rows;
+}
+
+static double patientSelectivity(const TableStats *stats, int ID) {
+	if (ID == -1) {
+		return 1;
+	}
+	int entry = findEntry(stats, ID);
+	if (stats->rows == 0 || entry == -1) {
+		return 0;
+	}
+	return (double)stats->patientRows[entry] / stats->rows;
+}
+
+static double mealSelectivity(const TableStats *stats, const char *meal) {
+	if (!stats->hasMeals || meal[0] == '\0' || stats->rows == 0) {
+		return 1;
+	}
+	for (int i = 0; i < stats->numMeals; i++) {
+		if (!strcmp(stats->meals[i], meal)) {
+			return (double)stats->mealRows[i] / stats->rows;
+		}
+	}
+	return (double)stats->otherMeals / stats->rows;
+}
+
+// Registos com ID entre os 'count' atuais, supondo que a fracao de registos sem ID se manteve desde a recolha
+static double validRows(const TableStats *stats, int count) {
+	int total = stats->rows + stats->emptyRows;
+	return total > 0 ? (double)count * stats->rows / total : 0;
+}
+
+static double log2Ceil(int count) {
+	double steps = 1;
+	while (count > 1) {
+		count /= 2;
+		steps++;
+	}
+	return steps;
+}
+
+// Custo de interpretar as colunas em falta de um ficheiro, proporcional ao seu tamanho
+static double parseCost(const Dataset *dataset, FileType fileType, unsigned columns) {
+	const LazyFile *lazyFile = &dataset->lazyFiles[fileType];
+	struct stat info;
+
+	if ((lazyFile->parsed & columns) == columns || stat(lazyFile->path, &info) != 0) {
+		return 0;
+	}
+	return info.st_size * COST_PARSE_BYTE;
+}
+
+QueryPlan planQuery(const Dataset *dataset, const QueryKey *key, int diskIndex) {
+	QueryPlan plan = {.path = PLAN_FULL_SCAN};
+	FileType fileType = key->kind == QUERY_MEAL_PLAN ? MEAL_PLAN : DIET;
+	const TableStats *stats = dataset->stats[fileType];
+	int count;
+
+	for (int i = 0; i < PLAN_COUNT; i++) {
+		plan.costs[i] = -1;
+	}
+	tableRows(dataset, fileType, &count);
+
+	if (key->kind == QUERY_EXCEEDED_CALORIES) {
+		double periodRows = stats != NULL ? validRows(stats, count) * periodSelectivity(stats, key->period) : count;
+		plan.estimatedRows = periodRows;
+		int unindexed = count - dataset->indexedDiets;
+		plan.costs[PLAN_FULL_SCAN] = count * COST_SCAN;
+		if (dataset->dietsByDate != NULL) {
+			plan.costs[PLAN_DATE_INDEX] = 2 * log2Ceil(dataset->indexedDiets) + periodRows * COST_FETCH + unindexed * COST_SCAN;
+		}
+		if (dataset->numSites > 0) {
+			// Os locais sao percorridos ao mesmo tempo, por isso o custo e o do maior local mais o das threads
+			int largest = 0;
+			for (int i = 0; i < dataset->numSites; i++) {
+				largest = dataset->sites[i].numDiets > largest ? dataset->sites[i].numDiets : largest;
+			}
+			plan.costs[PLAN_PARALLEL_SITES] = largest * COST_SCAN + dataset->numSites * COST_THREAD;
+		}
+	} else {
+		unsigned columns = COL_ID | COL_DATE | COL_MEAL | (fileType == DIET ? COL_CALORIES : COL_LIMITS);
+		double parse = parseCost(dataset, fileType, columns);
+		int indexedRows = diskIndex ? countIndexedRows(dataset->diskIndex, fileType, key->ID, key->meal) : -1;
+		int first, slice;
+
+		if (stats != NULL && !stats->hasMeals && indexedRows >= 0) {
+			// Sem a contagem por refeicao, o indice em disco da o numero exato de registos do paciente e da refeicao
+			plan.estimatedRows = indexedRows * periodSelectivity(stats, key->period);
+		} else if (stats != NULL) {
+			plan.estimatedRows = validRows(stats, count) * patientSelectivity(stats, key->ID) * mealSelectivity(stats, key->meal) * periodSelectivity(stats, key->period);
+		} else {
+			// Sem estatisticas, apenas o indice em disco conhece os registos do paciente
+			plan.estimatedRows = indexedRows >= 0 ? indexedRows : count;
+		}
+		patientSlice(dataset, key->ID, fileType, &first, &slice);
+		plan.costs[dataset->numSites > 0 ? PLAN_SITE_SCAN : PLAN_FULL_SCAN] = parse + slice * COST_SCAN;
+		if (dataset->stores[fileType] != NULL) {
+			// Uma pesquisa binaria por segmento e a leitura da tabela em memoria; o armazenamento guarda apenas as chaves,
+			// por isso cada registo encontrado custa a leitura da sua entrada, a ordenacao das posicoes e o acesso
+			// aleatorio ao array de registos
+			int segments, memtableRows;
+			storeShape(dataset->stores[fileType], &segments, &memtableRows);
+			double fetched = stats != NULL ? validRows(stats, count) * patientSelectivity(stats, key->ID) * periodSelectivity(stats, key->period) : count;
+			plan.costs[PLAN_PATIENT_INDEX] = parse + segments * log2Ceil(count) + memtableRows * COST_SCAN +
+				fetched * (COST_SCAN + log2Ceil((int)fetched) * COST_SCAN + COST_FETCH);
+		}
+		if (indexedRows >= 0) {
+			plan.costs[PLAN_DISK_INDEX] = COST_DISK_OPEN + indexedRows * COST_DISK_ROW;
+		}
+	}
+
+	plan.path = PLAN_COUNT;
+	for (int i = 0; i < PLAN_COUNT; i++) {
+		if (plan.costs[i] >= 0 && (plan.path == PLAN_COUNT || plan.costs[i] < plan.costs[plan.path])) {
+			plan.path = (AccessPath)i;
+		}
+	}
+	return plan;
+}
+
+int patientRows(const Dataset *dataset, FileType fileType, int ID, Period period, int **positions, void **rows) {
+	size_t size = fileType == DIET ? sizeof(Diet) : sizeof(MealPlan);
+	int count, found = 0, *list;
+	const void *table = tableRows(dataset, fileType, &count);
+
+	// O numero de registos visiveis limita as posicoes, porque a escrita pode ter acrescentado registos ao armazenamento
+	if (dataset->stores[fileType] != NULL) {
+		if ((found = storeLookup(dataset->stores[fileType], ID, period, count, &list)) < 0) {
+			return -1;
+		}
+	} else {
+		if ((list = memAlloc(MEM_QUERY, sizeof(int) * (count > 0 ? count : 1))) == NULL) {
+			return -1;
+		}
+		for (int i = 0; i < count; i++) {
+			int rowID;
+			Date date;
+			const char *meal;
+			rowFields(table, fileType, i, &rowID, &date, &meal);
+			if (rowID == ID && dateInPeriod(date, period) == 1) {
+				list[found++] = i;
+			}
+		}
+	}
+
+	if (rows != NULL) {
+		char *copy = memAlloc(MEM_QUERY, size * (found > 0 ? found : 1));
+		if (copy == NULL) {
+			memFree(list);
+			return -1;
+		}
+		for (int i = 0; i < found; i++) {
+			memcpy(copy + size * i, (const char *)table + size * list[i], size);
+		}
+		*rows = copy;
+	}
+	if (positions != NULL) {
+		*positions = list;
+	} else {
+		memFree(list);
+	}
+	return found;
+}
+
+int matchingRows(const void *rows, int count, FileType fileType, const QueryKey *key) {
+	int matches = 0;
+
+	for (int i = 0; i < count; i++) {
+		int ID;
+		Date date;
+		const char *meal;
+		rowFields(rows, fileType, i, &ID, &date, &meal);
+		if (ID != -1 && (key->ID == -1 || ID == key->ID) && (key->meal[0] == '\0' || !strcmp(meal, key->meal)) && dateInPeriod(date, key->period) == 1) {
+			matches++;
+		}
+	}
+	return matches;
+}
+
+void setExplain(int enabled) {
+	explainEnabled = enabled;
+}
+
+int explaining(void) {
+	return explainEnabled;
+}
+
+void explainPlan(const QueryPlan *plan, long actualRows) {
+	if (!explainEnabled) {
+		return;
+	}
+	if (plan == NULL) {
+		printf("Plano: resultado da cache (%ld linhas)\n", actualRows);
+		return;
+	}
+	printf("Plano: %s (custo estimado %.0f)\n", pathNames[plan->path], plan->costs[plan->path]);
+	for (int i = 0; i < PLAN_COUNT; i++) {
+		if (i != (int)plan->path && plan->costs[i] >= 0) {
+			printf("  Alternativa: %s (custo estimado %.0f)\n", pathNames[i], plan->costs[i]);
+		}
+	}
+	printf("  Linhas estimadas: %.0f, linhas reais: %ld\n", plan->estimatedRows, actualRows);
+}
@@ -0,0 +1,119 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "types.h"
+
+/**
+ * @file planner.h
+ * @brief Cabeçalho do planeador de consultas baseado em custos.
+ *
+ * Este ficheiro de cabeçalho declara as funções que escolhem, para cada consulta, a forma de obter os registos
+ * (ver 'AccessPath'): percorrer o array inteiro ou apenas o local do paciente, usar o índice por data, o
+ * armazenamento dos registos de cada paciente ('rowstore.h') ou o índice em disco. A escolha é feita a partir de
+ * estatísticas recolhidas no carregamento de 'diet.txt' e de 'mealPlan.txt':
+ * - o número de registos abrangidos;
+ * - o número de registos de cada paciente;
+ * - um histograma mensal das datas;
+ * - o número de registos de cada refeição.
+ *
+ * A seletividade de cada filtro (período, paciente, refeição) é estimada a partir destas contagens, supondo que
+ * os filtros são independentes, e o custo de cada forma de acesso é calculado a partir do número estimado de
+ * registos que tem de visitar. Os registos acrescentados depois do carregamento não estão nas estatísticas: o seu
+ * número é estimado com as mesmas seletividades, e o custo do armazenamento inclui uma pesquisa binária por
+ * segmento e a leitura da tabela em memória.
+ *
+ * Com '--explain', cada consulta imprime o plano escolhido, o custo de todas as alternativas e o número de
+ * registos estimado e real.
+ */
+
+/**
+ * @brief Recolhe as estatísticas de um ficheiro a partir dos registos já interpretados.
+ *
+ * As estatísticas precisam das colunas ID e data; a contagem por refeição só é feita se a coluna da refeição
+ * também estiver interpretada. Se as colunas não estiverem disponíveis, se não houver memória ou se o orçamento
+ * dos índices for ultrapassado, as estatísticas ficam a NULL e as consultas ao ficheiro percorrem os registos.
+ * As estatísticas anteriores do ficheiro são substituídas.
+ *
+ * @param dataset Conjunto de dados carregado.
+ * @param fileType Ficheiro pretendido (DIET ou MEAL_PLAN; para PATIENTS não faz nada).
+ */
+void buildTableStats(Dataset *dataset, FileType fileType);
+
+/**
+ * @brief Liberta as estatísticas de um ficheiro.
+ *
+ * @param stats Estatísticas a libertar (pode ser NULL).
+ */
+void freeTableStats(TableStats *stats);
+
+/**
+ * @brief Escolhe a forma de acesso de menor custo estimado para uma consulta.
+ *
+ * São consideradas apenas as formas de acesso que se aplicam ao tipo de consulta e ao estado do conjunto de
+ * dados: com vários locais, a consulta sobre todos os pacientes é sempre feita em paralelo por local, e o índice
+ * em disco só é considerado se 'diskIndex' for 1. Se as colunas da consulta ainda não estiverem interpretadas,
+ * o custo de as ler é somado às formas de acesso que trabalham sobre os arrays em memória.
+ *
+ * @param dataset Conjunto de dados carregado.
+ * @param key Parâmetros da consulta.
+ * @param diskIndex 1 se o índice em disco pode responder à consulta, 0 caso contrário.
+ *
+ * @return Retorna o plano escolhido.
+ */
+QueryPlan planQuery(const Dataset *dataset, const QueryKey *key, int diskIndex);
+
+/**
+ * @brief Devolve as posições e uma cópia dos registos de um paciente com data no período, pela ordem do array.
+ *
+ * As posições vêm do armazenamento do ficheiro ('rowstore.h'); sem armazenamento, os registos são percorridos
+ * sequencialmente.
+ *
+ * @param dataset Conjunto de dados carregado.
+ * @param fileType Ficheiro pretendido (DIET ou MEAL_PLAN).
+ * @param ID Identificador do paciente.
+ * @param period Período pretendido.
+ * @param positions Recebe um array novo com as posições, que deve ser libertado com 'free' (pode ser NULL).
+ * @param rows Recebe um array novo de 'Diet' ou 'MealPlan' (conforme 'fileType') com a cópia dos registos, que
+ *             deve ser libertado com 'free' (pode ser NULL).
+ *
+ * @return Retorna o número de registos do paciente no período, ou -1 se não houver memória.
+ */
+int patientRows(const Dataset *dataset, FileType fileType, int ID, Period period, int **positions, void **rows);
+
+/**
+ * @brief Conta os registos que satisfazem os filtros de uma consulta.
+ *
+ * @param rows Array de 'Diet' ou 'MealPlan' (conforme 'fileType').
+ * @param count Número de elementos do array.
+ * @param fileType Tipo dos registos (DIET ou MEAL_PLAN).
+ * @param key Parâmetros da consulta: um 'ID' igual a -1 ou uma refeição vazia não filtram. Os registos sem ID
+ *            (ID igual a -1) nunca contam, tal como nas consultas.
+ *
+ * @return Retorna o número de registos que satisfazem os filtros.
+ */
+int matchingRows(const void *rows, int count, FileType fileType, const QueryKey *key);
+
+/**
+ * @brief Liga ou desliga a descrição dos planos. Com a descrição desligada, 'explainPlan' não faz nada.
+ *
+ * @param enabled 1 para ligar, 0 para desligar.
+ */
+void setExplain(int enabled);
+
+/**
+ * @brief Indica se a descrição dos planos está ligada, para que o número real de registos só seja contado
+ *        quando vai ser impresso.
+ *
+ * @return Retorna 1 se a descrição estiver ligada, ou 0 caso contrário.
+ */
+int explaining(void);
+
+/**
+ * @brief Imprime o plano executado, o custo das alternativas e o número de registos estimado e real.
+ *
+ * @param plan Plano executado, ou NULL se o resultado veio da cache de resultados.
+ * @param actualRows Número real de registos que satisfazem os filtros da consulta.
+ */
+void explainPlan(const QueryPlan *plan, long actualRows);
+
+#endif // PLANNER_H
@@ -0,0 +1,132 @@
+#include "profile.h"
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @file profile.c
+ * @brief Implementação do modo de perfil com contadores de hardware.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'profile.h'. Cada contador é aberto em
+ * separado (e não como um grupo) para que um evento em falta não impeça os restantes de serem medidos. Quando
+ * há mais contadores do que registos no processador, o núcleo reparte-os no tempo; o valor lido é então
+ * escalado pela fração do tempo em que o contador esteve ativo.
+ */
+
+#define NUM_COUNTERS 5
+
+// Evento de cada contador e nome usado no resultado, pela mesma ordem
+static const struct {
+	uint32_t type;
+	uint64_t config;
+	const char *name;
+} counters[NUM_COUNTERS] = {
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "ciclos"},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instrucoes"},
+	{PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), "falhas L1D"},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "falhas LLC"},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "falhas de previsao"}
+};
+
+static int profiling = 0;
+static int fds[NUM_COUNTERS];
+static struct timespec start;
+
+void setProfiling(int enabled) {
+	profiling = enabled;
+}
+
+static int openCounter(int counter) {
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = counters[counter].type;
+	attr.config = counters[counter].config;
+	attr.disabled = 1;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	// O glibc nao tem funcao para esta chamada ao sistema
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void profileBegin(void) {
+	if (!profiling) {
+		return;
+	}
+	for (int i = 0; i < NUM_COUNTERS; i++) {
+		fds[i] = openCounter(i);
+		if (fds[i] != -1) {
+			ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	// Os contadores sao ligados por ultimo, para nao contarem a abertura dos restantes
+	for (int i = 0; i < NUM_COUNTERS; i++) {
+		if (fds[i] != -1) {
+			ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+// Le um contador e escala o valor se o contador nao esteve sempre ativo; devolve -1 se nao foi medido
+static double readCounter(int fd) {
+	uint64_t values[3];
+
+	if (fd == -1 || read(fd, values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+		return -1;
+	}
+	return values[2] < values[1] ? (double)values[0] * values[1] / values[2] : (double)values[0];
+}
+
+void profileEnd(const char *kernel, long rows) {
+	double totals[NUM_COUNTERS];
+	struct timespec end;
+	int available = 0;
+
+	if (!profiling) {
+		return;
+	}
+	for (int i = 0; i < NUM_COUNTERS; i++) {
+		if (fds[i] != -1) {
+			ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	for (int i = 0; i < NUM_COUNTERS; i++) {
+		totals[i] = readCounter(fds[i]);
+		available += totals[i] >= 0;
+		if (fds[i] != -1) {
+			close(fds[i]);
+		}
+	}
+
+	// O perfil vai para a saida de erro, para nao se misturar com o resultado da consulta
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	long perRow = rows > 0 ? rows : 1;
+	fprintf(stderr, "Perfil %s: %ld registos em %.6f s", kernel, rows, seconds);
+	if (available == 0) {
+		fprintf(stderr, " (contadores de hardware indisponiveis)\n");
+		return;
+	}
+	fprintf(stderr, "\n ");
+	for (int i = 0; i < NUM_COUNTERS; i++) {
+		if (totals[i] < 0) {
+			fprintf(stderr, " %s/registo n/d", counters[i].name);
+		} else {
+			fprintf(stderr, " %s/registo %.2f", counters[i].name, totals[i] / perRow);
+		}
+	}
+	if (totals[0] > 0 && totals[1] >= 0) {
+		fprintf(stderr, " IPC %.2f", totals[1] / totals[0]);
+	}
+	fprintf(stderr, "\n");
+}
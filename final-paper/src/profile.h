@@ -0,0 +1,44 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/**
+ * @file profile.h
+ * @brief Cabeçalho do modo de perfil com contadores de hardware.
+ *
+ * Este ficheiro de cabeçalho declara as funções que medem uma consulta (ou o carregamento dos dados) com os
+ * contadores de desempenho do processador, lidos através de 'perf_event_open'. Para cada consulta medida é
+ * impresso o tempo e, por registo processado, o número de ciclos, de instruções, de falhas na cache L1 de dados,
+ * de falhas na cache de último nível (LLC) e de falhas na previsão de saltos.
+ *
+ * Os contadores são abertos com herança, pelo que incluem o trabalho das threads criadas pela consulta (que
+ * são sempre terminadas antes de a consulta acabar). Apenas é contado o código em modo de utilizador.
+ *
+ * O modo de perfil está desligado por omissão e é ligado com '--profile'. Se um contador não estiver
+ * disponível (máquina virtual, processador sem esse evento ou 'perf_event_paranoid' demasiado restritivo),
+ * o seu valor aparece como "n/d"; se nenhum estiver disponível é impresso apenas o tempo. O resultado é escrito
+ * na saída de erro, para que a saída das consultas não mude com o perfil ligado.
+ */
+
+/**
+ * @brief Liga ou desliga o modo de perfil. Com o modo desligado, 'profileBegin' e 'profileEnd' não fazem nada.
+ *
+ * @param enabled 1 para ligar, 0 para desligar.
+ */
+void setProfiling(int enabled);
+
+/**
+ * @brief Começa a medir uma consulta: abre e inicia os contadores.
+ *
+ * As medições não podem ser encaixadas umas nas outras; cada 'profileBegin' tem de ser seguido de 'profileEnd'.
+ */
+void profileBegin(void);
+
+/**
+ * @brief Termina a medição iniciada por 'profileBegin', imprime o resultado e fecha os contadores.
+ *
+ * @param kernel Nome da consulta medida (ex: "exceededCalories").
+ * @param rows Número de registos processados pela consulta, usado para os valores por registo.
+ */
+void profileEnd(const char *kernel, long rows);
+
+#endif // PROFILE_H
@@ -0,0 +1,477 @@
+#include "rowstore.h"
+#include "loader.h"
+#include "memtrack.h"
+#include "pipeline.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file rowstore.c
+ * @brief Implementação do armazenamento estruturado em log (LSM) das posições das dietas e dos planos.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'rowstore.h'. Cada segmento é um array de
+ * entradas (paciente, data, posição) ordenado por essa chave, e guarda as próprias chaves, para que nem a
+ * compactação nem as consultas tenham de ler o array de registos, que a escrita pode estar a realocar.
+ *
+ * A lista de segmentos é publicada numa versão imutável ('StoreVersion'): a escrita nunca altera uma versão
+ * publicada, cria uma nova e entrega a antiga a 'releaseMemory', tal como os arrays da versão publicada do
+ * 'Dataset' (ver 'epoch.h'). O mutex 'lock' protege apenas a tabela em memória e a troca do ponteiro da versão,
+ * para que uma consulta leia a tabela e a versão correspondente; os segmentos são percorridos depois, sem
+ * bloqueio. A compactação funde os segmentos com os mutexes livres e entrega o resultado à escrita, que é a única
+ * thread que publica versões e liberta memória; o mutex 'compaction' serve apenas para essa troca.
+ */
+
+// Chave de um registo e a sua posicao no array; a data usa 'dateKey', com a mesma ordem que 'dateInPeriod'
+typedef struct {
+	int ID;
+	long date;
+	int position;
+} StoreEntry;
+
+// Segmento imutavel, ordenado por (paciente, data, posicao), com o intervalo de pacientes e de datas que contem
+typedef struct {
+	StoreEntry *entries;
+	int count;
+	int minID;
+	int maxID;
+	long minDate;
+	long maxDate;
+} Segment;
+
+// Versao publicada da lista de segmentos, do mais antigo para o mais recente
+typedef struct {
+	int numSegments;
+	Segment *segments[];
+} StoreVersion;
+
+struct RowStore {
+	StoreVersion *version;
+	StoreEntry *memtable;
+	int memtableRows;
+	long frozen;
+	long compactions;
+	pthread_mutex_t lock;
+	Segment *merged;
+	int mergedFirst;
+	int started;
+	int stopping;
+	pthread_t compactor;
+	pthread_mutex_t compaction;
+	pthread_cond_t wake;
+};
+
+static int compareEntries(const void *first, const void *second) {
+	const StoreEntry *a = (const StoreEntry *)first, *b = (const StoreEntry *)second;
+
+	if (a->ID != b->ID) {
+		return (a->ID > b->ID) - (a->ID < b->ID);
+	}
+	if (a->date != b->date) {
+		return (a->date > b->date) - (a->date < b->date);
+	}
+	return (a->position > b->position) - (a->position < b->position);
+}
+
+static int comparePositions(const void *first, const void *second) {
+	int a = *(const int *)first, b = *(const int *)second;
+	return (a > b) - (a < b);
+}
+
+// Cria um segmento a partir de entradas ja ordenadas, ficando dono do array
+static Segment *createSegment(StoreEntry *entries, int count) {
+	Segment *segment = memAlloc(MEM_INDEX, sizeof(Segment));
+
+	if (segment == NULL) {
+		return NULL;
+	}
+	*segment = (Segment){.entries = entries, .count = count, .minID = entries[0].ID, .maxID = entries[count - 1].ID,
+		.minDate = entries[0].date, .maxDate = entries[0].date};
+	for (int i = 1; i < count; i++) {
+		if (entries[i].date < segment->minDate) {
+			segment->minDate = entries[i].date;
+		}
+		if (entries[i].date > segment->maxDate) {
+			segment->maxDate = entries[i].date;
+		}
+	}
+	return segment;
+}
+
+static void freeSegment(Segment *segment) {
+	if (segment != NULL) {
+		memFree(segment->entries);
+		memFree(segment);
+	}
+}
+
+// Um segmento substituido pode ainda estar a ser lido por uma consulta concorrente ate a proxima versao do 'Dataset'
+static void releaseSegment(Dataset *dataset, Segment *segment) {
+	releaseMemory(dataset, segment->entries);
+	releaseMemory(dataset, segment);
+}
+
+static StoreVersion *createVersion(int numSegments) {
+	StoreVersion *version = memAlloc(MEM_INDEX, sizeof(StoreVersion) + sizeof(Segment *) * numSegments);
+
+	if (version != NULL) {
+		version->numSegments = numSegments;
+	}
+	return version;
+}
+
+// Grupo de tamanho do segmento: os segmentos do grupo 't' tem ate MEMTABLE_ROWS * COMPACTION_FANIN^t entradas
+static int tierOf(const Segment *segment) {
+	long size = MEMTABLE_ROWS;
+	int tier = 0;
+
+	while (segment->count > size) {
+		size *= COMPACTION_FANIN;
+		tier++;
+	}
+	return tier;
+}
+
+// Devolve o primeiro de COMPACTION_FANIN segmentos seguidos do mesmo grupo, ou -1 se nao houver
+static int findCompaction(const StoreVersion *version) {
+	int run = 0;
+
+	for (int i = 0; i < version->numSegments; i++) {
+		run = i > 0 && tierOf(version->segments[i]) == tierOf(version->segments[i - 1]) ? run + 1 : 1;
+		if (run == COMPACTION_FANIN) {
+			return i - COMPACTION_FANIN + 1;
+		}
+	}
+	return -1;
+}
+
+// Fusao de segmentos ordenados: em cada passo sai a menor entrada entre as primeiras de cada segmento
+static Segment *mergeSegments(Segment **inputs, int count) {
+	int heads[COMPACTION_FANIN] = {0};
+	int total = 0;
+
+	for (int i = 0; i < count; i++) {
+		total += inputs[i]->count;
+	}
+	StoreEntry *entries = memAlloc(MEM_INDEX, sizeof(StoreEntry) * total);
+	if (entries == NULL) {
+		return NULL;
+	}
+	for (int out = 0; out < total; out++) {
+		int best = -1;
+		for (int i = 0; i < count; i++) {
+			if (heads[i] < inputs[i]->count && (best == -1 || compareEntries(&inputs[i]->entries[heads[i]], &inputs[best]->entries[heads[best]]) < 0)) {
+				best = i;
+			}
+		}
+		entries[out] = inputs[best]->entries[heads[best]++];
+	}
+
+	Segment *segment = createSegment(entries, total);
+	if (segment == NULL) {
+		memFree(entries);
+	}
+	return segment;
+}
+
+static void *compactSegments(void *arg) {
+	RowStore *store = (RowStore *)arg;
+
+	pthread_mutex_lock(&store->compaction);
+	while (!store->stopping) {
+		// Cada fusao espera que a anterior seja instalada pela escrita
+		int first = store->merged == NULL ? findCompaction(store->version) : -1;
+		if (first == -1) {
+			pthread_cond_wait(&store->wake, &store->compaction);
+			continue;
+		}
+		Segment *inputs[COMPACTION_FANIN];
+		memcpy(inputs, &store->version->segments[first], sizeof(inputs));
+		pthread_mutex_unlock(&store->compaction);
+
+		// Os segmentos de entrada so sao libertados pela escrita depois de o resultado ser instalado
+		Segment *merged = mergeSegments(inputs, COMPACTION_FANIN);
+
+		pthread_mutex_lock(&store->compaction);
+		if (merged == NULL) {
+			// Sem memoria, a compactacao volta a ser tentada quando for congelado o proximo segmento
+			if (!store->stopping) {
+				pthread_cond_wait(&store->wake, &store->compaction);
+			}
+			continue;
+		}
+		store->merged = merged;
+		store->mergedFirst = first;
+	}
+	pthread_mutex_unlock(&store->compaction);
+	return NULL;
+}
+
+// Publica uma nova versao; com 'resetMemtable', os registos da tabela em memoria passam a estar no ultimo segmento
+static void publishVersion(RowStore *store, StoreVersion *version, int resetMemtable) {
+	pthread_mutex_lock(&store->lock);
+	store->version = version;
+	if (resetMemtable) {
+		store->frozen += store->memtableRows;
+		store->memtableRows = 0;
+	} else {
+		store->compactions++;
+	}
+	pthread_mutex_unlock(&store->lock);
+}
+
+// Substitui os segmentos de entrada pelo resultado da compactacao (chamada pela escrita, com o mutex 'compaction')
+static void installCompaction(Dataset *dataset, RowStore *store) {
+	StoreVersion *previous = store->version;
+	int first = store->mergedFirst;
+
+	// Enquanto a fusao decorria apenas foram acrescentados segmentos no fim, por isso 'first' continua valido
+	StoreVersion *version = createVersion(previous->numSegments - COMPACTION_FANIN + 1);
+	if (version == NULL) {
+		// A fusao fica pendente e volta a ser instalada no proximo registo
+		return;
+	}
+	memcpy(version->segments, previous->segments, sizeof(Segment *) * first);
+	version->segments[first] = store->merged;
+	memcpy(&version->segments[first + 1], &previous->segments[first + COMPACTION_FANIN],
+		sizeof(Segment *) * (previous->numSegments - first - COMPACTION_FANIN));
+	publishVersion(store, version, 0);
+
+	for (int i = first; i < first + COMPACTION_FANIN; i++) {
+		releaseSegment(dataset, previous->segments[i]);
+	}
+	releaseMemory(dataset, previous);
+	store->merged = NULL;
+	pthread_cond_signal(&store->wake);
+}
+
+// Congela a tabela em memoria num segmento ordenado e acorda a compactacao (chamada pela escrita, com o mutex 'compaction')
+static int freezeMemtable(Dataset *dataset, RowStore *store) {
+	StoreVersion *previous = store->version;
+	StoreEntry *entries = memAlloc(MEM_INDEX, sizeof(StoreEntry) * store->memtableRows);
+	StoreVersion *version = createVersion(previous->numSegments + 1);
+	Segment *segment = NULL;
+
+	// A tabela so e alterada pela escrita, por isso pode ser copiada sem o mutex
+	if (entries != NULL && version != NULL) {
+		memcpy(entries, store->memtable, sizeof(StoreEntry) * store->memtableRows);
+		qsort(entries, store->memtableRows, sizeof(StoreEntry), compareEntries);
+		segment = createSegment(entries, store->memtableRows);
+	}
+	if (segment == NULL) {
+		memFree(entries);
+		memFree(version);
+		return -1;
+	}
+	memcpy(version->segments, previous->segments, sizeof(Segment *) * previous->numSegments);
+	version->segments[previous->numSegments] = segment;
+	publishVersion(store, version, 1);
+	releaseMemory(dataset, previous);
+
+	if (!store->started && pthread_create(&store->compactor, NULL, compactSegments, store) == 0) {
+		store->started = 1;
+	}
+	pthread_cond_signal(&store->wake);
+	return 0;
+}
+
+// Primeira entrada do segmento com chave maior ou igual a (ID, date)
+static int lowerBound(const Segment *segment, int ID, long date) {
+	int low = 0, high = segment->count;
+
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		const StoreEntry *entry = &segment->entries[mid];
+		if (entry->ID < ID || (entry->ID == ID && entry->date < date)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+void buildRowStore(Dataset *dataset, FileType fileType) {
+	if (fileType == PATIENTS) {
+		return;
+	}
+	freeRowStore(dataset->stores[fileType]);
+	dataset->stores[fileType] = NULL;
+	if ((dataset->lazyFiles[fileType].parsed & (COL_ID | COL_DATE)) != (COL_ID | COL_DATE)) {
+		return;
+	}
+
+	int count = fileType == DIET ? dataset->numDiets : dataset->numMealPlans;
+	RowStore *store = memCalloc(MEM_INDEX, 1, sizeof(RowStore));
+	StoreEntry *entries = memAlloc(MEM_INDEX, sizeof(StoreEntry) * (count > 0 ? count : 1));
+	if (store == NULL || entries == NULL) {
+		memFree(store);
+		memFree(entries);
+		return;
+	}
+	pthread_mutex_init(&store->lock, NULL);
+	pthread_mutex_init(&store->compaction, NULL);
+	pthread_cond_init(&store->wake, NULL);
+
+	// Os registos do carregamento formam o primeiro segmento; os registos vazios nao pertencem a nenhum paciente
+	int used = 0;
+	for (int row = 0; row < count; row++) {
+		int ID = fileType == DIET ? dataset->diets[row].ID : dataset->mealPlans[row].ID;
+		Date date = fileType == DIET ? dataset->diets[row].date : dataset->mealPlans[row].date;
+		if (ID != -1) {
+			entries[used++] = (StoreEntry){.ID = ID, .date = dateKey(date), .position = row};
+		}
+	}
+	qsort(entries, used, sizeof(StoreEntry), compareEntries);
+	Segment *segment = used > 0 ? createSegment(entries, used) : NULL;
+	if (segment == NULL) {
+		memFree(entries);
+	}
+	store->version = createVersion(segment != NULL ? 1 : 0);
+	if (store->version == NULL || (used > 0 && segment == NULL)) {
+		freeSegment(segment);
+		freeRowStore(store);
+		return;
+	}
+	if (segment != NULL) {
+		store->version->segments[0] = segment;
+	}
+	dataset->stores[fileType] = store;
+}
+
+int storeReserve(Dataset *dataset, FileType fileType) {
+	RowStore *store = dataset->stores[fileType];
+	int status = 0;
+
+	if (store == NULL) {
+		return 0;
+	}
+	if (store->memtable == NULL && (store->memtable = memAlloc(MEM_INDEX, sizeof(StoreEntry) * MEMTABLE_ROWS)) == NULL) {
+		return -1;
+	}
+	pthread_mutex_lock(&store->compaction);
+	if (store->merged != NULL) {
+		installCompaction(dataset, store);
+	}
+	if (store->memtableRows == MEMTABLE_ROWS) {
+		status = freezeMemtable(dataset, store);
+	}
+	pthread_mutex_unlock(&store->compaction);
+	return status;
+}
+
+void storeAppend(RowStore *store, int ID, Date date, int position) {
+	if (store == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&store->lock);
+	store->memtable[store->memtableRows++] = (StoreEntry){.ID = ID, .date = dateKey(date), .position = position};
+	pthread_mutex_unlock(&store->lock);
+}
+
+int storeLookup(RowStore *store, int ID, Period period, int limit, int **positions) {
+	long begin = dateKey(period.begin), end = dateKey(period.end);
+	int found = 0;
+	int *list = memAlloc(MEM_QUERY, sizeof(int) * MEMTABLE_ROWS);
+
+	if (list == NULL) {
+		return -1;
+	}
+	// A tabela em memoria e a versao sao lidas em conjunto, para que um segmento congelado nao falte nem se repita
+	pthread_mutex_lock(&store->lock);
+	const StoreVersion *version = store->version;
+	for (int i = 0; i < store->memtableRows; i++) {
+		const StoreEntry *entry = &store->memtable[i];
+		if (entry->ID == ID && entry->date >= begin && entry->date <= end && entry->position < limit) {
+			list[found++] = entry->position;
+		}
+	}
+	pthread_mutex_unlock(&store->lock);
+
+	// Os segmentos fora do intervalo de pacientes ou de datas nao sao lidos
+	int total = found;
+	for (int i = 0; i < version->numSegments; i++) {
+		const Segment *segment = version->segments[i];
+		if (ID >= segment->minID && ID <= segment->maxID && end >= segment->minDate && begin <= segment->maxDate) {
+			total += lowerBound(segment, ID, end + 1) - lowerBound(segment, ID, begin);
+		}
+	}
+	if (total > MEMTABLE_ROWS) {
+		int *grown = memRealloc(MEM_QUERY, list, sizeof(int) * total);
+		if (grown == NULL) {
+			memFree(list);
+			return -1;
+		}
+		list = grown;
+	}
+	for (int i = 0; i < version->numSegments; i++) {
+		const Segment *segment = version->segments[i];
+		if (ID < segment->minID || ID > segment->maxID || end < segment->minDate || begin > segment->maxDate) {
+			continue;
+		}
+		int last = lowerBound(segment, ID, end + 1);
+		for (int j = lowerBound(segment, ID, begin); j < last; j++) {
+			if (segment->entries[j].position < limit) {
+				list[found++] = segment->entries[j].position;
+			}
+		}
+	}
+
+	qsort(list, found, sizeof(int), comparePositions);
+	*positions = list;
+	return found;
+}
+
+void storeShape(RowStore *store, int *segments, int *memtableRows) {
+	pthread_mutex_lock(&store->lock);
+	*segments = store->version->numSegments;
+	*memtableRows = store->memtableRows;
+	pthread_mutex_unlock(&store->lock);
+}
+
+void printStoreStats(RowStore *store, const char *name) {
+	if (store == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&store->lock);
+	const StoreVersion *version = store->version;
+	int memtableRows = store->memtableRows;
+	long frozen = store->frozen, compactions = store->compactions;
+	pthread_mutex_unlock(&store->lock);
+
+	printf("Armazenamento de %s: %d segmentos (", name, version->numSegments);
+	for (int i = 0; i < version->numSegments; i++) {
+		printf("%s%d", i > 0 ? ", " : "", version->segments[i]->count);
+	}
+	printf(" registos), %d registos em memoria\n", memtableRows);
+	printf("  Segmentos congelados: %ld registos, Compactacoes: %ld\n", frozen, compactions);
+}
+
+void freeRowStore(RowStore *store) {
+	if (store == NULL) {
+		return;
+	}
+	// A compactacao em curso termina antes de os segmentos serem libertados
+	pthread_mutex_lock(&store->compaction);
+	store->stopping = 1;
+	pthread_cond_signal(&store->wake);
+	pthread_mutex_unlock(&store->compaction);
+	if (store->started) {
+		pthread_join(store->compactor, NULL);
+	}
+
+	if (store->version != NULL) {
+		for (int i = 0; i < store->version->numSegments; i++) {
+			freeSegment(store->version->segments[i]);
+		}
+	}
+	freeSegment(store->merged);
+	memFree(store->version);
+	memFree(store->memtable);
+	pthread_mutex_destroy(&store->lock);
+	pthread_mutex_destroy(&store->compaction);
+	pthread_cond_destroy(&store->wake);
+	memFree(store);
+}
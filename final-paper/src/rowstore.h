@@ -0,0 +1,117 @@
+#ifndef ROWSTORE_H
+#define ROWSTORE_H
+
+#include "types.h"
+
+/**
+ * @file rowstore.h
+ * @brief Cabeçalho do armazenamento estruturado em log (LSM) das posições das dietas e dos planos.
+ *
+ * Os arrays 'diets' e 'mealPlans' e os ficheiros de dados guardam os registos pela ordem de chegada, e cada
+ * registo inserido é acrescentado ao fim. Para que as consultas sobre um paciente não tenham de percorrer esses
+ * registos, cada ficheiro tem um 'RowStore' com a chave (paciente, data) e a posição de cada registo no array:
+ * - Os registos inseridos entram numa tabela em memória ('memtable'), sem ordem, com até MEMTABLE_ROWS
+ *   registos. Quando fica cheia é ordenada por (paciente, data) e congelada num segmento imutável, com o menor
+ *   e o maior paciente e data que contém.
+ * - Os registos lidos no carregamento formam o primeiro segmento.
+ * - Uma thread em segundo plano junta os segmentos pequenos em segmentos maiores: os segmentos são agrupados
+ *   por tamanho (cada grupo é COMPACTION_FANIN vezes maior que o anterior) e, quando um grupo tem
+ *   COMPACTION_FANIN segmentos seguidos, estes são fundidos num só, que passa para o grupo seguinte. O
+ *   número de segmentos cresce assim com o logaritmo do número de registos inseridos, e cada registo só é
+ *   copiado uma vez por grupo.
+ * - Uma consulta ignora os segmentos cujo intervalo de pacientes e datas não contém a chave pedida, procura
+ *   nos restantes com pesquisa binária e percorre a 'memtable'.
+ *
+ * Os segmentos nunca são alterados depois de criados. A lista de segmentos é publicada como uma versão imutável,
+ * substituída pela escrita a cada congelamento ou compactação; a versão antiga e os segmentos substituídos são
+ * libertados com 'releaseMemory', pelo que as consultas concorrentes com a escrita ('--live') os podem continuar
+ * a ler sem bloqueio. Apenas a 'memtable' e a troca da versão são protegidas por um mutex, que nenhuma operação
+ * guarda por mais do que a leitura da 'memtable'. A thread de compactação não publica nem liberta memória: entrega
+ * o segmento fundido à escrita, que o instala no registo seguinte.
+ */
+
+/**
+ * @brief Número máximo de registos da tabela em memória antes de ser congelada num segmento.
+ */
+#define MEMTABLE_ROWS 4096
+
+/**
+ * @brief Número de segmentos do mesmo tamanho que são fundidos numa compactação.
+ */
+#define COMPACTION_FANIN 4
+
+/**
+ * @brief Constrói o armazenamento de um ficheiro a partir dos registos já interpretados, substituindo o anterior.
+ *
+ * O armazenamento precisa das colunas ID e data. Se não estiverem disponíveis, ou se não houver memória (ou o
+ * orçamento dos índices for ultrapassado), 'dataset->stores[fileType]' fica a NULL e as consultas sobre um
+ * paciente percorrem os registos.
+ *
+ * @param dataset Conjunto de dados carregado.
+ * @param fileType Ficheiro pretendido (DIET ou MEAL_PLAN; para PATIENTS não faz nada).
+ */
+void buildRowStore(Dataset *dataset, FileType fileType);
+
+/**
+ * @brief Prepara o armazenamento de um ficheiro para receber o próximo registo inserido.
+ *
+ * Instala a compactação que a thread em segundo plano tenha terminado e, se a tabela em memória estiver cheia,
+ * congela-a num segmento; a primeira vez que um segmento é congelado é iniciada a thread de compactação. Deve
+ * ser chamada pela escrita antes de o registo ser publicado, para que 'storeAppend' não possa falhar.
+ *
+ * @param dataset Conjunto de dados (se 'dataset->stores[fileType]' for NULL, a função não faz nada).
+ * @param fileType Ficheiro pretendido (DIET ou MEAL_PLAN).
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não houver memória (o armazenamento fica inalterado).
+ */
+int storeReserve(Dataset *dataset, FileType fileType);
+
+/**
+ * @brief Acrescenta um registo inserido à tabela em memória, depois de 'storeReserve'.
+ *
+ * @param store Ponteiro para o armazenamento (pode ser NULL).
+ * @param ID Identificador do paciente do registo.
+ * @param date Data do registo.
+ * @param position Posição do registo no array.
+ */
+void storeAppend(RowStore *store, int ID, Date date, int position);
+
+/**
+ * @brief Devolve as posições dos registos de um paciente com data no período, pela ordem do array.
+ *
+ * @param store Ponteiro para o armazenamento.
+ * @param ID Identificador do paciente.
+ * @param period Período pretendido.
+ * @param limit Número de registos do array visíveis para quem consulta; as posições a partir desta são ignoradas.
+ * @param positions Recebe um array novo com as posições, que deve ser libertado com 'memFree'.
+ *
+ * @return Retorna o número de posições, ou -1 se não houver memória.
+ */
+int storeLookup(RowStore *store, int ID, Period period, int limit, int **positions);
+
+/**
+ * @brief Devolve a forma atual do armazenamento, usada pelo planeador para estimar o custo de uma consulta.
+ *
+ * @param store Ponteiro para o armazenamento.
+ * @param segments Recebe o número de segmentos.
+ * @param memtableRows Recebe o número de registos na tabela em memória.
+ */
+void storeShape(RowStore *store, int *segments, int *memtableRows);
+
+/**
+ * @brief Imprime o número de segmentos, os registos de cada um, os registos na tabela em memória e o número de
+ *        compactações.
+ *
+ * @param store Ponteiro para o armazenamento (pode ser NULL).
+ * @param name Nome do ficheiro, usado no título.
+ */
+void printStoreStats(RowStore *store, const char *name);
+
+/**
+ * @brief Termina a thread de compactação e liberta a memória do armazenamento.
+ *
+ * @param store Ponteiro para o armazenamento (pode ser NULL).
+ */
+void freeRowStore(RowStore *store);
+
+#endif // ROWSTORE_H
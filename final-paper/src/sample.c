@@ -0,0 +1,399 @@
+#include "sample.h"
+#include "utils.h"
+#include "memtrack.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file sample.c
+ * @brief Implementação da amostra estratificada das dietas.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'sample.h'. Os estratos são guardados numa
+ * tabela de dispersão por (paciente, mês) com endereçamento aberto, e a amostra de cada estrato cresce por
+ * duplicação até à capacidade. As estimativas usam os estimadores habituais da amostragem estratificada: o
+ * total de um estrato é estimado por N/n vezes a soma da amostra, com variância N² (1 - n/N) s² / n, em que
+ * 's²' é a variância da amostra do estrato.
+ */
+
+// Colunas de que a amostra precisa
+#define SAMPLE_COLUMNS (COL_ID | COL_DATE | COL_MEAL | COL_CALORIES)
+
+// Limites da capacidade de cada estrato, para erros pedidos muito grandes ou muito pequenos
+#define MIN_STRATUM_ROWS 8
+#define MAX_STRATUM_ROWS 65536
+
+// Quantil da normal para um intervalo de confianca de 95%
+#define Z_95 1.96
+
+// Dieta guardada na amostra, apenas com as colunas usadas nas estimativas
+typedef struct {
+	Date date;
+	int calories;
+	char meal[50];
+} SampleRow;
+
+// Estrato: dietas de um paciente num mes. 'population' e o numero de dietas recebidas e 'count' as guardadas
+typedef struct {
+	int ID;
+	int month;
+	long population;
+	SampleRow *rows;
+	int count;
+	int allocated;
+} Stratum;
+
+struct DietSample {
+	Stratum *strata;
+	int mask;
+	int used;
+	int capacity;
+	long rows;
+	long population;
+	unsigned random;
+	int valid;
+	pthread_mutex_t lock;
+};
+
+// Total estimado de um paciente em 'estimateExceededCalories'
+typedef struct {
+	int ID;
+	double total;
+	double variance;
+} PatientTotal;
+
+static double errorTarget = 0;
+
+static int monthOf(Date date) {
+	return date.year * 12 + date.month - 1;
+}
+
+static unsigned hashStratum(int ID, int month) {
+	unsigned hash = (2166136261u ^ (unsigned)ID) * 16777619u;
+	return (hash ^ (unsigned)month) * 16777619u;
+}
+
+static unsigned nextRandom(DietSample *sample) {
+	sample->random ^= sample->random << 13;
+	sample->random ^= sample->random >> 17;
+	sample->random ^= sample->random << 5;
+	return sample->random;
+}
+
+// Devolve a posicao do estrato (ID, mes), ou a posicao vazia onde deve ser inserido
+static int findSlot(const Stratum *strata, int mask, int ID, int month) {
+	int slot = hashStratum(ID, month) & mask;
+
+	while (strata[slot].population != 0 && (strata[slot].ID != ID || strata[slot].month != month)) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+static int growTable(DietSample *sample) {
+	int size = sample->strata != NULL ? (sample->mask + 1) * 2 : 1024;
+	Stratum *strata = memCalloc(MEM_INDEX, size, sizeof(Stratum));
+
+	if (strata == NULL) {
+		return -1;
+	}
+	if (sample->strata != NULL) {
+		for (int i = 0; i <= sample->mask; i++) {
+			Stratum *stratum = &sample->strata[i];
+			if (stratum->population != 0) {
+				strata[findSlot(strata, size - 1, stratum->ID, stratum->month)] = *stratum;
+			}
+		}
+		memFree(sample->strata);
+	}
+	sample->strata = strata;
+	sample->mask = size - 1;
+	return 0;
+}
+
+static DietSample *createSample(int capacity) {
+	DietSample *sample = memCalloc(MEM_INDEX, 1, sizeof(DietSample));
+
+	if (sample == NULL || growTable(sample) != 0) {
+		memFree(sample);
+		return NULL;
+	}
+	sample->capacity = capacity;
+	sample->random = 2463534242u;
+	sample->valid = 1;
+	pthread_mutex_init(&sample->lock, NULL);
+	return sample;
+}
+
+// Amostragem de reservatorio: a dieta numero N do estrato substitui uma dieta ao acaso com probabilidade capacidade / N
+static int addRow(DietSample *sample, const Diet *diet) {
+	int month = monthOf(diet->date);
+
+	if ((sample->used + 1) * 2 > sample->mask + 1 && growTable(sample) != 0) {
+		return -1;
+	}
+	Stratum *stratum = &sample->strata[findSlot(sample->strata, sample->mask, diet->ID, month)];
+	long position = stratum->count;
+	if (stratum->count == sample->capacity) {
+		position = (((unsigned long)nextRandom(sample) << 32) | nextRandom(sample)) % (unsigned long)(stratum->population + 1);
+	} else if (stratum->count == stratum->allocated) {
+		int allocated = stratum->allocated > 0 ? stratum->allocated * 2 : 4;
+		if (allocated > sample->capacity) {
+			allocated = sample->capacity;
+		}
+		SampleRow *rows = memRealloc(MEM_INDEX, stratum->rows, sizeof(SampleRow) * allocated);
+		if (rows == NULL) {
+			return -1;
+		}
+		stratum->rows = rows;
+		stratum->allocated = allocated;
+	}
+
+	if (stratum->population == 0) {
+		stratum->ID = diet->ID;
+		stratum->month = month;
+		sample->used++;
+	}
+	stratum->population++;
+	sample->population++;
+	if (position < sample->capacity) {
+		SampleRow *row = &stratum->rows[position];
+		row->date = diet->date;
+		row->calories = diet->calories;
+		snprintf(row->meal, sizeof(row->meal), "%s", diet->meal);
+		if (position == stratum->count) {
+			stratum->count++;
+			sample->rows++;
+		}
+	}
+	return 0;
+}
+
+// Peso de cada dieta da amostra do estrato e fator da variancia do total: N² (1 - n/N) / n
+static double stratumWeight(const Stratum *stratum) {
+	return (double)stratum->population / stratum->count;
+}
+
+static double varianceFactor(const Stratum *stratum) {
+	double population = stratum->population, count = stratum->count;
+	return population * population * (1 - count / population) / count;
+}
+
+// Variancia de uma soma de 'count' valores com soma 'sum' e soma dos quadrados 'squares' (denominador n - 1)
+static double sampleVariance(double sum, double squares, int count) {
+	if (count < 2) {
+		return 0;
+	}
+	double variance = (squares - sum * sum / count) / (count - 1);
+	return variance > 0 ? variance : 0;
+}
+
+// Estratos que podem ter dietas no periodo: o mes tem de estar entre o mes do inicio e o do fim
+static int stratumInPeriod(const Stratum *stratum, Period period) {
+	return stratum->population != 0 && stratum->month >= monthOf(period.begin) && stratum->month <= monthOf(period.end);
+}
+
+static int comparePatientTotals(const void *first, const void *second) {
+	int a = ((const PatientTotal *)first)->ID, b = ((const PatientTotal *)second)->ID;
+	return (a > b) - (a < b);
+}
+
+void setSampleError(double error) {
+	errorTarget = error > 0 ? error : 0;
+}
+
+double sampleError(void) {
+	return errorTarget;
+}
+
+void buildDietSample(Dataset *dataset) {
+	freeDietSample(dataset->sample);
+	dataset->sample = NULL;
+	if (errorTarget <= 0 || (dataset->lazyFiles[DIET].parsed & SAMPLE_COLUMNS) != SAMPLE_COLUMNS) {
+		return;
+	}
+
+	// Coeficiente de variacao das calorias; sem dietas suficientes usa-se 1
+	double sum = 0, squares = 0, variation = 1;
+	int count = 0;
+	for (int row = 0; row < dataset->numDiets; row++) {
+		if (dataset->diets[row].ID != -1) {
+			sum += dataset->diets[row].calories;
+			squares += (double)dataset->diets[row].calories * dataset->diets[row].calories;
+			count++;
+		}
+	}
+	if (count > 1 && sum > 0) {
+		variation = sqrt(sampleVariance(sum, squares, count)) / (sum / count);
+	}
+	double rows = ceil(pow(Z_95 * variation / errorTarget, 2));
+	int capacity = rows < MIN_STRATUM_ROWS ? MIN_STRATUM_ROWS : rows > MAX_STRATUM_ROWS ? MAX_STRATUM_ROWS : (int)rows;
+
+	DietSample *sample = createSample(capacity);
+	for (int row = 0; sample != NULL && row < dataset->numDiets; row++) {
+		if (dataset->diets[row].ID != -1 && addRow(sample, &dataset->diets[row]) != 0) {
+			freeDietSample(sample);
+			sample = NULL;
+		}
+	}
+	dataset->sample = sample;
+}
+
+int sampleAdd(DietSample *sample, const Diet *diet) {
+	int status = 0;
+
+	if (sample == NULL) {
+		return 0;
+	}
+	pthread_mutex_lock(&sample->lock);
+	if (sample->valid && addRow(sample, diet) != 0) {
+		// Uma amostra sem a dieta daria estimativas enviesadas, por isso deixa de ser usada
+		sample->valid = 0;
+		status = -1;
+	}
+	pthread_mutex_unlock(&sample->lock);
+	return status;
+}
+
+int estimateExceededCalories(DietSample *sample, int calories, Period period, Estimate *estimate) {
+	if (sample == NULL) {
+		return -1;
+	}
+	pthread_mutex_lock(&sample->lock);
+	PatientTotal *totals = sample->valid ? memAlloc(MEM_QUERY, sizeof(PatientTotal) * (sample->used > 0 ? sample->used : 1)) : NULL;
+	if (totals == NULL) {
+		pthread_mutex_unlock(&sample->lock);
+		return -1;
+	}
+
+	// Total estimado de cada estrato do periodo, e a variancia desse total
+	int numTotals = 0;
+	*estimate = (Estimate){0};
+	for (int i = 0; i <= sample->mask; i++) {
+		const Stratum *stratum = &sample->strata[i];
+		if (!stratumInPeriod(stratum, period)) {
+			continue;
+		}
+		double sum = 0, squares = 0;
+		int matches = 0;
+		for (int j = 0; j < stratum->count; j++) {
+			if (dateInPeriod(stratum->rows[j].date, period) == 1) {
+				sum += stratum->rows[j].calories;
+				squares += (double)stratum->rows[j].calories * stratum->rows[j].calories;
+				matches++;
+			}
+		}
+		if (matches > 0) {
+			totals[numTotals++] = (PatientTotal){
+				.ID = stratum->ID,
+				.total = stratumWeight(stratum) * sum,
+				.variance = varianceFactor(stratum) * sampleVariance(sum, squares, stratum->count)
+			};
+			estimate->sampleRows += matches;
+		}
+	}
+	pthread_mutex_unlock(&sample->lock);
+
+	// Os estratos de cada paciente ficam seguidos. O limite inferior conta os pacientes cujo intervalo do total
+	// fica todo acima do limite de calorias, e o superior os pacientes cujo intervalo chega a ultrapassa-lo
+	qsort(totals, numTotals, sizeof(PatientTotal), comparePatientTotals);
+	for (int i = 0; i < numTotals;) {
+		double total = 0, variance = 0;
+		int ID = totals[i].ID;
+		for (; i < numTotals && totals[i].ID == ID; i++) {
+			total += totals[i].total;
+			variance += totals[i].variance;
+		}
+		double margin = Z_95 * sqrt(variance);
+		estimate->value += total > calories;
+		estimate->low += total - margin > calories;
+		estimate->high += total + margin > calories;
+	}
+	memFree(totals);
+	return 0;
+}
+
+int estimateAverageCalories(DietSample *sample, Period period, const char *mealType, int IDNum, Estimate *estimate) {
+	if (sample == NULL) {
+		return -1;
+	}
+	pthread_mutex_lock(&sample->lock);
+	if (!sample->valid) {
+		pthread_mutex_unlock(&sample->lock);
+		return -1;
+	}
+
+	// Primeira passagem: total de calorias e numero de refeicoes estimados, e a razao entre eles
+	double total = 0, meals = 0;
+	*estimate = (Estimate){0};
+	for (int i = 0; i <= sample->mask; i++) {
+		const Stratum *stratum = &sample->strata[i];
+		if (stratum->ID != IDNum || !stratumInPeriod(stratum, period)) {
+			continue;
+		}
+		for (int j = 0; j < stratum->count; j++) {
+			const SampleRow *row = &stratum->rows[j];
+			if (dateInPeriod(row->date, period) == 1 && !strcmp(row->meal, mealType)) {
+				total += stratumWeight(stratum) * row->calories;
+				meals += stratumWeight(stratum);
+				estimate->sampleRows++;
+			}
+		}
+	}
+	if (meals == 0) {
+		pthread_mutex_unlock(&sample->lock);
+		return 0;
+	}
+	double ratio = total / meals;
+
+	// Segunda passagem: variancia da razao pela linearizacao z = (calorias - media) nas refeicoes pedidas e 0 nas restantes
+	double variance = 0;
+	for (int i = 0; i <= sample->mask; i++) {
+		const Stratum *stratum = &sample->strata[i];
+		if (stratum->ID != IDNum || !stratumInPeriod(stratum, period)) {
+			continue;
+		}
+		double sum = 0, squares = 0;
+		for (int j = 0; j < stratum->count; j++) {
+			const SampleRow *row = &stratum->rows[j];
+			if (dateInPeriod(row->date, period) == 1 && !strcmp(row->meal, mealType)) {
+				sum += row->calories - ratio;
+				squares += (row->calories - ratio) * (row->calories - ratio);
+			}
+		}
+		variance += varianceFactor(stratum) * sampleVariance(sum, squares, stratum->count);
+	}
+	pthread_mutex_unlock(&sample->lock);
+
+	double margin = Z_95 * sqrt(variance) / meals;
+	estimate->value = ratio;
+	estimate->low = ratio - margin;
+	estimate->high = ratio + margin;
+	return 0;
+}
+
+void printSampleStats(DietSample *sample) {
+	if (sample == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&sample->lock);
+	printf("Amostra das dietas (erro pretendido %.1f%%):\n", errorTarget * 100);
+	printf("  Estratos (paciente, mes): %d, ate %d dietas por estrato\n", sample->used, sample->capacity);
+	printf("  Dietas na amostra: %ld de %ld%s\n", sample->rows, sample->population, sample->valid ? "" : " (desativada por falta de memoria)");
+	pthread_mutex_unlock(&sample->lock);
+}
+
+void freeDietSample(DietSample *sample) {
+	if (sample == NULL) {
+		return;
+	}
+	for (int i = 0; i <= sample->mask; i++) {
+		memFree(sample->strata[i].rows);
+	}
+	memFree(sample->strata);
+	pthread_mutex_destroy(&sample->lock);
+	memFree(sample);
+}
@@ -0,0 +1,111 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include "types.h"
+
+/**
+ * @file sample.h
+ * @brief Cabeçalho da amostra estratificada das dietas usada pelas respostas aproximadas.
+ *
+ * Este ficheiro de cabeçalho declara as funções do modo aproximado ('--approximate'), em que as opções 1 e 4
+ * respondem a partir de uma amostra das dietas em vez de percorrerem todos os registos:
+ * - As dietas são divididas em estratos, um por paciente e mês. Cada estrato guarda o número de dietas que
+ *   recebeu e uma amostra uniforme de até 'capacidade' dietas, mantida por amostragem de reservatório: a
+ *   dieta número N do estrato entra na amostra com probabilidade capacidade / N, no lugar de uma dieta ao
+ *   acaso. A amostra é construída no carregamento e atualizada por cada dieta inserida.
+ * - A capacidade é escolhida a partir do erro pretendido: é o número de dietas que dá à média de um estrato
+ *   um erro relativo igual ao pedido, com 95% de confiança, calculado com o coeficiente de variação das
+ *   calorias de todas as dietas carregadas. Os estratos com menos dietas do que a capacidade ficam completos
+ *   e as respostas que só dependem deles são exatas.
+ * - Cada resposta é estimada somando os estratos, cada um pesado pelo número de dietas que representa, e vem
+ *   com um intervalo de confiança de 95% calculado a partir da variância dentro de cada estrato.
+ *
+ * Se não houver memória para a amostra (ou se o orçamento dos índices for ultrapassado), a amostra deixa de
+ * ser usada e as consultas voltam a ser exatas.
+ */
+
+/**
+ * @brief Define o erro relativo pretendido para as respostas aproximadas.
+ *
+ * @param error Erro relativo (ex: 0.05 para 5%), ou 0 para desligar o modo aproximado.
+ */
+void setSampleError(double error);
+
+/**
+ * @brief Devolve o erro relativo pretendido para as respostas aproximadas.
+ *
+ * @return Retorna o erro relativo, ou 0 se o modo aproximado estiver desligado.
+ */
+double sampleError(void);
+
+/**
+ * @brief Constrói a amostra das dietas a partir dos registos já interpretados, substituindo a anterior.
+ *
+ * A amostra só é construída com o modo aproximado ligado e com as colunas ID, data, refeição e calorias
+ * interpretadas; caso contrário, ou se não houver memória, 'dataset->sample' fica a NULL.
+ *
+ * @param dataset Conjunto de dados carregado.
+ */
+void buildDietSample(Dataset *dataset);
+
+/**
+ * @brief Acrescenta uma dieta à amostra.
+ *
+ * Pode ser chamada enquanto outras threads fazem estimativas sobre a mesma amostra.
+ *
+ * @param sample Ponteiro para a amostra (pode ser NULL).
+ * @param diet Dieta a acrescentar.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não houver memória (a amostra deixa de ser usada).
+ */
+int sampleAdd(DietSample *sample, const Diet *diet);
+
+/**
+ * @brief Estima o número de pacientes cujo total de calorias no período excede um limite.
+ *
+ * O total de cada paciente é estimado a partir dos seus estratos, com um intervalo de confiança de 95%. O valor
+ * estimado conta os pacientes cujo total estimado excede o limite; o intervalo vai do número de pacientes cujo
+ * intervalo fica todo acima do limite ao número de pacientes cujo intervalo o ultrapassa. Quando o erro da
+ * amostra é grande face à distância dos totais ao limite, o intervalo alarga-se em vez de a estimativa ficar
+ * enviesada.
+ *
+ * @param sample Ponteiro para a amostra (pode ser NULL).
+ * @param calories Limite de calorias.
+ * @param period Período avaliado.
+ * @param estimate Estrutura onde a estimativa é escrita.
+ *
+ * @return Retorna 0 em caso de sucesso, ou -1 se não houver amostra utilizável ou memória.
+ */
+int estimateExceededCalories(DietSample *sample, int calories, Period period, Estimate *estimate);
+
+/**
+ * @brief Estima a média de calorias de um paciente numa refeição durante um período.
+ *
+ * A média é estimada como a razão entre o total estimado de calorias e o número estimado de refeições, e o
+ * intervalo de confiança é obtido linearizando essa razão.
+ *
+ * @param sample Ponteiro para a amostra (pode ser NULL).
+ * @param period Período avaliado.
+ * @param mealType Refeição pretendida.
+ * @param IDNum Identificador do paciente.
+ * @param estimate Estrutura onde a estimativa é escrita (valor 0 se não houver refeições correspondentes).
+ *
+ * @return Retorna 0 em caso de sucesso, ou -1 se não houver amostra utilizável.
+ */
+int estimateAverageCalories(DietSample *sample, Period period, const char *mealType, int IDNum, Estimate *estimate);
+
+/**
+ * @brief Imprime o tamanho da amostra: estratos, dietas guardadas e dietas representadas.
+ *
+ * @param sample Ponteiro para a amostra (pode ser NULL).
+ */
+void printSampleStats(DietSample *sample);
+
+/**
+ * @brief Liberta a memória de uma amostra.
+ *
+ * @param sample Ponteiro para a amostra (pode ser NULL).
+ */
+void freeDietSample(DietSample *sample);
+
+#endif // SAMPLE_H
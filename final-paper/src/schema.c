@@ -0,0 +1,181 @@
+#include "schema.h"
+#include "stream.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file schema.c
+ * @brief Implementação das funções geradas a partir da descrição de cada tipo de registo.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'schema.h'. A macro DEFINE_RECORD expande a
+ * descrição de um tipo em quatro funções especializadas: a inicialização, a leitura de uma linha, o ciclo de
+ * leitura de um ficheiro e a escrita de uma linha. Cada campo é tratado pelas macros PARSE_, FORMAT_ e INIT_
+ * do seu formato, pelo que o código gerado para um tipo é uma sequência fixa de operações, sem escolhas por
+ * campo. No ciclo de leitura as colunas pedidas são sempre COL_ALL, e o compilador elimina os testes de coluna.
+ */
+
+// Avanca para o inicio do campo seguinte; devolve NULL se a linha terminar antes do separador
+static inline const char *nextField(const char *cursor, char delimiter) {
+	while (*cursor != delimiter) {
+		if (*cursor == '\0') {
+			return NULL;
+		}
+		cursor++;
+	}
+	return cursor + 1;
+}
+
+// Como '%d': o valor so e alterado se o campo comecar por um numero
+static inline void parseInt(const char *cursor, int *value) {
+	char *end;
+	long number = strtol(cursor, &end, 10);
+	if (end != cursor) {
+		*value = number;
+	}
+}
+
+static inline void parseDate(const char *cursor, Date *date) {
+	char *end;
+
+	date->day = strtol(cursor, &end, 10);
+	date->month = *end == '-' ? strtol(end + 1, &end, 10) : 0;
+	date->year = *end == '-' ? strtol(end + 1, &end, 10) : 0;
+}
+
+// Como '%49[^;]', opcionalmente precedido de ' ' para saltar os espacos iniciais
+static inline void parseText(const char *cursor, char delimiter, char *text, size_t size, int skipSpaces) {
+	size_t length = 0;
+
+	while (skipSpaces && (*cursor == ' ' || *cursor == '\t')) {
+		cursor++;
+	}
+	while (cursor[length] != delimiter && cursor[length] != '\0' && length < size - 1) {
+		length++;
+	}
+	memcpy(text, cursor, length);
+	text[length] = '\0';
+}
+
+// Acrescenta texto formatado a 'buffer', contando sempre o comprimento completo como 'snprintf'
+static void appendFormat(char *buffer, size_t size, size_t *length, const char *format, ...) {
+	va_list args;
+
+	va_start(args, format);
+	int written = vsnprintf(*length < size ? buffer + *length : NULL, *length < size ? size - *length : 0, format, args);
+	va_end(args);
+	*length += written > 0 ? written : 0;
+}
+
+#define PARSE_ID(field, delimiter) parseInt(cursor, &(field))
+#define PARSE_INT(field, delimiter) parseInt(cursor, &(field))
+#define PARSE_DATE(field, delimiter) parseDate(cursor, &(field))
+#define PARSE_TEXT(field, delimiter) parseText(cursor, delimiter, field, sizeof(field), 1)
+#define PARSE_RAW(field, delimiter) parseText(cursor, delimiter, field, sizeof(field), 0)
+
+#define FORMAT_ID(field) appendFormat(buffer, size, &length, "%04d", field)
+#define FORMAT_INT(field) appendFormat(buffer, size, &length, "%d", field)
+#define FORMAT_DATE(field) appendFormat(buffer, size, &length, "%02d-%02d-%04d", (field).day, (field).month, (field).year)
+#define FORMAT_TEXT(field) appendFormat(buffer, size, &length, "%s", field)
+#define FORMAT_RAW(field) appendFormat(buffer, size, &length, "%s", field)
+
+#define INIT_ID(field) (field) = -1
+#define INIT_INT(field) (field) = 0
+#define INIT_DATE(field) (field) = (Date){0}
+#define INIT_TEXT(field) (field)[0] = '\0'
+#define INIT_RAW(field) (field)[0] = '\0'
+
+// Cada campo usa as variaveis 'row', 'cursor', 'columns', 'buffer', 'size' e 'length' da funcao gerada
+#define PARSE_FIELD(type, member, kind, column, delimiter, suffix) \
+	if (columns & (column)) { \
+		PARSE_##kind(row->member, delimiter); \
+	} \
+	if ((cursor = nextField(cursor, delimiter)) == NULL) { \
+		return; \
+	}
+
+#define FORMAT_FIELD(type, member, kind, column, delimiter, suffix) \
+	FORMAT_##kind(row->member); \
+	appendFormat(buffer, size, &length, "%s", suffix);
+
+#define INIT_FIELD(type, member, kind, column, delimiter, suffix) \
+	INIT_##kind(row->member);
+
+#define DEFINE_RECORD(Type, Plural, SCHEMA) \
+	void initialize##Plural(Type rows[], int count) { \
+		Type empty, *row = &empty; \
+		memset(&empty, 0, sizeof(empty)); \
+		SCHEMA(INIT_FIELD) \
+		for (int i = 0; i < count; i++) { \
+			rows[i] = empty; \
+		} \
+	} \
+	\
+	static inline void parse##Type##Line(const char *cursor, Type *row, unsigned columns) { \
+		SCHEMA(PARSE_FIELD) \
+	} \
+	\
+	static int read##Plural##File(InputStream *file, Type *rows, int max_size) { \
+		char line[500]; \
+		int i; \
+		for (i = 0; i < max_size && readInputLine(file, line, sizeof(line)); i++) { \
+			parse##Type##Line(line, &rows[i], COL_ALL); \
+		} \
+		return i; \
+	} \
+	\
+	static size_t format##Type##Line(char *buffer, size_t size, const Type *row) { \
+		size_t length = 0; \
+		SCHEMA(FORMAT_FIELD) \
+		return length; \
+	}
+
+DEFINE_RECORD(Patients, Patients, PATIENTS_SCHEMA)
+DEFINE_RECORD(Diet, Diets, DIET_SCHEMA)
+DEFINE_RECORD(MealPlan, MealPlans, MEAL_PLAN_SCHEMA)
+
+int parseRecord(const char *line, void *rows, int i, FileType fileType, unsigned columns) {
+	switch (fileType) {
+		case PATIENTS:
+			parsePatientsLine(line, (Patients *)rows + i, columns);
+			return 1;
+		case DIET:
+			parseDietLine(line, (Diet *)rows + i, columns);
+			return 1;
+		case MEAL_PLAN:
+			parseMealPlanLine(line, (MealPlan *)rows + i, columns);
+			return 1;
+	}
+	printf("Tipo de ficheiro nao suportado.\n");
+	return 0;
+}
+
+int readRecords(InputStream *file, void *rows, int max_size, FileType fileType) {
+	switch (fileType) {
+		case PATIENTS:
+			return readPatientsFile(file, rows, max_size);
+		case DIET:
+			return readDietsFile(file, rows, max_size);
+		case MEAL_PLAN:
+			return readMealPlansFile(file, rows, max_size);
+	}
+	printf("Tipo de ficheiro nao suportado.\n");
+	return 0;
+}
+
+size_t formatRecord(char *buffer, size_t size, const void *row, FileType fileType) {
+	if (size > 0) {
+		buffer[0] = '\0';
+	}
+	switch (fileType) {
+		case PATIENTS:
+			return formatPatientsLine(buffer, size, row);
+		case DIET:
+			return formatDietLine(buffer, size, row);
+		case MEAL_PLAN:
+			return formatMealPlanLine(buffer, size, row);
+	}
+	return 0;
+}
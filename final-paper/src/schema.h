@@ -0,0 +1,125 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include "types.h"
+
+#include <stddef.h>
+
+/**
+ * @file schema.h
+ * @brief Cabeçalho com a descrição, campo a campo, de cada tipo de registo dos ficheiros de dados.
+ *
+ * Cada tipo de registo é descrito uma única vez por uma macro X (X-macro) com uma linha por campo, pela ordem
+ * em que os campos aparecem na linha do ficheiro. A partir dessa descrição, 'schema.c' gera para cada tipo a
+ * inicialização, a leitura de uma linha, o ciclo de leitura de um ficheiro e a escrita de uma linha, pelo que
+ * acrescentar um campo a um registo só exige alterar a estrutura em 'types.h' e a linha correspondente aqui.
+ *
+ * Cada linha da descrição tem a forma X(tipo, membro, formato, coluna, separador, sufixo):
+ * - 'formato' é o tipo do campo no ficheiro: ID (inteiro escrito com 4 algarismos, -1 num registo vazio), INT
+ *   (inteiro), DATE (data dd-mm-aaaa), TEXT (texto sem os espaços iniciais) ou RAW (texto tal como está no ficheiro).
+ * - 'coluna' é o valor de 'Column' do campo, usado pelo modo preguiçoso para interpretar apenas algumas colunas.
+ * - 'separador' é o carácter que termina o campo na linha.
+ * - 'sufixo' é o texto escrito depois do valor do campo (ex: " cal\n" no último campo das dietas).
+ *
+ * @note Este ficheiro depende das definições das estruturas de dados em 'types.h'.
+ */
+
+/**
+ * @brief Descrição de uma linha de 'patients.txt' (ex: "0001;Paulo;123456789").
+ */
+#define PATIENTS_SCHEMA(X) \
+        X(Patients, ID, ID, COL_ID, ';', ";") \
+        X(Patients, name, TEXT, COL_NAME, ';', ";") \
+        X(Patients, phoneNumber, INT, COL_PHONE, '\n', "\n")
+
+/**
+ * @brief Descrição de uma linha de 'diet.txt' (ex: "0001; 01-01-2023; pequeno almoco; pao; 60 cal").
+ *
+ * Os alimentos são guardados com o espaço que se segue ao ';', tal como sempre foram lidos.
+ */
+#define DIET_SCHEMA(X) \
+        X(Diet, ID, ID, COL_ID, ';', "; ") \
+        X(Diet, date, DATE, COL_DATE, ';', "; ") \
+        X(Diet, meal, TEXT, COL_MEAL, ';', "; ") \
+        X(Diet, food, RAW, COL_FOOD, ';', "; ") \
+        X(Diet, calories, INT, COL_CALORIES, '\n', " cal\n")
+
+/**
+ * @brief Descrição de uma linha de 'mealPlan.txt' (ex: "0001; 01-01-2023; jantar; 500 Cal, 600 Cal").
+ */
+#define MEAL_PLAN_SCHEMA(X) \
+        X(MealPlan, ID, ID, COL_ID, ';', "; ") \
+        X(MealPlan, date, DATE, COL_DATE, ';', "; ") \
+        X(MealPlan, meal, TEXT, COL_MEAL, ';', "; ") \
+        X(MealPlan, minCal, INT, COL_LIMITS, ',', " Cal, ") \
+        X(MealPlan, maxCal, INT, COL_LIMITS, '\n', " Cal\n")
+
+/**
+ * @brief Inicializa um array de Diet com valores padrão (ID -1, restantes campos a zero ou vazios).
+ *
+ * @param diets Array de estruturas Diet a ser inicializado.
+ * @param size Tamanho do array a ser inicializado.
+ */
+void initializeDiets(Diet diets[], int size);
+
+/**
+ * @brief Inicializa um array de Patients com valores padrão (ID -1, restantes campos a zero ou vazios).
+ *
+ * @param patients Array de estruturas Patients a ser inicializado.
+ * @param size Tamanho do array a ser inicializado.
+ */
+void initializePatients(Patients patients[], int size);
+
+/**
+ * @brief Inicializa um array de MealPlan com valores padrão (ID -1, restantes campos a zero ou vazios).
+ *
+ * @param mealPlans Array de estruturas MealPlan a ser inicializado.
+ * @param size Tamanho do array a ser inicializado.
+ */
+void initializeMealPlans(MealPlan mealPlans[], int size);
+
+/**
+ * @brief Interpreta algumas colunas de uma linha e guarda-as na posição indicada de um array de registos.
+ *
+ * Os campos cuja coluna não está em 'columns' são saltados sem serem interpretados e mantêm o valor anterior.
+ * Se a linha terminar antes de um campo, esse campo e os seguintes também mantêm o valor anterior.
+ *
+ * @param line Linha de texto, terminada em '\n' ou em '\0'.
+ * @param rows Ponteiro para o array de registos do tipo correspondente a 'fileType'.
+ * @param i Posição do array onde o registo é guardado.
+ * @param fileType Tipo de registo contido na linha.
+ * @param columns Máscara de bits ('Column') das colunas a interpretar.
+ *
+ * @return Retorna 1 se o tipo de ficheiro é suportado, ou 0 caso contrário.
+ */
+int parseRecord(const char *line, void *rows, int i, FileType fileType, unsigned columns);
+
+/**
+ * @brief Lê as linhas de um ficheiro de dados para um array de registos.
+ *
+ * O tipo é escolhido uma única vez por ficheiro; cada linha é depois interpretada pelo ciclo gerado para esse
+ * tipo, sem voltar a escolher o formato a cada linha.
+ *
+ * @param file Ficheiro de dados aberto com 'openInputStream'.
+ * @param rows Ponteiro para o array de registos do tipo correspondente a 'fileType'.
+ * @param max_size Número máximo de registos a ler.
+ * @param fileType Tipo dos registos do ficheiro.
+ *
+ * @return Retorna o número de linhas lidas, ou 0 se o tipo de ficheiro não for suportado.
+ */
+int readRecords(InputStream *file, void *rows, int max_size, FileType fileType);
+
+/**
+ * @brief Escreve um registo como uma linha no formato do seu ficheiro de dados, terminada em '\n'.
+ *
+ * @param buffer Buffer onde a linha é escrita (sempre terminada em '\0' se 'size' for maior que 0).
+ * @param size Tamanho do buffer.
+ * @param row Ponteiro para o registo do tipo correspondente a 'fileType'.
+ * @param fileType Tipo do registo.
+ *
+ * @return Retorna o comprimento da linha completa, como 'snprintf'; se for maior ou igual a 'size', a linha
+ *         foi truncada.
+ */
+size_t formatRecord(char *buffer, size_t size, const void *row, FileType fileType);
+
+#endif // SCHEMA_H
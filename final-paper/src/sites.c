@@ -0,0 +1,246 @@
+#include "sites.h"
+#include "logic.h"
+#include "memtrack.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file sites.c
+ * @brief Implementação das consultas sobre conjuntos de dados com vários locais.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'sites.h'. As consultas por local
+ * trabalham diretamente sobre a parte contígua dos arrays do 'Dataset' que pertence a cada local,
+ * sem copiar registos.
+ */
+
+// Trabalho de uma thread: uma consulta sobre os registos de um local
+typedef struct {
+	const Dataset *dataset;
+	int site;
+	int calories;
+	Period period;
+	RankCriterion criterion;
+	int k;
+	int result;
+	int *IDs;
+	RankedPatient *ranked;
+	pthread_t thread;
+	int started;
+} SiteQuery;
+
+// Intervalo de registos de um ficheiro que pertence ao local 'site' (o conjunto inteiro se nao houver locais)
+static void siteRows(const Dataset *dataset, int site, FileType fileType, int *first, int *count) {
+	int totals[] = {dataset->numPatients, dataset->numDiets, dataset->numMealPlans};
+
+	*first = 0;
+	*count = totals[fileType];
+	if (dataset->numSites == 0) {
+		return;
+	}
+	if (site < 0 || site >= dataset->numSites) {
+		*count = 0;
+		return;
+	}
+
+	const SiteRange *range = &dataset->sites[site];
+	switch (fileType) {
+		case PATIENTS:
+			*first = range->firstPatient;
+			*count = range->numPatients;
+			break;
+		case DIET:
+			*first = range->firstDiet;
+			*count = range->numDiets;
+			break;
+		case MEAL_PLAN:
+			*first = range->firstMealPlan;
+			*count = range->numMealPlans;
+			break;
+	}
+}
+
+void patientSlice(const Dataset *dataset, int ID, FileType fileType, int *first, int *count) {
+	siteRows(dataset, ID >= 0 ? ID / SITE_ID_PREFIX - 1 : -1, fileType, first, count);
+}
+
+// Cria uma consulta por local; sem varios locais ha uma unica consulta sobre o conjunto inteiro
+static SiteQuery *siteQueries(const Dataset *dataset, SiteQuery query, int *sites) {
+	*sites = dataset->numSites > 0 ? dataset->numSites : 1;
+	SiteQuery *queries = memAlloc(MEM_QUERY, sizeof(SiteQuery) * *sites);
+	if (queries == NULL) {
+		return NULL;
+	}
+	for (int i = 0; i < *sites; i++) {
+		queries[i] = query;
+		queries[i].dataset = dataset;
+		queries[i].site = i;
+	}
+	return queries;
+}
+
+// Executa 'task' sobre cada local, um por thread; um local sem thread e executado na thread atual
+static void runSites(SiteQuery *queries, int sites, void *(*task)(void *)) {
+	for (int i = 0; i < sites; i++) {
+		queries[i].started = pthread_create(&queries[i].thread, NULL, task, &queries[i]) == 0;
+		if (!queries[i].started) {
+			task(&queries[i]);
+		}
+	}
+	for (int i = 0; i < sites; i++) {
+		if (queries[i].started) {
+			pthread_join(queries[i].thread, NULL);
+		}
+	}
+}
+
+static void *siteExceededCalories(void *arg) {
+	SiteQuery *query = (SiteQuery *)arg;
+	int first, count;
+
+	siteRows(query->dataset, query->site, DIET, &first, &count);
+	query->result = exceededCalories(query->dataset->diets + first, count, query->calories, query->period);
+	return NULL;
+}
+
+int parallelExceededCalories(const Dataset *dataset, int calories, Period period) {
+	int sites, total = 0;
+	SiteQuery *queries = siteQueries(dataset, (SiteQuery){.calories = calories, .period = period}, &sites);
+
+	if (queries == NULL) {
+		return -1;
+	}
+	runSites(queries, sites, siteExceededCalories);
+
+	// Os pacientes de cada local sao distintos, logo os resultados parciais somam-se
+	for (int i = 0; i < sites; i++) {
+		if (queries[i].result < 0 || total < 0) {
+			total = -1;
+		} else {
+			total += queries[i].result;
+		}
+	}
+
+	memFree(queries);
+	return total;
+}
+
+static void *siteOutOfRange(void *arg) {
+	SiteQuery *query = (SiteQuery *)arg;
+	int firstDiet, numDiets, firstPlan, numPlans;
+
+	siteRows(query->dataset, query->site, DIET, &firstDiet, &numDiets);
+	siteRows(query->dataset, query->site, MEAL_PLAN, &firstPlan, &numPlans);
+	query->result = outOfRangeIDs(query->dataset->diets + firstDiet, query->dataset->mealPlans + firstPlan, query->period, numDiets, numPlans, &query->IDs);
+	return NULL;
+}
+
+int parallelOutOfRange(const Dataset *dataset, Period period) {
+	int sites, total = 0;
+	SiteQuery *queries = siteQueries(dataset, (SiteQuery){.period = period, .IDs = NULL}, &sites);
+
+	printf("IDs fora do intervalo de calorias no período definido:\n");
+	if (queries == NULL) {
+		printf("Memoria insuficiente.\n");
+		return 0;
+	}
+	runSites(queries, sites, siteOutOfRange);
+
+	for (int i = 0; i < sites; i++) {
+		if (queries[i].result < 0) {
+			total = -1;
+		}
+	}
+	// Cada local devolve os seus IDs por ordem decrescente e os prefixos crescem com o local,
+	// por isso basta juntar as listas do ultimo local para o primeiro
+	for (int i = sites - 1; i >= 0; i--) {
+		for (int row = 0; total >= 0 && row < queries[i].result; row++) {
+			printf("%d\n", queries[i].IDs[row]);
+		}
+		if (total >= 0) {
+			total += queries[i].result;
+		}
+		memFree(queries[i].IDs);
+	}
+	if (total < 0) {
+		printf("Memoria insuficiente.\n");
+		total = 0;
+	}
+
+	memFree(queries);
+	return total;
+}
+
+static void *siteRankPatients(void *arg) {
+	SiteQuery *query = (SiteQuery *)arg;
+	int firstDiet, numDiets, firstPlan, numPlans;
+
+	siteRows(query->dataset, query->site, DIET, &firstDiet, &numDiets);
+	siteRows(query->dataset, query->site, MEAL_PLAN, &firstPlan, &numPlans);
+	query->result = rankPatients(query->dataset->diets + firstDiet, numDiets, query->dataset->mealPlans + firstPlan, numPlans,
+		query->period, query->criterion, query->calories, query->k, &query->ranked);
+	return NULL;
+}
+
+// Mesma ordem que 'rankPatients': pontuacao decrescente e, em caso de empate, ID crescente
+static int compareRanked(const void *a, const void *b) {
+	const RankedPatient *first = (const RankedPatient *)a, *second = (const RankedPatient *)b;
+
+	if (first->score != second->score) {
+		return first->score < second->score ? 1 : -1;
+	}
+	return (first->ID > second->ID) - (first->ID < second->ID);
+}
+
+int parallelTopPatients(const Dataset *dataset, Period period, RankCriterion criterion, int calories, int k) {
+	if (k < 1) {
+		return 0;
+	}
+
+	int sites, total = 0;
+	SiteQuery *queries = siteQueries(dataset, (SiteQuery){.period = period, .criterion = criterion, .calories = calories, .k = k, .ranked = NULL}, &sites);
+
+	printf("Top %d pacientes:\n", k);
+	if (queries == NULL) {
+		printf("Memoria insuficiente.\n");
+		return -1;
+	}
+	runSites(queries, sites, siteRankPatients);
+
+	// O top-K global esta contido na uniao dos top-K de cada local, porque os pacientes dos locais sao distintos
+	for (int i = 0; i < sites; i++) {
+		total = queries[i].result < 0 || total < 0 ? -1 : total + queries[i].result;
+	}
+	RankedPatient *merged = total >= 0 ? memAlloc(MEM_QUERY, sizeof(RankedPatient) * (total > 0 ? total : 1)) : NULL;
+	if (merged != NULL) {
+		int count = 0;
+		for (int i = 0; i < sites; i++) {
+			if (queries[i].result > 0) {
+				memcpy(merged + count, queries[i].ranked, sizeof(RankedPatient) * queries[i].result);
+				count += queries[i].result;
+			}
+		}
+		qsort(merged, count, sizeof(RankedPatient), compareRanked);
+		total = count < k ? count : k;
+		printRanking(merged, total, criterion);
+	} else {
+		printf("Memoria insuficiente.\n");
+		total = -1;
+	}
+
+	for (int i = 0; i < sites; i++) {
+		memFree(queries[i].ranked);
+	}
+	memFree(merged);
+	memFree(queries);
+	return total;
+}
+
+void printSites(const Dataset *dataset) {
+	for (int i = 0; i < dataset->numSites; i++) {
+		const SiteRange *range = &dataset->sites[i];
+		printf("Local %d (%s): IDs %d-%d, Pacientes: %d, Dietas: %d, Planos: %d\n", i + 1, range->directory, range->prefix, range->prefix + SITE_ID_PREFIX - 1, range->numPatients, range->numDiets, range->numMealPlans);
+	}
+}
@@ -0,0 +1,87 @@
+#ifndef SITES_H
+#define SITES_H
+
+#include "types.h"
+
+/**
+ * @file sites.h
+ * @brief Cabeçalho das consultas sobre conjuntos de dados com vários locais.
+ *
+ * Este ficheiro de cabeçalho declara as funções que tiram partido da divisão do conjunto de dados em locais
+ * (ver 'loadSites'). Como os IDs de pacientes de locais diferentes nunca coincidem, uma consulta sobre um
+ * paciente só precisa de percorrer os registos do seu local, e uma consulta sobre todos os pacientes pode ser
+ * executada em paralelo, um local por thread, juntando no fim os resultados parciais. Isto é feito para as
+ * opções 1, 2 e 7 do menu. A opção 5 imprime todos os registos pela ordem da tabela, sem nada para agregar,
+ * e a opção 10 já divide as dietas do período (obtidas pelo índice por data) entre várias threads e funde os
+ * resumos parciais, o que evita percorrer as dietas de cada local fora do período.
+ *
+ * @note Com uma única diretoria de dados ('dataset->numSites' igual a 0) as funções tratam o conjunto de
+ *       dados inteiro como um único local.
+ */
+
+/**
+ * @brief Devolve o intervalo de registos de um ficheiro que pode conter um paciente.
+ *
+ * @param dataset Conjunto de dados carregado.
+ * @param ID Identificador do paciente (já com o prefixo do local).
+ * @param fileType Ficheiro pretendido (PATIENTS, DIET ou MEAL_PLAN).
+ * @param first Recebe a posição do primeiro registo do intervalo.
+ * @param count Recebe o número de registos do intervalo (0 se o prefixo não corresponder a nenhum local).
+ */
+void patientSlice(const Dataset *dataset, int ID, FileType fileType, int *first, int *count);
+
+/**
+ * @brief Calcula o número de pacientes que excederam um limite de calorias, executando cada local em paralelo.
+ *
+ * Cada thread aplica 'exceededCalories' às dietas de um local. Como os pacientes de locais diferentes são
+ * distintos, o resultado é a soma dos resultados parciais.
+ *
+ * @param dataset Conjunto de dados carregado com 'loadSites'.
+ * @param calories Limite de calorias.
+ * @param period Estrutura 'Period' que define o período avaliado.
+ *
+ * @return Retorna o número de pacientes que excederam o limite, ou -1 se não houver memória.
+ *
+ * @note Um local cuja thread não possa ser criada é consultado na thread que chamou a função.
+ */
+int parallelExceededCalories(const Dataset *dataset, int calories, Period period);
+
+/**
+ * @brief Versão de 'outOfRange' que executa cada local em paralelo.
+ *
+ * Cada thread aplica 'outOfRangeIDs' às dietas e aos planos de um local. Os IDs de cada local vêm por ordem
+ * decrescente e os locais seguintes têm prefixos maiores, pelo que as listas são impressas do último local
+ * para o primeiro, pela mesma ordem que 'outOfRange' usaria sobre o conjunto inteiro.
+ *
+ * @param dataset Conjunto de dados carregado com 'loadSites'.
+ * @param period Estrutura 'Period' que define o período avaliado.
+ *
+ * @return Retorna o número de pacientes listados, ou 0 se não houver memória.
+ */
+int parallelOutOfRange(const Dataset *dataset, Period period);
+
+/**
+ * @brief Versão de 'topPatients' que executa cada local em paralelo.
+ *
+ * Cada thread calcula com 'rankPatients' os 'k' melhores pacientes do seu local. Como os pacientes de locais
+ * diferentes são distintos, os 'k' melhores do conjunto estão entre os 'k' melhores de algum local: as listas
+ * parciais são juntadas, ordenadas e cortadas em 'k'.
+ *
+ * @param dataset Conjunto de dados carregado com 'loadSites'.
+ * @param period Estrutura 'Period' que define o período avaliado.
+ * @param criterion Critério de classificação.
+ * @param calories Limite de calorias usado por RANK_EXCESS.
+ * @param k Número máximo de pacientes a apresentar.
+ *
+ * @return Retorna o número de pacientes listados, ou -1 se não houver memória.
+ */
+int parallelTopPatients(const Dataset *dataset, Period period, RankCriterion criterion, int calories, int k);
+
+/**
+ * @brief Imprime a lista de locais carregados e o número de registos de cada um.
+ *
+ * @param dataset Conjunto de dados carregado.
+ */
+void printSites(const Dataset *dataset);
+
+#endif // SITES_H
@@ -0,0 +1,233 @@
+#include "sketch.h"
+#include "memtrack.h"
+
+#include <stdlib.h>
+
+/**
+ * @file sketch.c
+ * @brief Implementação do resumo (sketch) de quantis aproximados.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'sketch.h'. Cada nível é um array de
+ * valores; um valor no nível h representa 2^h registos. A compactação de um nível mantém o peso total: de
+ * cada par de valores consecutivos (depois de ordenados) sobe um, com o dobro do peso, e um valor sem par
+ * fica no nível onde estava.
+ */
+
+#define MAX_LEVELS 40
+
+// Erro normalizado da posicao para SKETCH_K = 200, com 99% de confianca
+#define SKETCH_RANK_ERROR 0.0133
+
+struct QuantileSketch {
+	int *levels[MAX_LEVELS];
+	int sizes[MAX_LEVELS];
+	int allocated[MAX_LEVELS];
+	int numLevels;
+	int size;
+	int capacity;
+	long count;
+	int min;
+	int max;
+	unsigned random;
+	int compacted;
+};
+
+// Valor do resumo com o numero de registos que representa, usado para responder a um quantil
+typedef struct {
+	int value;
+	long weight;
+} WeightedValue;
+
+static int compareInts(const void *a, const void *b) {
+	int first = *(const int *)a;
+	int second = *(const int *)b;
+	return (first > second) - (first < second);
+}
+
+static int compareWeightedValues(const void *a, const void *b) {
+	const WeightedValue *first = (const WeightedValue *)a;
+	const WeightedValue *second = (const WeightedValue *)b;
+	return (first->value > second->value) - (first->value < second->value);
+}
+
+static int levelCapacity(const QuantileSketch *sketch, int level) {
+	int capacity = SKETCH_K;
+
+	for (int depth = sketch->numLevels - 1 - level; depth > 0 && capacity > 2; depth--) {
+		capacity = (capacity * 2 + 2) / 3;
+	}
+	return capacity > 2 ? capacity : 2;
+}
+
+// A capacidade total so muda quando o numero de niveis muda, por isso e calculada apenas nesse momento
+static void setLevels(QuantileSketch *sketch, int numLevels) {
+	sketch->numLevels = numLevels;
+	sketch->capacity = 0;
+	for (int level = 0; level < numLevels; level++) {
+		sketch->capacity += levelCapacity(sketch, level);
+	}
+}
+
+static int appendValue(QuantileSketch *sketch, int level, int value) {
+	if (sketch->sizes[level] == sketch->allocated[level]) {
+		int allocated = sketch->allocated[level] > 0 ? sketch->allocated[level] * 2 : 8;
+		int *values = memRealloc(MEM_QUERY, sketch->levels[level], sizeof(int) * allocated);
+		if (values == NULL) {
+			return -1;
+		}
+		sketch->levels[level] = values;
+		sketch->allocated[level] = allocated;
+	}
+	sketch->levels[level][sketch->sizes[level]++] = value;
+	sketch->size++;
+	return 0;
+}
+
+// Gerador xorshift: so e usado para escolher os valores de posicao par ou impar em cada compactacao
+static unsigned nextRandom(QuantileSketch *sketch) {
+	sketch->random ^= sketch->random << 13;
+	sketch->random ^= sketch->random >> 17;
+	sketch->random ^= sketch->random << 5;
+	return sketch->random;
+}
+
+static int compactLevel(QuantileSketch *sketch, int level) {
+	int *values = sketch->levels[level];
+	int size = sketch->sizes[level];
+
+	if (level + 1 == MAX_LEVELS) {
+		return 0;
+	}
+	if (level + 1 == sketch->numLevels) {
+		setLevels(sketch, sketch->numLevels + 1);
+	}
+
+	qsort(values, size, sizeof(int), compareInts);
+	// Com um numero impar de valores o primeiro fica neste nivel e os restantes formam pares
+	int first = size % 2;
+	int offset = nextRandom(sketch) & 1;
+	for (int i = first + offset; i < size; i += 2) {
+		if (appendValue(sketch, level + 1, values[i]) != 0) {
+			return -1;
+		}
+	}
+	sketch->size -= size - first;
+	sketch->sizes[level] = first;
+	sketch->compacted = 1;
+	return 0;
+}
+
+static int compress(QuantileSketch *sketch) {
+	while (sketch->size > sketch->capacity) {
+		int level = 0;
+		while (level < sketch->numLevels - 1 && sketch->sizes[level] < levelCapacity(sketch, level)) {
+			level++;
+		}
+		if (level + 1 == MAX_LEVELS || compactLevel(sketch, level) != 0) {
+			return level + 1 == MAX_LEVELS ? 0 : -1;
+		}
+	}
+	return 0;
+}
+
+QuantileSketch *createSketch(void) {
+	QuantileSketch *sketch = memCalloc(MEM_QUERY, 1, sizeof(QuantileSketch));
+	if (sketch != NULL) {
+		setLevels(sketch, 1);
+		sketch->random = 2463534242u;
+	}
+	return sketch;
+}
+
+void freeSketch(QuantileSketch *sketch) {
+	if (sketch == NULL) {
+		return;
+	}
+	for (int level = 0; level < MAX_LEVELS; level++) {
+		memFree(sketch->levels[level]);
+	}
+	memFree(sketch);
+}
+
+int sketchUpdate(QuantileSketch *sketch, int value) {
+	if (appendValue(sketch, 0, value) != 0) {
+		return -1;
+	}
+	if (sketch->count == 0 || value < sketch->min) {
+		sketch->min = value;
+	}
+	if (sketch->count == 0 || value > sketch->max) {
+		sketch->max = value;
+	}
+	sketch->count++;
+	return compress(sketch);
+}
+
+int sketchMerge(QuantileSketch *into, const QuantileSketch *from) {
+	if (from->count == 0) {
+		return 0;
+	}
+	if (from->numLevels > into->numLevels) {
+		setLevels(into, from->numLevels);
+	}
+	for (int level = 0; level < from->numLevels; level++) {
+		for (int i = 0; i < from->sizes[level]; i++) {
+			if (appendValue(into, level, from->levels[level][i]) != 0) {
+				return -1;
+			}
+		}
+	}
+	if (into->count == 0 || from->min < into->min) {
+		into->min = from->min;
+	}
+	if (into->count == 0 || from->max > into->max) {
+		into->max = from->max;
+	}
+	into->count += from->count;
+	into->compacted |= from->compacted;
+	return compress(into);
+}
+
+long sketchCount(const QuantileSketch *sketch) {
+	return sketch->count;
+}
+
+int sketchQuantile(const QuantileSketch *sketch, double q) {
+	int size = 0, result = sketch->max;
+
+	if (q <= 0) {
+		return sketch->min;
+	}
+	if (q >= 1) {
+		return sketch->max;
+	}
+	WeightedValue *values = memAlloc(MEM_QUERY, sizeof(WeightedValue) * (sketch->size > 0 ? sketch->size : 1));
+	if (values == NULL) {
+		return result;
+	}
+
+	size = 0;
+	for (int level = 0; level < sketch->numLevels; level++) {
+		for (int i = 0; i < sketch->sizes[level]; i++) {
+			values[size++] = (WeightedValue){.value = sketch->levels[level][i], .weight = 1L << level};
+		}
+	}
+	qsort(values, size, sizeof(WeightedValue), compareWeightedValues);
+
+	// O quantil e o primeiro valor cujo peso acumulado atinge a fracao 'q' do total de registos
+	double target = q * sketch->count;
+	long cumulative = 0;
+	for (int i = 0; i < size; i++) {
+		cumulative += values[i].weight;
+		if (cumulative >= target) {
+			result = values[i].value;
+			break;
+		}
+	}
+	memFree(values);
+	return result;
+}
+
+double sketchRankError(const QuantileSketch *sketch) {
+	return sketch->compacted ? SKETCH_RANK_ERROR : 0.0;
+}
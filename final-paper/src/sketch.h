@@ -0,0 +1,100 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include "types.h"
+
+/**
+ * @file sketch.h
+ * @brief Cabeçalho do resumo (sketch) de quantis aproximados.
+ *
+ * Este ficheiro de cabeçalho declara um resumo KLL (Karnin, Lang e Liberty) para estimar quantis de um
+ * conjunto de valores inteiros, como as calorias de uma refeição, sem guardar todos os valores:
+ * - Os valores entram no nível 0. Quando os níveis ultrapassam a sua capacidade, o nível mais baixo cheio é
+ *   ordenado e metade dos valores (os de posição par ou ímpar, escolhidos ao acaso) passa para o nível
+ *   seguinte, onde cada valor representa o dobro dos registos.
+ * - A capacidade do nível mais alto é SKETCH_K e cada nível abaixo tem 2/3 da capacidade do nível acima,
+ *   pelo que a memória é limitada a cerca de 3 * SKETCH_K valores, independentemente do número de registos.
+ * - Dois resumos podem ser fundidos juntando os níveis correspondentes e compactando de novo. O resultado tem
+ *   a mesma garantia de erro que um resumo construído com todos os valores, o que permite que cada thread
+ *   construa o seu resumo sobre uma parte dos dados.
+ *
+ * Enquanto nenhum nível tiver sido compactado, os quantis são exatos.
+ *
+ * @note Este ficheiro depende das definições das estruturas de dados em 'types.h'.
+ */
+
+/**
+ * @brief Capacidade do nível mais alto de cada resumo. Determina a memória usada e o erro dos quantis.
+ */
+#define SKETCH_K 200
+
+/**
+ * @brief Cria um resumo de quantis vazio.
+ *
+ * @return Retorna um ponteiro para o novo resumo, ou NULL se não houver memória.
+ */
+QuantileSketch *createSketch(void);
+
+/**
+ * @brief Liberta a memória de um resumo.
+ *
+ * @param sketch Ponteiro para o resumo (pode ser NULL).
+ */
+void freeSketch(QuantileSketch *sketch);
+
+/**
+ * @brief Acrescenta um valor ao resumo.
+ *
+ * @param sketch Ponteiro para o resumo.
+ * @param value Valor a acrescentar.
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não houver memória.
+ */
+int sketchUpdate(QuantileSketch *sketch, int value);
+
+/**
+ * @brief Funde um resumo noutro, como se todos os valores de 'from' tivessem sido acrescentados a 'into'.
+ *
+ * @param into Resumo que recebe os valores.
+ * @param from Resumo a fundir (não é alterado).
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se não houver memória.
+ */
+int sketchMerge(QuantileSketch *into, const QuantileSketch *from);
+
+/**
+ * @brief Devolve o número de valores representados pelo resumo.
+ *
+ * @param sketch Ponteiro para o resumo.
+ *
+ * @return Retorna o número de valores acrescentados, incluindo os dos resumos fundidos.
+ */
+long sketchCount(const QuantileSketch *sketch);
+
+/**
+ * @brief Estima o quantil 'q' dos valores do resumo.
+ *
+ * O valor devolvido é o menor valor do resumo que tem pelo menos 'q' dos registos abaixo ou iguais a ele.
+ * Com 'q' igual a 0 ou 1 são devolvidos o mínimo e o máximo exatos.
+ *
+ * @param sketch Ponteiro para o resumo, com pelo menos um valor.
+ * @param q Fração entre 0 e 1 (ex: 0.5 para a mediana, 0.99 para o percentil 99).
+ *
+ * @return Retorna o valor estimado do quantil.
+ */
+int sketchQuantile(const QuantileSketch *sketch, double q);
+
+/**
+ * @brief Devolve o erro máximo da posição de um quantil, como fração do número de registos.
+ *
+ * Para SKETCH_K igual a 200 o erro é de 1,33% com 99% de confiança: o valor devolvido para o quantil 'q'
+ * tem uma posição real entre q - 0,0133 e q + 0,0133 (ex: a mediana estimada está entre os percentis 48,7
+ * e 51,3). Este é o limite empírico publicado para resumos KLL com esta capacidade.
+ *
+ * @param sketch Ponteiro para o resumo.
+ *
+ * @return Retorna 0 se os quantis do resumo forem exatos, ou o erro máximo da posição caso contrário.
+ */
+double sketchRankError(const QuantileSketch *sketch);
+
+#endif // SKETCH_H
@@ -0,0 +1,50 @@
+#include "extsort.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file sortdiet.c
+ * @brief Ferramenta de linha de comandos para ordenar ficheiros de dietas maiores do que a memória.
+ *
+ * Este ficheiro implementa a função 'main' da ferramenta 'sortdiet.out', que ordena um ficheiro no formato
+ * de 'diet.txt' por (paciente, data) através de 'externalSortDiets'. Os índices e junções do programa que
+ * assumem dietas ordenadas podem assim ser usados com arquivos que não cabem em memória.
+ *
+ * Utilização:
+ * @code
+ * ./sortdiet.out <entrada> <saida> [memoria_MB] [threads] [--binary]
+ * @endcode
+ */
+
+int main(int argc, char *argv[]) {
+	size_t memoryMB = 64;
+	int threads = 4, binary = 0, position = 0;
+	char *paths[2] = {NULL, NULL};
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--binary")) {
+			binary = 1;
+		} else if (position < 2) {
+			paths[position++] = argv[i];
+		} else if (position == 2) {
+			memoryMB = strtoul(argv[i], NULL, 10);
+			position++;
+		} else {
+			threads = atoi(argv[i]);
+		}
+	}
+
+	if (paths[1] == NULL || memoryMB == 0 || threads < 1) {
+		printf("Utilizacao: %s <entrada> <saida> [memoria_MB] [threads] [--binary]\n", argv[0]);
+		return 1;
+	}
+
+	long count = externalSortDiets(paths[0], paths[1], memoryMB << 20, threads, binary);
+	if (count < 0) {
+		return 1;
+	}
+	printf("%ld registos ordenados em '%s'.\n", count, paths[1]);
+	return 0;
+}
@@ -0,0 +1,330 @@
+#include "stream.h"
+#include "memtrack.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/**
+ * @file stream.c
+ * @brief Implementação da leitura sequencial de ficheiros de dados comprimidos.
+ *
+ * Este ficheiro contém as implementações das funções declaradas em 'stream.h'. O anel tem RING_BLOCKS
+ * blocos de BLOCK_SIZE bytes: a thread produtora escreve sempre no bloco 'head' e a thread leitora consome
+ * sempre o bloco 'tail'. O contador 'ready', protegido por um mutex, diz quantos blocos estão prontos; cada
+ * thread só espera quando o anel está cheio (produtora) ou vazio (leitora).
+ */
+
+#define RING_BLOCKS 4
+#define BLOCK_SIZE (1 << 16)
+
+typedef enum {
+	PLAIN,
+	GZIP,
+	ZSTD
+} Compression;
+
+struct InputStream {
+	Compression compression;
+	FILE *file;
+	gzFile gz;
+#ifdef HAVE_ZSTD
+	ZSTD_DCtx *zstd;
+	ZSTD_inBuffer input;
+	char *inputBuffer;
+	size_t lastResult;
+#endif
+
+	char *blocks[RING_BLOCKS];
+	size_t lengths[RING_BLOCKS];
+	int head;
+	int tail;
+	int ready;
+	size_t position;
+	int finished;
+	int failed;
+	int stopping;
+
+	pthread_t producer;
+	int started;
+	pthread_mutex_t lock;
+	pthread_cond_t notEmpty;
+	pthread_cond_t notFull;
+};
+
+static int endsWith(const char *text, const char *suffix) {
+	size_t length = strlen(text), suffixLength = strlen(suffix);
+	return length >= suffixLength && !strcmp(text + length - suffixLength, suffix);
+}
+
+static Compression compressionOf(const char *path) {
+	if (endsWith(path, ".gz")) {
+		return GZIP;
+	}
+	if (endsWith(path, ".zst")) {
+		return ZSTD;
+	}
+	return PLAIN;
+}
+
+int isCompressedPath(const char *path) {
+	return compressionOf(path) != PLAIN;
+}
+
+#ifdef HAVE_ZSTD
+// Descomprime ate encher 'buffer'; devolve o numero de bytes, 0 no fim ou -1 em caso de erro
+static long decompressZstd(InputStream *stream, char *buffer, size_t size) {
+	ZSTD_outBuffer output = {buffer, size, 0};
+
+	while (output.pos < output.size) {
+		if (stream->input.pos == stream->input.size) {
+			stream->input.size = fread(stream->inputBuffer, 1, ZSTD_DStreamInSize(), stream->file);
+			stream->input.pos = 0;
+			if (stream->input.size == 0) {
+				// Um ficheiro que acaba a meio de uma frame esta truncado
+				return output.pos > 0 || stream->lastResult == 0 ? (long)output.pos : -1;
+			}
+		}
+		stream->lastResult = ZSTD_decompressStream(stream->zstd, &output, &stream->input);
+		if (ZSTD_isError(stream->lastResult)) {
+			return -1;
+		}
+	}
+	return output.pos;
+}
+#endif
+
+static long decompressBlock(InputStream *stream, char *buffer, size_t size) {
+	if (stream->compression == GZIP) {
+		int bytes = gzread(stream->gz, buffer, size), error = Z_OK;
+		// Um ficheiro truncado termina sem erro em 'gzread'; o erro fica apenas registado em 'gzerror'
+		if (bytes == 0) {
+			gzerror(stream->gz, &error);
+		}
+		return error == Z_OK ? bytes : -1;
+	}
+#ifdef HAVE_ZSTD
+	return decompressZstd(stream, buffer, size);
+#else
+	return -1;
+#endif
+}
+
+static void *produceBlocks(void *arg) {
+	InputStream *stream = (InputStream *)arg;
+
+	for (;;) {
+		pthread_mutex_lock(&stream->lock);
+		while (stream->ready == RING_BLOCKS && !stream->stopping) {
+			pthread_cond_wait(&stream->notFull, &stream->lock);
+		}
+		int head = stream->head, stopping = stream->stopping;
+		pthread_mutex_unlock(&stream->lock);
+		if (stopping) {
+			break;
+		}
+
+		// O bloco 'head' so e lido pela leitora depois de 'ready' aumentar, por isso e preenchido sem o mutex
+		long bytes = decompressBlock(stream, stream->blocks[head], BLOCK_SIZE);
+
+		pthread_mutex_lock(&stream->lock);
+		if (bytes <= 0) {
+			stream->finished = 1;
+			stream->failed = bytes < 0;
+		} else {
+			stream->lengths[head] = bytes;
+			stream->head = (head + 1) % RING_BLOCKS;
+			stream->ready++;
+		}
+		pthread_cond_signal(&stream->notEmpty);
+		pthread_mutex_unlock(&stream->lock);
+		if (bytes <= 0) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+static int openSource(InputStream *stream, char *path) {
+	if (stream->compression == GZIP) {
+		stream->gz = gzopen(path, "rb");
+		if (stream->gz == NULL) {
+			return -1;
+		}
+		gzbuffer(stream->gz, BLOCK_SIZE);
+		return 0;
+	}
+#ifdef HAVE_ZSTD
+	stream->file = fopen(path, "rb");
+	stream->zstd = ZSTD_createDCtx();
+	stream->inputBuffer = memAlloc(MEM_TEXT, ZSTD_DStreamInSize());
+	stream->input = (ZSTD_inBuffer){stream->inputBuffer, 0, 0};
+	return stream->file != NULL && stream->zstd != NULL && stream->inputBuffer != NULL ? 0 : -1;
+#else
+	printf("Suporte para ficheiros .zst nao incluido nesta compilacao.\n");
+	return -1;
+#endif
+}
+
+static void closeSource(InputStream *stream) {
+	if (stream->gz != NULL) {
+		gzclose(stream->gz);
+	}
+	if (stream->file != NULL) {
+		fclose(stream->file);
+	}
+#ifdef HAVE_ZSTD
+	ZSTD_freeDCtx(stream->zstd);
+	memFree(stream->inputBuffer);
+#endif
+}
+
+InputStream *openInputStream(char *path) {
+	InputStream *stream = memCalloc(MEM_TEXT, 1, sizeof(InputStream));
+	if (stream == NULL) {
+		return NULL;
+	}
+	stream->compression = compressionOf(path);
+
+	if (stream->compression == PLAIN) {
+		stream->file = fopen(path, "r");
+		if (stream->file == NULL) {
+			memFree(stream);
+			return NULL;
+		}
+		return stream;
+	}
+
+	int status = openSource(stream, path);
+	for (int i = 0; i < RING_BLOCKS && status == 0; i++) {
+		stream->blocks[i] = memAlloc(MEM_TEXT, BLOCK_SIZE);
+		if (stream->blocks[i] == NULL) {
+			status = -1;
+		}
+	}
+	pthread_mutex_init(&stream->lock, NULL);
+	pthread_cond_init(&stream->notEmpty, NULL);
+	pthread_cond_init(&stream->notFull, NULL);
+	stream->started = status == 0 && pthread_create(&stream->producer, NULL, produceBlocks, stream) == 0;
+	if (!stream->started) {
+		// Sem a thread produtora o fluxo nunca chega a ter blocos; fecha-se como se tivesse terminado
+		stream->finished = 1;
+		stream->stopping = 1;
+		closeInputStream(stream);
+		return NULL;
+	}
+	return stream;
+}
+
+// Espera que o bloco 'tail' esteja pronto; devolve 0 se o ficheiro ja terminou
+static int waitForBlock(InputStream *stream) {
+	pthread_mutex_lock(&stream->lock);
+	while (stream->ready == 0 && !stream->finished) {
+		pthread_cond_wait(&stream->notEmpty, &stream->lock);
+	}
+	int ready = stream->ready > 0;
+	pthread_mutex_unlock(&stream->lock);
+	return ready;
+}
+
+// Devolve o bloco 'tail' a produtora depois de totalmente consumido
+static void releaseBlock(InputStream *stream) {
+	pthread_mutex_lock(&stream->lock);
+	stream->tail = (stream->tail + 1) % RING_BLOCKS;
+	stream->ready--;
+	stream->position = 0;
+	pthread_cond_signal(&stream->notFull);
+	pthread_mutex_unlock(&stream->lock);
+}
+
+char *readInputLine(InputStream *stream, char *line, int size) {
+	int used = 0;
+
+	if (stream->compression == PLAIN) {
+		return fgets(line, size, stream->file);
+	}
+
+	// Uma linha pode comecar num bloco e terminar no seguinte
+	while (used < size - 1 && waitForBlock(stream)) {
+		char *block = stream->blocks[stream->tail] + stream->position;
+		size_t available = stream->lengths[stream->tail] - stream->position;
+		size_t count = available < (size_t)(size - 1 - used) ? available : (size_t)(size - 1 - used);
+		char *newline = memchr(block, '\n', count);
+		if (newline != NULL) {
+			count = newline - block + 1;
+		}
+
+		memcpy(line + used, block, count);
+		used += count;
+		stream->position += count;
+		if (stream->position == stream->lengths[stream->tail]) {
+			releaseBlock(stream);
+		}
+		if (newline != NULL) {
+			break;
+		}
+	}
+
+	if (used == 0) {
+		return NULL;
+	}
+	line[used] = '\0';
+	return line;
+}
+
+size_t readInputBytes(InputStream *stream, char *buffer, size_t size) {
+	size_t used = 0;
+
+	if (stream->compression == PLAIN) {
+		return fread(buffer, 1, size, stream->file);
+	}
+
+	while (used < size && waitForBlock(stream)) {
+		size_t available = stream->lengths[stream->tail] - stream->position;
+		size_t count = available < size - used ? available : size - used;
+
+		memcpy(buffer + used, stream->blocks[stream->tail] + stream->position, count);
+		used += count;
+		stream->position += count;
+		if (stream->position == stream->lengths[stream->tail]) {
+			releaseBlock(stream);
+		}
+	}
+	return used;
+}
+
+int closeInputStream(InputStream *stream) {
+	int status = 0;
+
+	if (stream == NULL) {
+		return 0;
+	}
+	if (stream->compression != PLAIN) {
+		// A leitora pode parar antes do fim; a produtora e acordada para terminar em vez de esperar por espaco
+		pthread_mutex_lock(&stream->lock);
+		stream->stopping = 1;
+		pthread_cond_signal(&stream->notFull);
+		pthread_mutex_unlock(&stream->lock);
+		if (stream->started) {
+			pthread_join(stream->producer, NULL);
+		}
+
+		status = stream->failed ? -1 : 0;
+		for (int i = 0; i < RING_BLOCKS; i++) {
+			memFree(stream->blocks[i]);
+		}
+		pthread_mutex_destroy(&stream->lock);
+		pthread_cond_destroy(&stream->notEmpty);
+		pthread_cond_destroy(&stream->notFull);
+		closeSource(stream);
+	} else if (stream->file != NULL) {
+		fclose(stream->file);
+	}
+	memFree(stream);
+	return status;
+}
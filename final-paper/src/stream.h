@@ -0,0 +1,76 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "types.h"
+
+#include <stddef.h>
+
+/**
+ * @file stream.h
+ * @brief Cabeçalho da leitura sequencial de ficheiros de dados comprimidos.
+ *
+ * Este ficheiro de cabeçalho declara as funções usadas por 'readFile' e 'countLines' para ler um ficheiro
+ * linha a linha, esteja ele em texto ou comprimido. O tipo de compressão é detetado pela extensão:
+ * - '.gz': descompressão com a biblioteca zlib.
+ * - '.zst': descompressão com a biblioteca zstd, apenas se o programa for compilado com 'HAVE_ZSTD'.
+ * - Qualquer outra extensão: o ficheiro é lido diretamente como texto.
+ *
+ * Nos ficheiros comprimidos a descompressão é feita por uma thread produtora, que preenche um anel com um
+ * número fixo de blocos, enquanto a thread que chama 'readInputLine' interpreta os blocos já disponíveis.
+ * Assim a descompressão e a interpretação das linhas decorrem em simultâneo, a memória usada é limitada ao
+ * tamanho do anel e não é escrito nenhum ficheiro temporário.
+ *
+ * @note Este ficheiro depende das definições das estruturas de dados em 'types.h'.
+ */
+
+/**
+ * @brief Indica se um caminho corresponde a um ficheiro comprimido ('.gz' ou '.zst').
+ *
+ * @param path Caminho do ficheiro.
+ *
+ * @return Retorna 1 se o ficheiro for comprimido, ou 0 caso contrário.
+ */
+int isCompressedPath(const char *path);
+
+/**
+ * @brief Abre um ficheiro para leitura sequencial e, se for comprimido, inicia a thread de descompressão.
+ *
+ * @param path Caminho do ficheiro.
+ *
+ * @return Retorna um ponteiro para o novo fluxo de leitura, ou NULL se não for possível abrir o ficheiro ou
+ *         se o formato de compressão não for suportado.
+ */
+InputStream *openInputStream(char *path);
+
+/**
+ * @brief Lê a próxima linha de um fluxo, tal como 'fgets'.
+ *
+ * @param stream Fluxo de leitura.
+ * @param line Buffer onde a linha é guardada, incluindo o '\n' final se couber.
+ * @param size Tamanho do buffer 'line'.
+ *
+ * @return Retorna 'line', ou NULL no fim do ficheiro.
+ */
+char *readInputLine(InputStream *stream, char *line, int size);
+
+/**
+ * @brief Lê até 'size' bytes de um fluxo, tal como 'fread'.
+ *
+ * @param stream Fluxo de leitura.
+ * @param buffer Buffer onde os bytes são guardados.
+ * @param size Número máximo de bytes a ler.
+ *
+ * @return Retorna o número de bytes lidos, ou 0 no fim do ficheiro.
+ */
+size_t readInputBytes(InputStream *stream, char *buffer, size_t size);
+
+/**
+ * @brief Termina a thread de descompressão, se existir, e fecha o fluxo.
+ *
+ * @param stream Fluxo de leitura (pode ser NULL).
+ *
+ * @return Retorna 0 em caso de sucesso ou -1 se a descompressão tiver falhado (ficheiro corrompido ou truncado).
+ */
+int closeInputStream(InputStream *stream);
+
+#endif // STREAM_H
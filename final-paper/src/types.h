@@ -16,10 +16,21 @@
  * - 'Period': Define um período com datas de início e fim.
  * - 'Patients': Armazena informações sobre pacientes.
  * - 'Diet': Detalha uma dieta, incluindo a ingestão calórica.
- * - 'IDCalories': Associa um ID a um valor calórico.
+ * - 'DailyTotal': Total de calorias de um paciente num dia.
  * - 'MealPlan': Define um plano de refeições com limites calóricos.
- * - 'InfoTable': Estrutura para armazenar e apresentar informações consolidadas.
+ * - 'LazyFile': Estado de um ficheiro no modo de carregamento preguiçoso.
+ * - 'QueryKey': Parâmetros que identificam uma consulta na cache de resultados.
+ * - 'SiteRange': Parte do conjunto de dados que pertence a um local.
+ * - 'Snapshot': Versão publicada dos dados que mudam durante a escrita, lida pelos leitores concorrentes.
+ * - 'Batch': Lote de linhas, em colunas, passado entre os operadores de uma consulta.
+ * - 'Estimate': Resposta aproximada de uma consulta, com o intervalo de confiança.
+ * - 'RankedPatient': Paciente classificado por 'rankPatients', com a sua pontuação.
+ * - 'Dataset': Conjunto de dados carregado e respetivos índices.
  * - 'FileType': Enumeração dos tipos de ficheiros para operações de leitura de dados.
+ * - 'RankCriterion': Enumeração dos critérios de classificação de pacientes.
+ * - 'Column': Enumeração das colunas dos ficheiros, usada como máscara de bits.
+ * - 'QueryKind': Enumeração dos tipos de consulta guardados na cache.
+ * - 'MemoryTag': Enumeração dos subsistemas a que a memória reservada é atribuída.
  *
  * @note Estas estruturas e tipos enumerados são fundamentais para a estrutura de dados do programa e são amplamente
  *       utilizados nas diversas funções e operações implementadas.
@@ -27,6 +38,16 @@
 
 //DataTypes
 
+/**
+ * @brief Valor que separa os IDs de pacientes de locais diferentes quando são carregadas várias diretorias.
+ */
+#define SITE_ID_PREFIX 100000
+
+/**
+ * @brief Número máximo de linhas de um lote passado entre os operadores de uma consulta (ver 'pipeline.h').
+ */
+#define BATCH_SIZE 1024
+
 /**
  * @struct Date
  * @brief Estrutura para representar uma data.
@@ -130,25 +151,27 @@ typedef struct {
 } Diet;
 
 /**
- * @struct IDCalories
- * @brief Estrutura para representar o consumo de calorias associado a um identificador de paciente.
+ * @struct DailyTotal
+ * @brief Estrutura para representar o total de calorias consumidas por um paciente num único dia.
  *
- * Esta estrutura é usada para associar um identificador de paciente (ID) com a quantidade de calorias consumidas.
- * É particularmente útil em sistemas de monitorização nutricional ou de saúde, onde é necessário acompanhar
- * e analisar o consumo calórico dos pacientes. A estrutura permite uma rápida correlação entre o paciente 
- * e suas calorias consumidas, facilitando o processamento e análise desses dados.
+ * Esta estrutura é usada nas análises por janela deslizante, onde o consumo de cada paciente é
+ * primeiro reduzido a um total diário. A data é guardada como número de dias (ver 'dateToDays')
+ * para que dias consecutivos sejam inteiros consecutivos.
  *
- * @var IDCalories::ID
- * Membro 'ID' representa um identificador único do paciente. É um valor inteiro.
+ * @var DailyTotal::ID
+ * Membro 'ID' representa o identificador do paciente. É um valor inteiro.
  *
- * @var IDCalories::calories
- * Membro 'calories' armazena o total de calorias consumidas pelo paciente. É um valor inteiro que representa
- * o consumo calórico.
+ * @var DailyTotal::day
+ * Membro 'day' representa a data como número de dias desde 01-01-1970.
+ *
+ * @var DailyTotal::calories
+ * Membro 'calories' armazena o total de calorias consumidas pelo paciente nesse dia.
  */
 typedef struct {
         int ID;
+        int day;
         int calories;
-} IDCalories;
+} DailyTotal;
 
 /**
  * @struct MealPlan
@@ -184,40 +207,682 @@ typedef struct {
 } MealPlan;
 
 /**
- * @struct InfoTable
- * @brief Estrutura para representar informações detalhadas de um plano alimentar e o consumo real de um paciente.
+ * @enum Column
+ * @brief Enumeração das colunas dos ficheiros de dados, usada como máscara de bits.
  *
- * Esta estrutura é usada para combinar informações sobre um paciente com detalhes específicos de uma refeição,
- * incluindo o período em que a refeição está planeada, o intervalo calórico recomendado (mínimo e máximo) e o total
- * de calorias efetivamente consumidas. Serve como um registro abrangente para comparar o plano alimentar proposto
- * com o consumo real, permitindo análises e ajustes no acompanhamento nutricional do paciente.
+ * No modo de carregamento preguiçoso cada consulta indica as colunas de que precisa através de uma
+ * combinação destes valores (ex: COL_ID | COL_DATE). Apenas as colunas ainda não lidas são interpretadas.
  *
- * @var InfoTable::patient
- * Membro 'patient' armazena informações sobre o paciente. É uma estrutura 'Patients' que inclui identificador, nome e número de telefone.
+ * @var Column::COL_ID
+ * Identificador do paciente (todos os ficheiros).
  *
- * @var InfoTable::meal
- * Membro 'meal' representa o tipo de refeição planeada (por exemplo, 'almoço', 'jantar'). É uma cadeia de caracteres com um tamanho máximo de 50 caracteres.
+ * @var Column::COL_DATE
+ * Data da refeição ou do plano ('diet.txt' e 'mealPlan.txt').
  *
- * @var InfoTable::period
- * Membro 'period' define o período de tempo para o qual o plano alimentar é válido. É uma estrutura 'Period' que inclui datas de início e fim.
+ * @var Column::COL_MEAL
+ * Tipo de refeição ('diet.txt' e 'mealPlan.txt').
  *
- * @var InfoTable::minCal
- * Membro 'minCal' especifica o limite mínimo de calorias recomendado para a refeição. É um valor inteiro.
+ * @var Column::COL_NAME
+ * Nome do paciente ('patients.txt').
  *
- * @var InfoTable::maxCal
- * Membro 'maxCal' especifica o limite máximo de calorias recomendado para a refeição. É um valor inteiro.
+ * @var Column::COL_PHONE
+ * Número de telefone do paciente ('patients.txt').
  *
- * @var InfoTable::calories
- * Membro 'calories' representa o total de calorias consumidas pelo paciente na refeição. É um valor inteiro que ajuda a monitorizar a adesão ao plano alimentar.
+ * @var Column::COL_FOOD
+ * Alimentos consumidos ('diet.txt').
+ *
+ * @var Column::COL_CALORIES
+ * Calorias consumidas ('diet.txt').
+ *
+ * @var Column::COL_LIMITS
+ * Calorias mínimas e máximas do plano ('mealPlan.txt').
+ */
+typedef enum {
+        COL_ID = 1 << 0,
+        COL_DATE = 1 << 1,
+        COL_MEAL = 1 << 2,
+        COL_NAME = 1 << 3,
+        COL_PHONE = 1 << 4,
+        COL_FOOD = 1 << 5,
+        COL_CALORIES = 1 << 6,
+        COL_LIMITS = 1 << 7,
+        COL_ALL = 0xff
+} Column;
+
+/**
+ * @struct LazyFile
+ * @brief Estrutura com o estado de um ficheiro de dados no modo de carregamento preguiçoso.
+ *
+ * No arranque apenas é registada a posição de início de cada linha. As colunas são interpretadas
+ * na primeira vez que uma consulta precisa delas e ficam guardadas para as consultas seguintes.
+ *
+ * @var LazyFile::path
+ * Membro 'path' é o caminho do ficheiro.
+ *
+ * @var LazyFile::offsets
+ * Membro 'offsets' contém a posição (em bytes) do início de cada linha do ficheiro.
+ *
+ * @var LazyFile::lines
+ * Membro 'lines' é o número de linhas do ficheiro.
+ *
+ * @var LazyFile::parsed
+ * Membro 'parsed' é a máscara de bits ('Column') das colunas já interpretadas.
  */
 typedef struct {
-        Patients patient;
+        char path[512];
+        long *offsets;
+        int lines;
+        unsigned parsed;
+} LazyFile;
+
+/**
+ * @enum QueryKind
+ * @brief Enumeração dos tipos de consulta cujos resultados podem ser guardados na cache.
+ *
+ * @var QueryKind::QUERY_EXCEEDED_CALORIES
+ * Número de pacientes que excederam um limite de calorias (opção 1). Lê 'diet.txt'.
+ *
+ * @var QueryKind::QUERY_MEAL_PLAN
+ * Lista do plano alimentar de um paciente (opção 3). Lê 'mealPlan.txt'.
+ *
+ * @var QueryKind::QUERY_AVERAGE_CALORIES
+ * Média de calorias consumidas por um paciente (opção 4). Lê 'diet.txt'.
+ */
+typedef enum {
+        QUERY_EXCEEDED_CALORIES = 1,
+        QUERY_MEAL_PLAN,
+        QUERY_AVERAGE_CALORIES
+} QueryKind;
+
+/**
+ * @struct QueryKey
+ * @brief Estrutura com os parâmetros que identificam uma consulta na cache de resultados.
+ *
+ * Os campos que não se aplicam a um tipo de consulta devem ficar a zero (ou vazios), para que
+ * duas consultas iguais produzam sempre a mesma chave.
+ *
+ * @var QueryKey::kind
+ * Membro 'kind' indica o tipo de consulta.
+ *
+ * @var QueryKey::ID
+ * Membro 'ID' é o identificador do paciente, ou -1 se a consulta abrange todos os pacientes.
+ *
+ * @var QueryKey::meal
+ * Membro 'meal' é o tipo de refeição da consulta.
+ *
+ * @var QueryKey::period
+ * Membro 'period' é o período da consulta.
+ *
+ * @var QueryKey::limit
+ * Membro 'limit' é o limite de calorias da consulta.
+ */
+typedef struct {
+        QueryKind kind;
+        int ID;
         char meal[50];
         Period period;
+        int limit;
+} QueryKey;
+
+/**
+ * @enum AccessPath
+ * @brief Enumeração das formas de obter os registos de uma consulta, entre as quais o planeador escolhe.
+ *
+ * @var AccessPath::PLAN_FULL_SCAN
+ * Percorre o array inteiro por ordem.
+ *
+ * @var AccessPath::PLAN_DATE_INDEX
+ * Copia apenas as dietas do período, obtidas por pesquisa binária no índice por data.
+ *
+ * @var AccessPath::PLAN_SITE_SCAN
+ * Percorre apenas os registos do local do paciente.
+ *
+ * @var AccessPath::PLAN_PARALLEL_SITES
+ * Percorre cada local numa thread e soma os resultados parciais.
+ *
+ * @var AccessPath::PLAN_PATIENT_INDEX
+ * Copia apenas os registos do paciente no período, a partir das posições guardadas no armazenamento do ficheiro.
+ *
+ * @var AccessPath::PLAN_DISK_INDEX
+ * Lê do ficheiro apenas as linhas do paciente e da refeição, através do índice em disco.
+ *
+ * @var AccessPath::PLAN_COUNT
+ * Número de formas de acesso (não é uma forma de acesso).
+ */
+typedef enum {
+        PLAN_FULL_SCAN,
+        PLAN_DATE_INDEX,
+        PLAN_SITE_SCAN,
+        PLAN_PARALLEL_SITES,
+        PLAN_PATIENT_INDEX,
+        PLAN_DISK_INDEX,
+        PLAN_COUNT
+} AccessPath;
+
+/**
+ * @struct QueryPlan
+ * @brief Estrutura com o plano escolhido para uma consulta e o custo estimado de cada alternativa.
+ *
+ * Os custos são medidos em visitas a uma linha de um array em memória, pelo que só servem para comparar
+ * planos entre si.
+ *
+ * @var QueryPlan::path
+ * Membro 'path' é a forma de acesso escolhida (a de menor custo).
+ *
+ * @var QueryPlan::costs
+ * Membro 'costs' contém o custo estimado de cada forma de acesso, indexado por 'AccessPath', ou -1 para as
+ * que não se aplicam à consulta.
+ *
+ * @var QueryPlan::estimatedRows
+ * Membro 'estimatedRows' é o número estimado de registos que satisfazem os filtros da consulta.
+ */
+typedef struct {
+        AccessPath path;
+        double costs[PLAN_COUNT];
+        double estimatedRows;
+} QueryPlan;
+
+/**
+ * @struct TableStats
+ * @brief Estatísticas de um ficheiro de dados usadas pelo planeador de consultas. A estrutura é definida em 'planner.c'.
+ */
+typedef struct TableStats TableStats;
+
+/**
+ * @struct RowStore
+ * @brief Armazenamento estruturado em log das posições dos registos de um ficheiro por (paciente, data). A
+ *        estrutura é definida em 'rowstore.c'.
+ */
+typedef struct RowStore RowStore;
+
+/**
+ * @struct ResultCache
+ * @brief Cache de resultados de consultas com política LRU. A estrutura é definida em 'cache.c'.
+ */
+typedef struct ResultCache ResultCache;
+
+/**
+ * @struct SiteRange
+ * @brief Estrutura que descreve a parte do conjunto de dados que pertence a um local (clínica).
+ *
+ * Quando são carregadas várias diretorias de dados, os registos de cada local ficam contíguos nos arrays do
+ * 'Dataset'. Esta estrutura guarda onde começa e quantos registos tem cada local, o que permite executar
+ * uma consulta sobre cada local em paralelo e juntar os resultados parciais.
+ *
+ * @var SiteRange::directory
+ * Membro 'directory' é a diretoria de onde os dados do local foram lidos.
+ *
+ * @var SiteRange::prefix
+ * Membro 'prefix' é o valor somado aos IDs dos pacientes do local para os distinguir dos outros locais.
+ *
+ * @var SiteRange::firstPatient
+ * Membro 'firstPatient' é a posição do primeiro paciente do local no array 'patients'.
+ *
+ * @var SiteRange::numPatients
+ * Membro 'numPatients' é o número de pacientes do local.
+ *
+ * @var SiteRange::firstDiet
+ * Membro 'firstDiet' é a posição da primeira dieta do local no array 'diets'.
+ *
+ * @var SiteRange::numDiets
+ * Membro 'numDiets' é o número de dietas do local.
+ *
+ * @var SiteRange::firstMealPlan
+ * Membro 'firstMealPlan' é a posição do primeiro plano do local no array 'mealPlans'.
+ *
+ * @var SiteRange::numMealPlans
+ * Membro 'numMealPlans' é o número de planos do local.
+ */
+typedef struct {
+        char directory[512];
+        int prefix;
+        int firstPatient;
+        int numPatients;
+        int firstDiet;
+        int numDiets;
+        int firstMealPlan;
+        int numMealPlans;
+} SiteRange;
+
+/**
+ * @struct Snapshot
+ * @brief Estrutura com uma versão publicada das partes do conjunto de dados alteradas pelo caminho de escrita.
+ *
+ * Quando há uma escrita em segundo plano, as consultas não leem os arrays do 'Dataset' diretamente: leem a
+ * última versão publicada, que nunca é alterada. A escrita acrescenta registos depois do fim da versão publicada
+ * (ou numa cópia maior do array) e, no fim de cada lote, publica uma versão nova substituindo um único ponteiro.
+ * A memória das versões antigas é libertada por épocas (ver 'epoch.h').
+ *
+ * @var Snapshot::diets
+ * Membro 'diets' é o array de dietas da versão.
+ *
+ * @var Snapshot::numDiets
+ * Membro 'numDiets' é o número de dietas da versão.
+ *
+ * @var Snapshot::mealPlans
+ * Membro 'mealPlans' é o array de planos alimentares da versão.
+ *
+ * @var Snapshot::numMealPlans
+ * Membro 'numMealPlans' é o número de planos alimentares da versão.
+ *
+ * @var Snapshot::dietsByDate
+ * Membro 'dietsByDate' é o índice por data da versão (ver 'Dataset::dietsByDate').
+ *
+ * @var Snapshot::dietDays
+ * Membro 'dietDays' contém a data, em dias, de cada posição de 'dietsByDate'.
+ *
+ * @var Snapshot::indexedDiets
+ * Membro 'indexedDiets' é o número de dietas abrangidas pelo índice por data.
+ */
+typedef struct {
+        Diet *diets;
+        int numDiets;
+        MealPlan *mealPlans;
+        int numMealPlans;
+        int *dietsByDate;
+        int *dietDays;
+        int indexedDiets;
+} Snapshot;
+
+/**
+ * @struct IngestLog
+ * @brief Caminho de escrita para acrescentar registos aos ficheiros de dados. A estrutura é definida em 'ingest.c'.
+ */
+typedef struct IngestLog IngestLog;
+
+/**
+ * @struct InputStream
+ * @brief Leitura sequencial de um ficheiro de dados, comprimido ou não. A estrutura é definida em 'stream.c'.
+ */
+typedef struct InputStream InputStream;
+
+/**
+ * @struct QuantileSketch
+ * @brief Resumo de quantis aproximados com memória limitada. A estrutura é definida em 'sketch.c'.
+ */
+typedef struct QuantileSketch QuantileSketch;
+
+/**
+ * @struct DiskIndex
+ * @brief Índice persistente de pacientes, aberto com 'mmap'. A estrutura é definida em 'diskindex.c'.
+ */
+typedef struct DiskIndex DiskIndex;
+
+/**
+ * @struct AlertMonitor
+ * @brief Monitor de alertas de refeições fora do plano alimentar. A estrutura é definida em 'alerts.c'.
+ */
+typedef struct AlertMonitor AlertMonitor;
+
+/**
+ * @struct PlanVersion
+ * @brief Estrutura que representa uma versão do plano alimentar de um paciente para uma refeição.
+ *
+ * Uma versão está em vigor desde o seu dia até ao dia anterior à versão seguinte do mesmo paciente e
+ * refeição; a última versão não tem fim.
+ *
+ * @var PlanVersion::day
+ * Membro 'day' é o primeiro dia da versão, como número de dias desde 01-01-1970 (ver 'dateToDays').
+ *
+ * @var PlanVersion::minCal
+ * Membro 'minCal' é o limite mínimo de calorias da refeição.
+ *
+ * @var PlanVersion::maxCal
+ * Membro 'maxCal' é o limite máximo de calorias da refeição.
+ */
+typedef struct {
+        int day;
         int minCal;
         int maxCal;
-        int calories;
-} InfoTable;
+} PlanVersion;
+
+/**
+ * @struct PlanIndex
+ * @brief Índice das versões do plano alimentar por (paciente, refeição). A estrutura é definida em 'planindex.c'.
+ */
+typedef struct PlanIndex PlanIndex;
+
+/**
+ * @struct DietSample
+ * @brief Amostra estratificada das dietas por paciente e mês. A estrutura é definida em 'sample.c'.
+ */
+typedef struct DietSample DietSample;
+
+/**
+ * @struct Estimate
+ * @brief Estrutura com a resposta aproximada de uma consulta calculada a partir da amostra das dietas.
+ *
+ * @var Estimate::value
+ * Membro 'value' é o valor estimado.
+ *
+ * @var Estimate::low
+ * Membro 'low' é o limite inferior do intervalo de confiança de 95%.
+ *
+ * @var Estimate::high
+ * Membro 'high' é o limite superior do intervalo de confiança de 95%.
+ *
+ * @var Estimate::sampleRows
+ * Membro 'sampleRows' é o número de dietas da amostra que satisfazem os filtros da consulta.
+ */
+typedef struct {
+        double value;
+        double low;
+        double high;
+        long sampleRows;
+} Estimate;
+
+/**
+ * @struct RankedPatient
+ * @brief Estrutura com um paciente da classificação de 'rankPatients'.
+ *
+ * @var RankedPatient::ID
+ * Membro 'ID' é o identificador do paciente.
+ *
+ * @var RankedPatient::score
+ * Membro 'score' é a pontuação do paciente segundo o critério da classificação.
+ */
+typedef struct {
+        int ID;
+        double score;
+} RankedPatient;
+
+/**
+ * @enum BatchField
+ * @brief Enumeração das colunas numéricas de um lote ('Batch'), usada também como índice de bits em 'Batch::fields'.
+ *
+ * @var BatchField::FIELD_ID
+ * Identificador do paciente.
+ *
+ * @var BatchField::FIELD_DATE
+ * Data do registo, como chave ordenada (ver 'dateKey').
+ *
+ * @var BatchField::FIELD_CALORIES
+ * Calorias consumidas ('diet.txt').
+ *
+ * @var BatchField::FIELD_MIN_CAL
+ * Calorias mínimas do plano ('mealPlan.txt').
+ *
+ * @var BatchField::FIELD_MAX_CAL
+ * Calorias máximas do plano ('mealPlan.txt').
+ *
+ * @var BatchField::FIELD_ROW
+ * Posição do registo no array de onde foi lido.
+ *
+ * @var BatchField::FIELD_FIRST_DATE
+ * Primeira data de um grupo (resultado de uma agregação).
+ *
+ * @var BatchField::FIELD_LAST_DATE
+ * Última data de um grupo (resultado de uma agregação).
+ *
+ * @var BatchField::FIELD_SUM
+ * Soma de uma coluna (resultado de uma agregação).
+ *
+ * @var BatchField::FIELD_COUNT
+ * Número de linhas de um grupo (resultado de uma agregação).
+ *
+ * @var BatchField::FIELD_FLAG
+ * Valor calculado por uma consulta (ex: 1 se a refeição está fora do plano).
+ *
+ * @var BatchField::FIELD_PATIENT
+ * Posição do paciente no array 'patients', obtida por uma junção (-1 se não existir).
+ *
+ * @var BatchField::NUM_FIELDS
+ * Número de colunas numéricas (não é uma coluna).
+ */
+typedef enum {
+        FIELD_ID,
+        FIELD_DATE,
+        FIELD_CALORIES,
+        FIELD_MIN_CAL,
+        FIELD_MAX_CAL,
+        FIELD_ROW,
+        FIELD_FIRST_DATE,
+        FIELD_LAST_DATE,
+        FIELD_SUM,
+        FIELD_COUNT,
+        FIELD_FLAG,
+        FIELD_PATIENT,
+        NUM_FIELDS
+} BatchField;
+
+/**
+ * @struct Batch
+ * @brief Estrutura com um lote de até BATCH_SIZE linhas, guardadas coluna a coluna.
+ *
+ * Os operadores de uma consulta trocam lotes em vez de linhas individuais, pelo que cada operador aplica a sua
+ * operação a uma coluna inteira num ciclo simples, sem chamadas por linha.
+ *
+ * @var Batch::count
+ * Membro 'count' é o número de linhas do lote.
+ *
+ * @var Batch::fields
+ * Membro 'fields' é a máscara de bits (1 << 'BatchField') das colunas preenchidas. As restantes têm valores indefinidos.
+ *
+ * @var Batch::values
+ * Membro 'values' contém as colunas numéricas, indexadas por 'BatchField'.
+ *
+ * @var Batch::text
+ * Membro 'text' contém, para cada linha, a refeição (ou o nome, nos pacientes). Aponta para o registo original.
+ */
+typedef struct {
+        int count;
+        unsigned fields;
+        long values[NUM_FIELDS][BATCH_SIZE];
+        const char *text[BATCH_SIZE];
+} Batch;
+
+/**
+ * @enum AggregateFunction
+ * @brief Enumeração das funções de agregação de 'aggregateOperator'.
+ *
+ * @var AggregateFunction::AGGREGATE_SUM
+ * Soma dos valores da coluna.
+ *
+ * @var AggregateFunction::AGGREGATE_COUNT
+ * Número de linhas do grupo (a coluna de entrada é ignorada).
+ *
+ * @var AggregateFunction::AGGREGATE_MIN
+ * Menor valor da coluna.
+ *
+ * @var AggregateFunction::AGGREGATE_MAX
+ * Maior valor da coluna.
+ */
+typedef enum {
+        AGGREGATE_SUM,
+        AGGREGATE_COUNT,
+        AGGREGATE_MIN,
+        AGGREGATE_MAX
+} AggregateFunction;
+
+/**
+ * @struct Aggregate
+ * @brief Estrutura que descreve uma agregação calculada para cada grupo.
+ *
+ * @var Aggregate::function
+ * Membro 'function' é a função de agregação.
+ *
+ * @var Aggregate::input
+ * Membro 'input' é a coluna agregada.
+ *
+ * @var Aggregate::output
+ * Membro 'output' é a coluna onde o resultado é escrito.
+ */
+typedef struct {
+        AggregateFunction function;
+        BatchField input;
+        BatchField output;
+} Aggregate;
+
+/**
+ * @struct JoinField
+ * @brief Estrutura que descreve uma coluna copiada do lado construído de uma junção para as linhas do outro lado.
+ *
+ * @var JoinField::from
+ * Membro 'from' é a coluna do lado construído.
+ *
+ * @var JoinField::to
+ * Membro 'to' é a coluna onde o valor é escrito.
+ */
+typedef struct {
+        BatchField from;
+        BatchField to;
+} JoinField;
+
+/**
+ * @struct SortKey
+ * @brief Estrutura que descreve uma chave de ordenação.
+ *
+ * @var SortKey::field
+ * Membro 'field' é a coluna ordenada (ignorado se 'text' for 1).
+ *
+ * @var SortKey::text
+ * Membro 'text' é 1 para ordenar pelo texto da linha ('strcmp') em vez de uma coluna numérica.
+ *
+ * @var SortKey::descending
+ * Membro 'descending' é 1 para a ordem decrescente.
+ */
+typedef struct {
+        BatchField field;
+        int text;
+        int descending;
+} SortKey;
+
+/**
+ * @struct Operator
+ * @brief Operador de uma consulta, que produz lotes de linhas. A estrutura é definida em 'pipeline.c'.
+ */
+typedef struct Operator Operator;
+
+/**
+ * @struct Dataset
+ * @brief Estrutura que agrupa todos os dados carregados pelo programa e os respetivos índices.
+ *
+ * Esta estrutura reúne os arrays de pacientes, dietas e planos alimentares lidos dos ficheiros,
+ * o número de elementos de cada um e os índices construídos durante o carregamento. Permite passar
+ * o conjunto de dados completo entre módulos sem multiplicar parâmetros.
+ *
+ * @var Dataset::patients
+ * Membro 'patients' é o array de pacientes lido de 'patients.txt'.
+ *
+ * @var Dataset::numPatients
+ * Membro 'numPatients' é o número de elementos do array 'patients'.
+ *
+ * @var Dataset::diets
+ * Membro 'diets' é o array de dietas lido de 'diet.txt'.
+ *
+ * @var Dataset::numDiets
+ * Membro 'numDiets' é o número de elementos do array 'diets'.
+ *
+ * @var Dataset::dietCapacity
+ * Membro 'dietCapacity' é o número de elementos para o qual o array 'diets' tem espaço reservado.
+ *
+ * @var Dataset::mealPlans
+ * Membro 'mealPlans' é o array de planos alimentares lido de 'mealPlan.txt'.
+ *
+ * @var Dataset::numMealPlans
+ * Membro 'numMealPlans' é o número de elementos do array 'mealPlans'.
+ *
+ * @var Dataset::mealPlanCapacity
+ * Membro 'mealPlanCapacity' é o número de elementos para o qual o array 'mealPlans' tem espaço reservado.
+ *
+ * @var Dataset::patientSlots
+ * Membro 'patientSlots' é a tabela de dispersão (endereçamento aberto) que associa o ID de um paciente à sua
+ * posição no array 'patients'. As posições vazias têm o valor -1.
+ *
+ * @var Dataset::patientSlotsMask
+ * Membro 'patientSlotsMask' é o tamanho da tabela 'patientSlots' menos 1 (o tamanho é uma potência de 2).
+ *
+ * @var Dataset::patientsByName
+ * Membro 'patientsByName' contém as posições do array 'patients' ordenadas pelo nome, sem distinguir maiúsculas
+ * de minúsculas, o que permite encontrar todos os pacientes cujo nome começa por um prefixo com pesquisa binária.
+ *
+ * @var Dataset::nameSlots
+ * Membro 'nameSlots' é a tabela de dispersão (endereçamento aberto) que associa o nome completo de um paciente à
+ * sua posição no array 'patients'. As posições vazias têm o valor -1.
+ *
+ * @var Dataset::nameSlotsMask
+ * Membro 'nameSlotsMask' é o tamanho da tabela 'nameSlots' menos 1 (o tamanho é uma potência de 2).
+ *
+ * @var Dataset::dietsByDate
+ * Membro 'dietsByDate' contém as posições do array 'diets' ordenadas por data.
+ *
+ * @var Dataset::dietDays
+ * Membro 'dietDays' contém, pela mesma ordem de 'dietsByDate', a data de cada dieta como número de dias.
+ *
+ * @var Dataset::indexedDiets
+ * Membro 'indexedDiets' é o número de dietas (as primeiras do array) abrangidas pelo índice por data.
+ * As dietas acrescentadas depois da construção do índice são percorridas sequencialmente.
+ *
+ * @var Dataset::lazyFiles
+ * Membro 'lazyFiles' guarda o estado de cada ficheiro, indexado por 'FileType'. No modo normal todas as colunas
+ * estão marcadas como interpretadas logo após o carregamento.
+ *
+ * @var Dataset::stats
+ * Membro 'stats' contém as estatísticas de cada ficheiro recolhidas no carregamento, indexadas por 'FileType', ou
+ * NULL enquanto as colunas de que dependem não forem interpretadas (ver 'planner.h').
+ *
+ * @var Dataset::stores
+ * Membro 'stores' contém, indexado por 'FileType', o armazenamento com as posições dos registos de cada paciente
+ * ordenadas por data, usado pelas consultas sobre um paciente, ou NULL enquanto as colunas ID e data não forem
+ * interpretadas (ver 'rowstore.h').
+ *
+ * @var Dataset::cache
+ * Membro 'cache' é a cache de resultados das consultas sobre este conjunto de dados (pode ser NULL).
+ *
+ * @var Dataset::log
+ * Membro 'log' é o caminho de escrita usado para acrescentar registos (pode ser NULL).
+ *
+ * @var Dataset::snapshot
+ * Membro 'snapshot' é a última versão publicada para as consultas concorrentes com a escrita, ou NULL quando não
+ * há escrita em segundo plano e as consultas leem os arrays diretamente.
+ *
+ * @var Dataset::sample
+ * Membro 'sample' é a amostra estratificada das dietas usada pelas respostas aproximadas, ou NULL se o modo
+ * aproximado estiver desligado (ver 'sample.h').
+ *
+ * @var Dataset::alerts
+ * Membro 'alerts' é o monitor que verifica cada dieta inserida pelo caminho de escrita contra o plano alimentar
+ * ativo e envia alertas quando está fora do intervalo (pode ser NULL).
+ *
+ * @var Dataset::diskIndex
+ * Membro 'diskIndex' é o índice persistente em disco da diretoria de dados, usado no modo preguiçoso para
+ * responder a consultas sobre um paciente sem interpretar os ficheiros inteiros (pode ser NULL).
+ *
+ * @var Dataset::sites
+ * Membro 'sites' descreve os locais que compõem o conjunto de dados (NULL quando foi lida uma única diretoria).
+ *
+ * @var Dataset::numSites
+ * Membro 'numSites' é o número de elementos do array 'sites'.
+ */
+typedef struct {
+        Patients *patients;
+        int numPatients;
+        Diet *diets;
+        int numDiets;
+        int dietCapacity;
+        MealPlan *mealPlans;
+        int numMealPlans;
+        int mealPlanCapacity;
+        int *patientSlots;
+        int patientSlotsMask;
+        int *patientsByName;
+        int *nameSlots;
+        int nameSlotsMask;
+        int *dietsByDate;
+        int *dietDays;
+        int indexedDiets;
+        LazyFile lazyFiles[3];
+        TableStats *stats[3];
+        RowStore *stores[3];
+        ResultCache *cache;
+        IngestLog *log;
+        Snapshot *snapshot;
+        DietSample *sample;
+        AlertMonitor *alerts;
+        DiskIndex *diskIndex;
+        SiteRange *sites;
+        int numSites;
+} Dataset;
 
 /**
  * @enum FileType
@@ -243,4 +908,58 @@ typedef enum {
         MEAL_PLAN
 } FileType;
 
+/**
+ * @enum RankCriterion
+ * @brief Enumeração dos critérios usados para classificar os pacientes.
+ *
+ * @var RankCriterion::RANK_TOTAL
+ * Classifica pelo total de calorias consumidas no período.
+ *
+ * @var RankCriterion::RANK_EXCESS
+ * Classifica pelo excesso de calorias consumidas em relação a um limite.
+ *
+ * @var RankCriterion::RANK_OUT_OF_PLAN
+ * Classifica pela fração de refeições fora do intervalo mínimo/máximo do plano alimentar.
+ */
+typedef enum {
+        RANK_TOTAL = 1,
+        RANK_EXCESS,
+        RANK_OUT_OF_PLAN
+} RankCriterion;
+
+/**
+ * @enum MemoryTag
+ * @brief Enumeração dos subsistemas a que cada bloco de memória é atribuído (ver 'memtrack.h').
+ *
+ * @var MemoryTag::MEM_RECORDS
+ * Arrays de pacientes, dietas e planos alimentares.
+ *
+ * @var MemoryTag::MEM_TEXT
+ * Texto dos ficheiros de dados: buffers de leitura e posições das linhas no modo preguiçoso.
+ *
+ * @var MemoryTag::MEM_INDEX
+ * Índices e estatísticas construídos sobre os registos.
+ *
+ * @var MemoryTag::MEM_CACHE
+ * Resultados guardados na cache de consultas.
+ *
+ * @var MemoryTag::MEM_QUERY
+ * Memória temporária das consultas.
+ *
+ * @var MemoryTag::MEM_INGEST
+ * Caminho de escrita: buffers dos ficheiros, alertas e versões publicadas para os leitores.
+ *
+ * @var MemoryTag::NUM_MEMORY_TAGS
+ * Número de subsistemas (não é um subsistema).
+ */
+typedef enum {
+        MEM_RECORDS,
+        MEM_TEXT,
+        MEM_INDEX,
+        MEM_CACHE,
+        MEM_QUERY,
+        MEM_INGEST,
+        NUM_MEMORY_TAGS
+} MemoryTag;
+
 #endif // TYPES_H
@@ -1,4 +1,6 @@
 #include "utils.h"
+#include "stream.h"
+#include "schema.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,52 +16,53 @@
  * de dados de entrada e apresentação de informações de forma legível.
  *
  * As funções implementadas neste ficheiro incluem:
- * - Leitura e interpretação de dados de ficheiros com formatos específicos.
+ * - Leitura e interpretação de dados de ficheiros com formatos específicos, em texto ou comprimidos.
  * - Verificação se uma data está dentro de um período especificado.
  * - Impressão formatada de datas e períodos.
  * - Limpeza do buffer de entrada para evitar leituras indesejadas de dados.
  * - Ordenação de arrays de inteiros em ordem decrescente.
+ * - Conversão de datas para um número contínuo de dias e vice-versa.
  *
  * @note As funções neste ficheiro são dependentes das estruturas de dados e tipos enumerados definidos em 'types.h'
  *       e declarados em 'utils.h'.
  */
 
+int parseLine(char *line, void *data, int i, FileType fileType) {
+        return parseRecord(line, data, i, fileType, COL_ALL);
+}
+
 int readFile(char *path, void *data, int max_size, FileType fileType) {
-        FILE *file = fopen(path, "r");
+        InputStream *file = openInputStream(path);
         if (file == NULL) {
                 printf("Nao foi possivel abrir o ficheiro.\n");
                 return 0;
         }
 
-        char line[500];
-        int i;
-
-        for (i=0; i<max_size && fgets(line, sizeof(line), file); i++) {
-
-                switch (fileType) {
-
-                        case PATIENTS:
-                                Patients *patients = (Patients *)data;
-                                sscanf(line, "%d; %49[^;];%d", &patients[i].ID, patients[i].name, &patients[i].phoneNumber);
-                                break;
+        int i = readRecords(file, data, max_size, fileType);
+        if (closeInputStream(file) != 0) {
+                printf("Erro ao descomprimir o ficheiro %s.\n", path);
+        }
+        return i;
+}
 
-                        case DIET:
-                                Diet *diet = (Diet *)data;
-                                sscanf(line, "%d;%d-%d-%d; %49[^;];%49[^;];%d", &diet[i].ID, &diet[i].date.day, &diet[i].date.month, &diet[i].date.year, diet[i].meal, diet[i].food, &diet[i].calories);
-                                break;
+int countLines(char *path) {
+        InputStream *file = openInputStream(path);
+        if (file == NULL) {
+                return 0;
+        }
 
-                        case MEAL_PLAN:
-                                MealPlan *mealPlan = (MealPlan *)data;
-                                sscanf(line, "%d;%d-%d-%d; %49[^;]; %d Cal, %d Cal", &mealPlan[i].ID, &mealPlan[i].date.day, &mealPlan[i].date.month, &mealPlan[i].date.year, mealPlan[i].meal, &mealPlan[i].minCal, &mealPlan[i].maxCal);
-                                break;
+        char buffer[4096];
+        size_t bytes;
+        int lines = 0, last = '\n';
 
-                        default:
-                                printf("Tipo de ficheiro nao suportado.\n");
-                                break;
+        while ((bytes = readInputBytes(file, buffer, sizeof(buffer))) > 0) {
+                for (size_t i = 0; i < bytes; i++) {
+                        lines += buffer[i] == '\n';
                 }
+                last = buffer[bytes - 1];
         }
-        fclose(file);
-        return i;
+        closeInputStream(file);
+        return lines + (last != '\n');
 }
 
 int dateInPeriod(Date date, Period period) {
@@ -113,6 +116,31 @@ void sortDescending(int ids[], int numberEl) {
         }
 }
 
+int dateToDays(Date date) {
+	int year = date.year - (date.month <= 2);
+	int era = (year >= 0 ? year : year - 399) / 400;
+	int yearOfEra = year - era * 400;
+	int dayOfYear = (153 * (date.month + (date.month > 2 ? -3 : 9)) + 2) / 5 + date.day - 1;
+	int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+	return era * 146097 + dayOfEra - 719468;
+}
+
+Date daysToDate(int days) {
+	Date date;
+	days += 719468;
+	int era = (days >= 0 ? days : days - 146096) / 146097;
+	int dayOfEra = days - era * 146097;
+	int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	int monthIndex = (5 * dayOfYear + 2) / 153;
+
+	date.day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+	date.month = monthIndex + (monthIndex < 10 ? 3 : -9);
+	date.year = yearOfEra + era * 400 + (date.month <= 2);
+	return date;
+}
+
 void fillPeriod(Period *period) {
 	int isValidDate = 1;
 	do {
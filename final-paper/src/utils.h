@@ -32,6 +32,9 @@
  * suportadas são 'Patients', 'Diet' e 'MealPlan'. A função é capaz de interpretar diferentes formatos
  * de dados com base no tipo de ficheiro fornecido.
  *
+ * Ficheiros terminados em '.gz' ou '.zst' são descomprimidos à medida que são lidos (ver 'stream.h'),
+ * sem ficheiros temporários.
+ *
  * @param path Caminho para o ficheiro a ser lido.
  * @param data Ponteiro para a estrutura de dados onde os dados lidos serão armazenados.
  * @param max_size Número máximo de elementos a serem lidos e armazenados na estrutura de dados.
@@ -47,6 +50,34 @@
  */
 int readFile(char *path, void *data, int max_size, FileType fileType);
 
+/**
+ * @brief Interpreta uma linha de um ficheiro de dados e guarda-a na posição indicada de um array.
+ *
+ * O formato de cada tipo de ficheiro está descrito em 'schema.h'. Esta função é usada pelo caminho de
+ * escrita, que interpreta cada linha que acrescenta para que o registo em memória seja exatamente
+ * igual ao que seria lido do ficheiro, e pelas leituras de linhas isoladas (índice em disco, ordenação externa).
+ *
+ * @param line Linha de texto a interpretar.
+ * @param data Ponteiro para o array de registos do tipo correspondente a 'fileType'.
+ * @param i Posição do array onde o registo é guardado.
+ * @param fileType Tipo de registo contido na linha.
+ *
+ * @return Retorna 1 se o tipo de ficheiro é suportado, ou 0 caso contrário.
+ */
+int parseLine(char *line, void *data, int i, FileType fileType);
+
+/**
+ * @brief Conta o número de linhas de um ficheiro.
+ *
+ * Esta função é usada antes de 'readFile' para reservar arrays com o tamanho exato do ficheiro,
+ * em vez de um tamanho máximo fixo. A última linha é contada mesmo que não termine em '\n'.
+ *
+ * @param path Caminho para o ficheiro.
+ *
+ * @return Retorna o número de linhas do ficheiro, ou 0 se não for possível abri-lo.
+ */
+int countLines(char *path);
+
 /**
  * @brief Verifica se uma data específica está dentro de um determinado período.
  *
@@ -84,6 +115,34 @@ int dateInPeriod(Date date, Period period);
  */
 void sortDescending(int ids[], int numberEl);
 
+/**
+ * @brief Converte uma data no número de dias decorridos desde 01-01-1970.
+ *
+ * Esta função transforma uma estrutura 'Date' num inteiro contínuo, de forma a que datas
+ * consecutivas correspondam a inteiros consecutivos. Permite comparar datas e calcular
+ * diferenças entre elas com simples operações aritméticas, sem tratar meses e anos bissextos
+ * em cada comparação.
+ *
+ * @param date Estrutura 'Date' a converter.
+ *
+ * @return Retorna o número de dias desde 01-01-1970 (negativo para datas anteriores).
+ *
+ * @note A conversão segue o calendário gregoriano proléptico.
+ */
+int dateToDays(Date date);
+
+/**
+ * @brief Converte um número de dias desde 01-01-1970 numa estrutura 'Date'.
+ *
+ * Esta função é a inversa de 'dateToDays' e é usada para apresentar ao utilizador datas
+ * que foram calculadas internamente como inteiros.
+ *
+ * @param days Número de dias desde 01-01-1970.
+ *
+ * @return Retorna a estrutura 'Date' correspondente.
+ */
+Date daysToDate(int days);
+
 /**
  * @brief Imprime uma data no formato padrão DD-MM-AAAA.
  *
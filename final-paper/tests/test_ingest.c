@@ -0,0 +1,309 @@
+#include "loader.h"
+#include "ingest.h"
+#include "rowstore.h"
+#include "utils.h"
+#include "schema.h"
+#include "memtrack.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @file test_ingest.c
+ * @brief Testes do caminho de escrita, do armazenamento por paciente e das leituras concorrentes.
+ *
+ * O programa cria uma diretoria de dados temporária e verifica três propriedades:
+ * - 'storeLookup' devolve as mesmas posições que uma leitura linear das dietas, antes e depois de a tabela em
+ *   memória ser congelada em segmentos e de os segmentos serem compactados;
+ * - uma thread leitora que percorre as versões publicadas ('beginRead') enquanto outra thread insere registos
+ *   vê sempre registos completos, em número que nunca diminui, e pesquisas coerentes com a sua versão;
+ * - depois de 'commitIngest', os registos inseridos voltam a ser lidos ao carregar a diretoria de novo.
+ *
+ * Executado com 'make test'; termina com 0 se todas as verificações passarem.
+ */
+
+// Numero de pacientes dos registos gerados
+#define TEST_PATIENTS 50
+// Dietas escritas na diretoria antes do primeiro carregamento
+#define TEST_INITIAL_DIETS 300
+// Dietas inseridas pela thread de escrita durante as leituras concorrentes
+#define TEST_LIVE_DIETS 20000
+// Limite de dietas inseridas enquanto se espera por uma compactacao
+#define TEST_MAX_DIETS 200000
+
+static const char *meals[] = {"pequeno almoco", "almoco", "lanche", "jantar"};
+
+// A dieta numero 'n' e sempre a mesma, e as calorias dependem do paciente e do dia, para os leitores as validarem
+static void makeDiet(int n, Diet *diet) {
+	initializeDiets(diet, 1);
+	diet->ID = n % TEST_PATIENTS + 1;
+	diet->date = (Date){.day = n % 28 + 1, .month = n / 28 % 12 + 1, .year = 2023 + n / 336 % 2};
+	snprintf(diet->meal, sizeof(diet->meal), "%s", meals[n % 4]);
+	snprintf(diet->food, sizeof(diet->food), "teste");
+	diet->calories = diet->ID * 100 + diet->date.day;
+}
+
+static int validDiet(const Diet *diet) {
+	return diet->ID >= 1 && diet->ID <= TEST_PATIENTS && diet->calories == diet->ID * 100 + diet->date.day;
+}
+
+static int writeFile(const char *directory, const char *name, int lines, FileType fileType) {
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", directory, name);
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		return -1;
+	}
+	for (int i = 0; i < lines; i++) {
+		if (fileType == PATIENTS) {
+			fprintf(file, "%04d;Paciente %d;%09d\n", i + 1, i + 1, 100000000 + i);
+		} else {
+			Diet diet;
+			makeDiet(i, &diet);
+			fprintf(file, "%04d; %02d-%02d-%04d; %s; %s; %d cal\n", diet.ID, diet.date.day, diet.date.month, diet.date.year,
+				diet.meal, diet.food, diet.calories);
+		}
+	}
+	return fclose(file);
+}
+
+// Compara 'storeLookup' com uma leitura linear das primeiras 'count' dietas
+static int checkLookup(RowStore *store, const Diet *diets, int count, int ID, Period period) {
+	int *positions;
+	int found = storeLookup(store, ID, period, count, &positions);
+	int matched = 0, status = found < 0 ? -1 : 0;
+
+	for (int row = 0; status == 0 && row < count; row++) {
+		if (diets[row].ID != ID || dateInPeriod(diets[row].date, period) != 1) {
+			continue;
+		}
+		if (matched >= found || positions[matched] != row) {
+			status = -1;
+		}
+		matched++;
+	}
+	if (status == 0 && matched != found) {
+		status = -1;
+	}
+	if (status != 0) {
+		printf("FALHOU: o armazenamento devolveu %d posicoes para o paciente %d, a leitura linear %d\n", found, ID, matched);
+	}
+	if (found >= 0) {
+		memFree(positions);
+	}
+	return status;
+}
+
+static int checkAllPatients(RowStore *store, const Diet *diets, int count, Period period) {
+	for (int ID = 1; ID <= TEST_PATIENTS; ID++) {
+		if (checkLookup(store, diets, count, ID, period) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int ingestDiets(Dataset *dataset, int first, int count) {
+	for (int n = first; n < first + count; n++) {
+		Diet diet;
+		makeDiet(n, &diet);
+		if (ingestDiet(dataset, &diet) != 0) {
+			printf("FALHOU: nao foi possivel inserir a dieta %d\n", n);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+// Insere dietas aos poucos ate a tabela em memoria ter sido congelada e os segmentos compactados
+static int testStoreLookup(Dataset *dataset, int *inserted) {
+	// As dietas geradas so usam os dias 1 a 28: os periodos comecam e acabam em dias com registos
+	Period periods[] = {
+		{.begin = {1, 1, 2023}, .end = {28, 12, 2024}},
+		{.begin = {15, 3, 2023}, .end = {28, 7, 2024}},
+		{.begin = {28, 3, 2024}, .end = {28, 3, 2024}}
+	};
+	int flushed = 0, compacted = 0, segments, memtableRows;
+
+	storeShape(dataset->stores[DIET], &segments, &memtableRows);
+	while (!(flushed && compacted) && *inserted < TEST_MAX_DIETS) {
+		int previousSegments = segments, previousRows = memtableRows;
+		if (ingestDiets(dataset, TEST_INITIAL_DIETS + *inserted, 1000) != 0) {
+			return -1;
+		}
+		*inserted += 1000;
+		storeShape(dataset->stores[DIET], &segments, &memtableRows);
+		flushed |= memtableRows < previousRows + 1000;
+		compacted |= segments < previousSegments;
+
+		for (int i = 0; i < 3; i++) {
+			if (checkAllPatients(dataset->stores[DIET], dataset->diets, dataset->numDiets, periods[i]) != 0) {
+				return -1;
+			}
+		}
+	}
+	if (!flushed || !compacted) {
+		printf("FALHOU: %d dietas inseridas sem %s\n", *inserted, flushed ? "compactacao" : "congelar a tabela em memoria");
+		return -1;
+	}
+	printf("OK: storeLookup igual a leitura linear com %d dietas (%d segmentos, %d em memoria)\n", dataset->numDiets, segments, memtableRows);
+	return 0;
+}
+
+// Trabalho da thread de escrita durante as leituras concorrentes
+typedef struct {
+	Dataset *dataset;
+	int first;
+	int status;
+	int done;
+} Writer;
+
+static void *writeDiets(void *arg) {
+	Writer *writer = (Writer *)arg;
+
+	writer->status = ingestDiets(writer->dataset, writer->first, TEST_LIVE_DIETS);
+	if (writer->status == 0 && commitIngest(writer->dataset) != 0) {
+		writer->status = -1;
+	}
+	__atomic_store_n(&writer->done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+// Uma leitura de uma versao publicada: todos os registos completos e as pesquisas coerentes com a versao
+static int readSnapshot(Dataset *dataset, int *lastCount, int ID) {
+	Period period = {.begin = {1, 1, 2023}, .end = {28, 12, 2024}};
+	Dataset view;
+
+	if (beginRead(dataset, &view) != 0) {
+		printf("FALHOU: beginRead\n");
+		return -1;
+	}
+	int status = view.numDiets < *lastCount ? -1 : 0;
+	if (status != 0) {
+		printf("FALHOU: a versao publicada passou de %d para %d dietas\n", *lastCount, view.numDiets);
+	}
+	for (int row = 0; status == 0 && row < view.numDiets; row++) {
+		if (!validDiet(&view.diets[row])) {
+			printf("FALHOU: dieta %d incompleta na versao publicada\n", row);
+			status = -1;
+		}
+	}
+	if (status == 0) {
+		status = checkLookup(view.stores[DIET], view.diets, view.numDiets, ID, period);
+	}
+	*lastCount = view.numDiets;
+	endRead();
+	return status;
+}
+
+static int testConcurrentReads(Dataset *dataset, int first) {
+	Writer writer = {.dataset = dataset, .first = first, .status = 0, .done = 0};
+	pthread_t thread;
+	int lastCount = 0, reads = 0, status = 0;
+
+	if (publishSnapshot(dataset) != 0 || pthread_create(&thread, NULL, writeDiets, &writer) != 0) {
+		printf("FALHOU: nao foi possivel iniciar a escrita\n");
+		return -1;
+	}
+	while (status == 0 && !__atomic_load_n(&writer.done, __ATOMIC_ACQUIRE)) {
+		status = readSnapshot(dataset, &lastCount, reads % TEST_PATIENTS + 1);
+		reads++;
+	}
+	pthread_join(thread, NULL);
+	// A ultima versao, publicada pelo 'commitIngest' final, tem de ter todas as dietas
+	if (status == 0 && writer.status == 0) {
+		status = readSnapshot(dataset, &lastCount, 1);
+		if (status == 0 && lastCount != dataset->numDiets) {
+			printf("FALHOU: a ultima versao tem %d de %d dietas\n", lastCount, dataset->numDiets);
+			status = -1;
+		}
+	}
+	if (status != 0 || writer.status != 0) {
+		return -1;
+	}
+	printf("OK: %d leituras concorrentes com a insercao de %d dietas\n", reads + 1, TEST_LIVE_DIETS);
+	return 0;
+}
+
+static int testReload(Dataset *dataset, char *directory) {
+	int count = dataset->numDiets;
+	Diet *expected = memAlloc(MEM_QUERY, sizeof(Diet) * count);
+	Dataset reloaded;
+	int status = 0;
+
+	if (expected == NULL) {
+		printf("Memoria insuficiente.\n");
+		return -1;
+	}
+	memcpy(expected, dataset->diets, sizeof(Diet) * count);
+	freeDataset(dataset);
+	memset(dataset, 0, sizeof(Dataset));
+
+	if (loadDataset(&reloaded, directory, 0) != 0) {
+		printf("FALHOU: nao foi possivel carregar a diretoria de novo\n");
+		memFree(expected);
+		return -1;
+	}
+	if (reloaded.numDiets != count) {
+		printf("FALHOU: %d dietas depois de carregar de novo, esperadas %d\n", reloaded.numDiets, count);
+		status = -1;
+	}
+	for (int row = 0; status == 0 && row < count; row++) {
+		const Diet *a = &expected[row], *b = &reloaded.diets[row];
+		if (a->ID != b->ID || dateToDays(a->date) != dateToDays(b->date) || strcmp(a->meal, b->meal) || strcmp(a->food, b->food) ||
+				a->calories != b->calories) {
+			printf("FALHOU: a dieta %d mudou depois de carregar de novo\n", row);
+			status = -1;
+		}
+	}
+	if (status == 0) {
+		printf("OK: as %d dietas mantem-se depois de carregar de novo\n", count);
+	}
+	freeDataset(&reloaded);
+	memFree(expected);
+	return status;
+}
+
+static void removeDirectory(const char *directory) {
+	const char *names[] = {"patients.txt", "diet.txt", "mealPlan.txt"};
+	char path[512];
+
+	for (int i = 0; i < 3; i++) {
+		snprintf(path, sizeof(path), "%s/%s", directory, names[i]);
+		unlink(path);
+	}
+	rmdir(directory);
+}
+
+int main(void) {
+	char directory[] = "/tmp/test_ingestXXXXXX";
+	Dataset dataset;
+	int inserted = 0, status;
+
+	if (mkdtemp(directory) == NULL || writeFile(directory, "patients.txt", TEST_PATIENTS, PATIENTS) != 0 ||
+			writeFile(directory, "diet.txt", TEST_INITIAL_DIETS, DIET) != 0 || writeFile(directory, "mealPlan.txt", 0, MEAL_PLAN) != 0) {
+		printf("FALHOU: nao foi possivel criar a diretoria de teste\n");
+		return 1;
+	}
+	if (loadDataset(&dataset, directory, 0) != 0 || (dataset.log = openIngestLog(directory, 512)) == NULL) {
+		printf("FALHOU: nao foi possivel carregar a diretoria de teste\n");
+		removeDirectory(directory);
+		return 1;
+	}
+
+	status = testStoreLookup(&dataset, &inserted);
+	if (status == 0) {
+		status = testConcurrentReads(&dataset, TEST_INITIAL_DIETS + inserted);
+	}
+	if (status == 0) {
+		status = testReload(&dataset, directory);
+	} else {
+		freeDataset(&dataset);
+	}
+
+	removeDirectory(directory);
+	return status != 0;
+}